@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Microbenchmarks for the per packet routines of lib/data.c.
+ *
+ * Every routine is run over packed streams of every stream type, a packet
+ * with one stream of each type and source lists of increasing size. A
+ * benchmark repeats its routine until it has run for at least -t ms and
+ * reports the time per call and the bytes handled per second. Output is a
+ * table, or tab separated lines with -m to track results over time.
+ */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "conf.h"
+#include "data.h"
+#include "error.h"
+#include "net.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+#define BENCH_TIME      100     /* ms per benchmark */
+#define BENCH_ARG       "em0"   /* argument of all benchmarked streams */
+#define BENCH_STRLEN    4096
+#define BENCH_SOURCES   1000
+#define BENCH_STREAMS   512
+#define BENCH_CPUS      64      /* elements of a cpus vector */
+
+/* 24 repetitions of a value; the longest stream form */
+#define R24(x) x, x, x, x, x, x, x, x, x, x, x, x, \
+               x, x, x, x, x, x, x, x, x, x, x, x
+
+struct benchctx {
+    int type;
+    char buf[SYMON_MAXPACKET];
+    int len;
+    struct packedstream ps;
+    char str[BENCH_STRLEN];
+    struct sourcelist sol;
+    struct sockaddr_storage *addrs;
+    int naddrs;
+    struct source *source;
+    int *types;
+    char **args;
+    int nstreams;
+    u_int64_t i;
+};
+
+__BEGIN_DECLS
+static void usage(void);
+static int pack_stream(char *, int, int, char *, u_int64_t);
+static int bench_snpack(struct benchctx *);
+static int bench_sunpack2(struct benchctx *);
+static int bench_ps2strn(struct benchctx *);
+static int bench_crc32(struct benchctx *);
+static int bench_find_sockaddr(struct benchctx *);
+static int bench_find_stream(struct benchctx *);
+static void run(char *, int (*)(struct benchctx *), struct benchctx *);
+static void init_sources(struct benchctx *, int);
+static void init_streams(struct benchctx *, int);
+__END_DECLS
+
+static int flag_machine = 0;
+static int benchtime = BENCH_TIME;
+static char **filters;
+static int nfilters;
+static volatile u_int64_t sink;
+
+static void
+usage(void)
+{
+    info("usage: %s [-m] [-t ms] [benchmark ...]", __progname);
+    exit(EX_USAGE);
+}
+/*
+ * Pack a stream with values derived from v. snpack takes its values as
+ * arguments in the types of the stream form; forms of a single kind of value
+ * get that value repeated, mixed forms are spelled out. Returns 0 for a form
+ * that is not known here.
+ */
+static int
+pack_stream(char *buf, int maxlen, int type, char *arg, u_int64_t v)
+{
+    char *form = type2form(type);
+    double d = (v % 10000) / 100.0;
+    u_int32_t l = v;
+    int b = v & 0x7f;
+    int i, len;
+
+    switch (type) {
+    case MT_PROC:
+        return snpack(buf, maxlen, arg, type, l, v, v, v, l, d, l, l);
+    case MT_PROC2:
+        return snpack(buf, maxlen, arg, type, l, v, v, v, l, d, v, v);
+    case MT_TEST:
+        return snpack(buf, maxlen, arg, type, v, v, v, v, d, d, d, d,
+                      l, l, l, l, b, b, b, b, d, d, d, d, b, b, b, b);
+    case MT_CPUS:
+        if ((len = snpackv(buf, maxlen, arg, type, BENCH_CPUS)) == 0)
+            return 0;
+        for (i = 0; i < BENCH_CPUS; i++)
+            len += snpackelem(buf + len, maxlen - len, type, d, d, d, d, d);
+        return len;
+    case MT_SMART2:
+        return snpack(buf, maxlen, arg, type, b, b, b, b, b, b, b, b,
+                      b, b, b, b, l);
+    case MT_NVME:
+        return snpack(buf, maxlen, arg, type, b, d, b, b, v, v, v, v, v, v, v);
+    case MT_PSI:
+        return snpack(buf, maxlen, arg, type, d, d, d, v, d, d, d, v);
+    }
+
+    for (i = 1; form[i] == form[0]; i++)
+        ;
+    if (form[i] != '\0')
+        return 0;
+
+    switch (form[0]) {
+    case 'L':
+        return snpack(buf, maxlen, arg, type, R24(v));
+    case 'l':
+        return snpack(buf, maxlen, arg, type, R24(l));
+    case 'c':
+    case 'D':
+        return snpack(buf, maxlen, arg, type, R24(d));
+    case 's':
+    case 'b':
+        return snpack(buf, maxlen, arg, type, R24(b));
+    }
+
+    return 0;
+}
+static int
+bench_snpack(struct benchctx * c)
+{
+    return pack_stream(c->buf, sizeof(c->buf), c->type, BENCH_ARG, c->i++);
+}
+static int
+bench_sunpack2(struct benchctx * c)
+{
+    return sunpack2(c->buf, &c->ps);
+}
+static int
+bench_ps2strn(struct benchctx * c)
+{
+    ps2strn(&c->ps, c->str, sizeof(c->str), PS2STR_RRD);
+
+    return c->len;
+}
+static int
+bench_crc32(struct benchctx * c)
+{
+    sink += crc32(c->buf, c->len);
+
+    return c->len;
+}
+static int
+bench_find_sockaddr(struct benchctx * c)
+{
+    struct sockaddr_storage *ss = &c->addrs[c->i++ % c->naddrs];
+
+    sink += (u_int64_t) find_source_sockaddr(&c->sol, (struct sockaddr *) ss);
+
+    return 0;
+}
+static int
+bench_find_stream(struct benchctx * c)
+{
+    int i = c->i++ % c->nstreams;
+
+    sink += (u_int64_t) find_source_stream(c->source, c->types[i], c->args[i]);
+
+    return 0;
+}
+/* Run a benchmark until it took benchtime and report */
+static void
+run(char *name, int (*fn)(struct benchctx *), struct benchctx * c)
+{
+    u_int64_t start, elapsed, bytes;
+    u_int64_t n, iterations;
+    int i;
+
+    if (nfilters) {
+        for (i = 0; i < nfilters; i++)
+            if (strncmp(name, filters[i], strlen(filters[i])) == 0)
+                break;
+        if (i == nfilters)
+            return;
+    }
+
+    iterations = 0;
+    elapsed = 0;
+    bytes = 0;
+    c->i = 0;
+
+    for (n = 64; elapsed < (u_int64_t) benchtime * 1000000; n *= 2) {
+        start = clock_nsec(CLOCK_MONOTONIC);
+        for (iterations = 0, bytes = 0; iterations < n; iterations++)
+            bytes += fn(c);
+        elapsed = clock_nsec(CLOCK_MONOTONIC) - start;
+    }
+
+    if (flag_machine)
+        printf("%s\t%llu\t%.2f\t%.0f\n", name,
+               (unsigned long long) iterations,
+               (double) elapsed / iterations,
+               (double) bytes * 1000000000 / elapsed);
+    else
+        printf("%-32s %10llu %10.1f ns/op %10.1f MB/s\n", name,
+               (unsigned long long) iterations,
+               (double) elapsed / iterations,
+               (double) bytes * 1000 / elapsed);
+    fflush(stdout);
+}
+/* A source list of n sources and lookups spread over all of them */
+static void
+init_sources(struct benchctx * c, int n)
+{
+    char host[NI_MAXHOST];
+    struct source *source;
+    int i;
+
+    free_sourcelist(&c->sol);
+    SLIST_INIT(&c->sol);
+    if (c->addrs != NULL)
+        xfree(c->addrs);
+    c->addrs = xmalloc(n * sizeof(struct sockaddr_storage));
+    c->naddrs = n;
+
+    for (i = 0; i < n; i++) {
+        snprintf(host, sizeof(host), "10.%d.%d.%d",
+                 (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        source = add_source(&c->sol, host);
+        get_sockaddr(&source->sockaddr, AF_INET, SOCK_DGRAM, AI_NUMERICHOST,
+                     host, NULL);
+        /* look up in a different order than the list */
+        cpysock((struct sockaddr *) &source->sockaddr, &c->addrs[(i * 7919) % n]);
+    }
+}
+/* A source with n streams of all types and lookups spread over all of them */
+static void
+init_streams(struct benchctx * c, int n)
+{
+    char arg[SYMON_PS_ARGLENV2];
+    int i;
+
+    free_sourcelist(&c->sol);
+    SLIST_INIT(&c->sol);
+    c->source = add_source(&c->sol, "10.0.0.1");
+
+    if (c->types != NULL) {
+        for (i = 0; i < c->nstreams; i++)
+            xfree(c->args[i]);
+        xfree(c->types);
+        xfree(c->args);
+    }
+    c->types = xmalloc(n * sizeof(int));
+    c->args = xmalloc(n * sizeof(char *));
+    c->nstreams = n;
+
+    for (i = 0; i < n; i++) {
+        c->types[i] = i % MT_EOT;
+        snprintf(arg, sizeof(arg), "em%d", i / MT_EOT);
+        c->args[i] = xstrdup(arg);
+        add_source_stream(c->source, c->types[i], c->args[i]);
+    }
+}
+int
+main(int argc, char *argv[])
+{
+    struct benchctx *c;
+    char name[64];
+    int len;
+    int ch;
+    int n;
+    int t;
+
+    while ((ch = getopt(argc, argv, "mt:")) != -1) {
+        switch (ch) {
+        case 'm':
+            flag_machine = 1;
+            break;
+        case 't':
+            if ((benchtime = atoi(optarg)) <= 0)
+                usage();
+            break;
+        default:
+            usage();
+        }
+    }
+    filters = argv + optind;
+    nfilters = argc - optind;
+
+    init_crc32();
+
+    c = xmalloc(sizeof(struct benchctx));
+    bzero(c, sizeof(struct benchctx));
+    SLIST_INIT(&c->sol);
+
+    if (flag_machine)
+        printf("# benchmark\titerations\tns_per_op\tbytes_per_sec\n");
+
+    /* pack, unpack and render every stream type */
+    for (t = 0; t < MT_EOT; t++) {
+        c->type = t;
+        if ((c->len = pack_stream(c->buf, sizeof(c->buf), t, BENCH_ARG, 12345)) == 0) {
+            warning("no benchmark for stream type %.200s", type2str(t));
+            continue;
+        }
+
+        snprintf(name, sizeof(name), "snpack/%s", type2str(t));
+        run(name, bench_snpack, c);
+
+        c->len = pack_stream(c->buf, sizeof(c->buf), t, BENCH_ARG, 12345);
+        snprintf(name, sizeof(name), "sunpack2/%s", type2str(t));
+        run(name, bench_sunpack2, c);
+
+        snprintf(name, sizeof(name), "ps2strn/%s", type2str(t));
+        run(name, bench_ps2strn, c);
+    }
+
+    /* a packet with one stream of every type, and a maximum sized one */
+    for (c->len = 0, t = 0; t < MT_EOT; t++) {
+        len = pack_stream(c->buf + c->len, sizeof(c->buf) - c->len, t, BENCH_ARG, t);
+        c->len += len;
+    }
+    run("crc32/packet", bench_crc32, c);
+    c->len = SYMON_MAXPACKET;
+    run("crc32/maxpacket", bench_crc32, c);
+
+    for (n = 1; n <= BENCH_SOURCES; n *= 10) {
+        init_sources(c, n);
+        snprintf(name, sizeof(name), "find_source_sockaddr/%d", n);
+        run(name, bench_find_sockaddr, c);
+    }
+
+    for (n = 1; n <= BENCH_STREAMS; n *= 8) {
+        init_streams(c, n);
+        snprintf(name, sizeof(name), "find_source_stream/%d", n);
+        run(name, bench_find_stream, c);
+    }
+
+    return (EX_OK);
+}
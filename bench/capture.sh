@@ -0,0 +1,63 @@
+#!/bin/sh
+
+#
+# Copyright (c) 2026 agent <agent@local>
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#    - Redistributions of source code must retain the above copyright
+#      notice, this list of conditions and the following disclaimer.
+#    - Redistributions in binary form must reproduce the above
+#      copyright notice, this list of conditions and the following
+#      disclaimer in the documentation and/or other materials provided
+#      with the distribution.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+# FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+# COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+# INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+# BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+# ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+# POSSIBILITY OF SUCH DAMAGE.
+#
+
+# Capture the kernel statistics read by the Linux probes into a fixture tree
+# for symon-probebench -R or symon -R.
+#
+# usage: capture.sh <fixture directory>
+
+if [ $# -ne 1 ]; then
+    echo "usage: $0 <fixture directory>" >&2
+    exit 1
+fi
+
+root=$1
+mkdir -p $root/proc/net $root/sys/class/hwmon || exit 1
+
+# proc files report a size of 0; copy them by reading
+for f in stat meminfo diskstats partitions net/dev; do
+    [ -r /proc/$f ] && cat /proc/$f > $root/proc/$f
+done
+
+# hwmon sensor readings, names and labels, resolving the device links
+for d in /sys/class/hwmon/hwmon*; do
+    [ -d $d ] || continue
+    h=$root/sys/class/hwmon/`basename $d`
+    for s in $d/name $d/device/name $d/*_input $d/device/*_input \
+        $d/*_label $d/device/*_label; do
+        [ -r $s ] || continue
+        t=$h/${s#$d/}
+        mkdir -p `dirname $t`
+        cat $s > $t 2>/dev/null || rm -f $t
+    done
+done
+
+echo "captured `ls $root/proc | wc -l | tr -d ' '` proc files into $root"
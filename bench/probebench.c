@@ -0,0 +1,638 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Replay and scaling harness for the Linux probes.
+ *
+ * The probes read their kernel statistics below a configurable root (see
+ * lib/sysroot.c). This harness points that root at a fixture tree and runs
+ * every probe over all objects it finds there: every cpu in proc/stat, every
+ * interface in proc/net/dev, every disk in proc/diskstats. A tick is one gets
+ * and one get per stream, as symon would do it. Ticks are repeated for at
+ * least -t ms and the time per tick and per object is reported. The cpus
+ * probe measures all cpus with a single vector stream. The proc probe scans
+ * every process in proc/<pid>/stat with a stream per process group; ticks are
+ * timed once the processes outside the groups have been backed off.
+ *
+ * Without -R synthetic fixture trees of growing object counts are generated.
+ * The growth column shows the cost per object relative to the smallest tree;
+ * it stays near 1 for a probe that scales linearly. With -R a captured tree,
+ * see capture.sh, is replayed instead. -R / measures the live system, which
+ * is the only way to measure the netlink backend of the if probe.
+ *
+ * Every run happens in its own process as the probes keep their state in
+ * module globals.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "conf.h"
+#include "data.h"
+#include "error.h"
+#include "snapshot.h"
+#include "symon.h"
+#include "sysroot.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+#define BENCH_TIME      100     /* ms per run */
+#define BENCH_MINTICKS  3
+#define BENCH_SCALES    5
+#define BENCH_PROCGROUPS 4
+#define BENCH_PROCMATCH 1000    /* one in this many processes is grouped */
+#define BENCH_PROCWARMUP 128    /* ticks to back off ungrouped processes */
+
+struct probe {
+    char *name;
+    int type;
+    char *file;                 /* fixture file below root/proc */
+    void (*init) (struct stream *);
+    void (*gets) (void);
+    int (*get) (char *, int, struct stream *);
+    int (*objects) (char *, char ***);
+    int vector;                 /* a single stream measures all objects */
+    int groups;                 /* streams that share all objects */
+    int warmup;                 /* untimed ticks until a steady state */
+    void (*generate) (FILE *, int);
+    void (*tree) (char *, int); /* writes a fixture directory instead */
+    int scale[BENCH_SCALES];
+};
+
+struct result {
+    int objects;
+    int ticks;
+    double gets;                /* ns per gets */
+    double get;                 /* ns per get, over all streams */
+    double tick;                /* ns per tick */
+};
+
+__BEGIN_DECLS
+static void usage(void);
+static char *slurp(char *);
+static int objects_cpu(char *, char ***);
+static int objects_if(char *, char ***);
+static int objects_io(char *, char ***);
+static int objects_none(char *, char ***);
+static int objects_proc(char *, char ***);
+static void init_if_procfs(struct stream *);
+static void init_if_netlink(struct stream *);
+static void generate_stat(FILE *, int);
+static void generate_netdev(FILE *, int);
+static void generate_diskstats(FILE *, int);
+static void generate_meminfo(FILE *, int);
+static void generate_proc(char *, int);
+static void generate(char *, struct probe *, int);
+static void measure(char *, struct probe *, struct result *);
+static int run(char *, struct probe *, struct result *);
+static void report(struct probe *, struct result *, struct result *);
+static void removetree(char *);
+__END_DECLS
+
+struct probe probes[] = {
+    { "cpu", MT_CPU, "stat", init_cpu, gets_cpu, get_cpu,
+      objects_cpu, 0, 0, 0, generate_stat, NULL, { 1, 8, 64, 256, 512 } },
+    { "cpus", MT_CPUS, "stat", init_cpus, gets_cpus, get_cpus,
+      objects_cpu, 1, 0, 0, generate_stat, NULL, { 1, 8, 64, 256, 512 } },
+    { "cpuiow", MT_CPUIOW, "stat", init_cpuiow, gets_cpuiow, get_cpuiow,
+      objects_cpu, 0, 0, 0, generate_stat, NULL, { 1, 8, 64, 256, 512 } },
+    { "if", MT_IF2, "net/dev", init_if_procfs, gets_if, get_if,
+      objects_if, 0, 0, 0, generate_netdev, NULL, { 1, 16, 256, 1024, 5000 } },
+    { "if-netlink", MT_IF2, "net/dev", init_if_netlink, gets_if, get_if,
+      objects_if, 0, 0, 0, NULL, NULL, { 0 } },
+    { "io", MT_IO2, "diskstats", init_io, gets_io, get_io,
+      objects_io, 0, 0, 0, generate_diskstats, NULL,
+      { 1, 16, 256, 1024, 4096 } },
+    { "mem", MT_MEM2, "meminfo", init_mem, gets_mem, get_mem,
+      objects_none, 0, 0, 0, generate_meminfo, NULL, { 1 } },
+    { "proc", MT_PROC2, NULL, init_proc, gets_proc, get_proc,
+      objects_proc, 0, BENCH_PROCGROUPS, BENCH_PROCWARMUP, NULL, generate_proc,
+      { 100, 1000, 10000, 50000 } },
+    { NULL, 0, NULL, NULL, NULL, NULL, NULL, 0, 0, 0, NULL, NULL, { 0 } }
+};
+
+/* proc groups, as command name prefixes */
+static char *procgroups[BENCH_PROCGROUPS] = {
+    "postgres", "httpd", "sshd", "cron"
+};
+
+/* sm_proc.c rebuilds its groups for every new configuration */
+int symon_generation = 1;
+
+static int flag_machine = 0;
+static int benchtime = BENCH_TIME;
+
+static void
+usage(void)
+{
+    info("usage: %s [-m] [-t ms] [-R root] [probe ...]", __progname);
+    exit(EX_USAGE);
+}
+/* Read a fixture file into a nul terminated buffer */
+static char *
+slurp(char *path)
+{
+    char *buf;
+    size_t size, len;
+    FILE *f;
+
+    if ((f = fopen(path, "r")) == NULL)
+        return NULL;
+
+    size = SYMON_MAX_OBJSIZE;
+    buf = xmalloc(size);
+    len = 0;
+    while ((len += fread(buf + len, 1, size - len - 1, f)) == size - 1) {
+        size *= 2;
+        buf = xrealloc(buf, size);
+    }
+    buf[len] = '\0';
+    fclose(f);
+
+    return buf;
+}
+/* Objects are the arguments of the streams that measure them */
+static int
+objects_cpu(char *buf, char ***args)
+{
+    char *line;
+    int cpu, n;
+
+    *args = NULL;
+    for (n = 0, line = buf; line != NULL && *line; line = strchr(line, '\n')) {
+        if (*line == '\n')
+            line++;
+        if (strncmp(line, "cpu", 3) == 0 && isdigit((unsigned char) line[3]) &&
+            sscanf(line, "cpu%d ", &cpu) == 1) {
+            *args = xrealloc(*args, (n + 1) * sizeof(char *));
+            (*args)[n] = xmalloc(16);
+            snprintf((*args)[n++], 16, "%d", cpu);
+        }
+    }
+
+    return n;
+}
+static int
+objects_if(char *buf, char ***args)
+{
+    char name[SYMON_PS_ARGLENV2];
+    char *line, *eol, *p;
+    int n;
+
+    *args = NULL;
+    for (n = 0, line = buf; line != NULL && *line; line = strchr(line, '\n')) {
+        if (*line == '\n')
+            line++;
+        eol = strchr(line, '\n');
+        if ((p = strchr(line, ':')) == NULL || (eol != NULL && p > eol))
+            continue;
+        while (*line == ' ')
+            line++;
+        snprintf(name, sizeof(name), "%.*s", (int) (p - line), line);
+        *args = xrealloc(*args, (n + 1) * sizeof(char *));
+        (*args)[n++] = xstrdup(name);
+    }
+
+    return n;
+}
+static int
+objects_io(char *buf, char ***args)
+{
+    char name[SYMON_PS_ARGLENV2];
+    char *line;
+    int n;
+
+    *args = NULL;
+    for (n = 0, line = buf; line != NULL && *line; line = strchr(line, '\n')) {
+        if (*line == '\n')
+            line++;
+        if (sscanf(line, " %*u %*u %31s ", name) == 1) {
+            *args = xrealloc(*args, (n + 1) * sizeof(char *));
+            (*args)[n++] = xstrdup(name);
+        }
+    }
+
+    return n;
+}
+static int
+objects_none(char *buf, char ***args)
+{
+    *args = xmalloc(sizeof(char *));
+    (*args)[0] = NULL;
+
+    return 1;
+}
+/* Processes are the numeric entries below root/proc */
+static int
+objects_proc(char *buf, char ***args)
+{
+    struct dirent *d;
+    DIR *dir;
+    int n;
+
+    if ((dir = opendir(procfs_root)) == NULL)
+        fatal("cannot read %.200s: %.200s", procfs_root, strerror(errno));
+    for (n = 0; (d = readdir(dir)) != NULL;)
+        if (isdigit((unsigned char) d->d_name[0]))
+            n++;
+    closedir(dir);
+
+    if (n == 0)
+        fatal("no processes below %.200s", procfs_root);
+
+    *args = procgroups;
+
+    return n;
+}
+/* The if probe backends; netlink can only be measured live, with -R / */
+static void
+init_if_procfs(struct stream *st)
+{
+    if_backend = IF_BACKEND_PROCFS;
+    init_if(st);
+}
+static void
+init_if_netlink(struct stream *st)
+{
+    if_backend = IF_BACKEND_NETLINK;
+    init_if(st);
+}
+/* Synthetic fixtures; counters differ per object to defeat any caching */
+static void
+generate_stat(FILE *f, int n)
+{
+    int i;
+
+    fprintf(f, "cpu  %d 100 %d 900000 300 0 200 0 0 0\n", 1000 * n, 500 * n);
+    for (i = 0; i < n; i++)
+        fprintf(f, "cpu%d %d 10 %d 90000 30 0 20 0 0 0\n", i, 1000 + i, 500 + i);
+    fprintf(f, "intr 123456789 0 9 0 0 0 0 0 0 0 1 0 0 156 0 0 0\n"
+            "ctxt 987654321\nbtime 1700000000\nprocesses 123456\n"
+            "procs_running 2\nprocs_blocked 0\nsoftirq 1 2 3 4 5 6 7 8 9 10 11\n");
+}
+static void
+generate_netdev(FILE *f, int n)
+{
+    int i;
+
+    fprintf(f, "Inter-|   Receive                            "
+            "                    |  Transmit\n"
+            " face |bytes    packets errs drop fifo frame compressed multicast"
+            "|bytes    packets errs drop fifo colls carrier compressed\n");
+    /* veth0 before eth0; a substring match of eth0 finds the wrong one */
+    for (i = 0; i < n; i++)
+        fprintf(f, "%6s%d: %llu %d 0 0 0 0 0 %d %llu %d 0 0 0 0 0 0\n",
+                (i % 2) ? "eth" : "veth", i / 2, 1000000ULL * (i + 1),
+                10000 + i, i, 2000000ULL * (i + 1), 20000 + i);
+}
+static void
+generate_diskstats(FILE *f, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        fprintf(f, "%4d %7d nvme%dn1 %d 10 %d 400 %d 20 %d 800 0 1200 1600\n",
+                259, i, i, 1000 + i, 80000 + i, 2000 + i, 160000 + i);
+}
+static void
+generate_meminfo(FILE *f, int n)
+{
+    fprintf(f, "MemTotal:       16318400 kB\n"
+            "MemFree:         8123456 kB\n"
+            "MemAvailable:   12345678 kB\n"
+            "Buffers:          234567 kB\n"
+            "Cached:          3456789 kB\n"
+            "SwapCached:            0 kB\n"
+            "Active:          4567890 kB\n"
+            "Inactive:        2345678 kB\n"
+            "SwapTotal:       2097148 kB\n"
+            "SwapFree:        2097148 kB\n"
+            "Dirty:               128 kB\n");
+}
+static void
+generate_proc(char *root, int n)
+{
+    char path[MAX_PATH_LEN];
+    char comm[32];
+    FILE *f;
+    int i, pid;
+
+    for (i = 0; i < n; i++) {
+        pid = 1000 + i;
+        if (i % BENCH_PROCMATCH == 0)
+            snprintf(comm, sizeof(comm), "%s",
+                     procgroups[(i / BENCH_PROCMATCH) % BENCH_PROCGROUPS]);
+        else
+            snprintf(comm, sizeof(comm), "kworker/%d", i);
+
+        snprintf(path, sizeof(path), "%s/proc/%d", root, pid);
+        mkdir(path, 0700);
+        snprintf(path, sizeof(path), "%s/proc/%d/stat", root, pid);
+        if ((f = fopen(path, "w")) == NULL)
+            fatal("cannot create %.200s: %.200s", path, strerror(errno));
+        fprintf(f, "%d (%s) S 1 %d %d 0 -1 4194560 %d 0 0 0 %d %d 0 0 20 0 1 0 "
+                "%d %llu %d 18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 "
+                "%d 0 0 0 0 0\n", pid, comm, pid, pid, 100 + i, 1000 + i,
+                500 + i, 100 + i, 1073741824ULL * (1 + i % 8), 2000 + i,
+                i % 64);
+        fclose(f);
+    }
+}
+/* Write a fixture tree with n objects for a probe */
+static void
+generate(char *root, struct probe *probe, int n)
+{
+    char path[MAX_PATH_LEN];
+    FILE *f;
+
+    snprintf(path, sizeof(path), "%s/proc", root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/proc/net", root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/sys", root);
+    mkdir(path, 0700);
+
+    if (probe->tree != NULL) {
+        probe->tree(root, n);
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s/proc/%s", root, probe->file);
+    if ((f = fopen(path, "w")) == NULL)
+        fatal("cannot create %.200s: %.200s", path, strerror(errno));
+    probe->generate(f, n);
+    fclose(f);
+}
+/* Initialise a stream per object in the tree and time ticks over them */
+static void
+measure(char *root, struct probe *probe, struct result *r)
+{
+    char path[MAX_PATH_LEN];
+    char buf[SYMON_MAXPACKET];
+    struct stream *streams;
+    u_int64_t start, t, gets, get;
+    char **args;
+    char *fixture;
+    int stdout_fd, null_fd;
+    int i, n, objects;
+
+    set_sysroot(root);
+    fixture = NULL;
+    if (probe->file != NULL) {
+        snprintf(path, sizeof(path), "%s/%s", procfs_root, probe->file);
+        if ((fixture = slurp(path)) == NULL)
+            fatal("cannot read %.200s: %.200s", path, strerror(errno));
+    }
+    n = objects = probe->objects(fixture, &args);
+    if (fixture != NULL)
+        xfree(fixture);
+
+    /* a vector probe measures all objects with one stream, a group probe
+     * with a stream per group */
+    if (probe->vector && objects > 0) {
+        for (i = 0; i < objects; i++)
+            xfree(args[i]);
+        args[0] = "";
+        n = 1;
+    } else if (probe->groups > 0) {
+        n = probe->groups;
+    }
+
+    streams = xmalloc(n * sizeof(struct stream));
+    bzero(streams, n * sizeof(struct stream));
+
+    /* silence the started module messages */
+    fflush(stdout);
+    stdout_fd = dup(STDOUT_FILENO);
+    if ((null_fd = open("/dev/null", O_WRONLY)) >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    for (i = 0; i < n; i++) {
+        streams[i].type = probe->type;
+        streams[i].arg = args[i];
+        probe->init(&streams[i]);
+    }
+    fflush(stdout);
+    dup2(stdout_fd, STDOUT_FILENO);
+    close(stdout_fd);
+
+    for (i = 0; i < probe->warmup; i++) {
+        tick_snapshots();
+        probe->gets();
+    }
+
+    r->objects = objects;
+    gets = get = 0;
+    start = clock_nsec(CLOCK_MONOTONIC);
+    for (r->ticks = 0;
+         r->ticks < BENCH_MINTICKS ||
+         clock_nsec(CLOCK_MONOTONIC) - start < (u_int64_t) benchtime * 1000000;
+         r->ticks++) {
+        t = clock_nsec(CLOCK_MONOTONIC);
+        tick_snapshots();
+        probe->gets();
+        gets += clock_nsec(CLOCK_MONOTONIC) - t;
+
+        t = clock_nsec(CLOCK_MONOTONIC);
+        for (i = 0; i < n; i++)
+            if (probe->get(buf, sizeof(buf), &streams[i]) == 0)
+                fatal("%.200s(%.200s): no data", probe->name, streams[i].arg);
+        get += clock_nsec(CLOCK_MONOTONIC) - t;
+    }
+
+    r->gets = (double) gets / r->ticks;
+    r->get = (double) get / r->ticks;
+    r->tick = r->gets + r->get;
+}
+/* Measure in a child; probes cannot be reset once initialised */
+static int
+run(char *root, struct probe *probe, struct result *r)
+{
+    int fds[2];
+    int status;
+    pid_t pid;
+
+    if (pipe(fds) != 0)
+        fatal("pipe failed: %.200s", strerror(errno));
+
+    if ((pid = fork()) == -1)
+        fatal("fork failed: %.200s", strerror(errno));
+
+    if (pid == 0) {
+        close(fds[0]);
+        measure(root, probe, r);
+        if (write(fds[1], r, sizeof(struct result)) != sizeof(struct result))
+            fatal("cannot report result: %.200s", strerror(errno));
+        _exit(EX_OK);
+    }
+
+    close(fds[1]);
+    bzero(r, sizeof(struct result));
+    status = read(fds[0], r, sizeof(struct result));
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    return (status == sizeof(struct result));
+}
+static void
+report(struct probe *probe, struct result *r, struct result *base)
+{
+    double growth;
+
+    growth = (r->tick / r->objects) / (base->tick / base->objects);
+
+    if (flag_machine)
+        printf("%s\t%d\t%d\t%.0f\t%.0f\t%.0f\t%.1f\t%.2f\n", probe->name,
+               r->objects, r->ticks, r->gets, r->get, r->tick,
+               r->tick / r->objects, growth);
+    else
+        printf("%-10s %6d objects %8d ticks %12.0f ns/tick %10.1f ns/object %6.1fx%s\n",
+               probe->name, r->objects, r->ticks, r->tick,
+               r->tick / r->objects, growth,
+               (growth > 4.0) ? "  superlinear" : "");
+    fflush(stdout);
+}
+static void
+removetree(char *root)
+{
+    char path[MAX_PATH_LEN];
+    struct probe *probe;
+    struct dirent *d;
+    DIR *dir;
+
+    for (probe = probes; probe->name != NULL; probe++) {
+        if (probe->file == NULL)
+            continue;
+        snprintf(path, sizeof(path), "%s/proc/%s", root, probe->file);
+        unlink(path);
+    }
+
+    snprintf(path, sizeof(path), "%s/proc", root);
+    if ((dir = opendir(path)) != NULL) {
+        while ((d = readdir(dir)) != NULL) {
+            if (!isdigit((unsigned char) d->d_name[0]))
+                continue;
+            snprintf(path, sizeof(path), "%s/proc/%s/stat", root, d->d_name);
+            unlink(path);
+            snprintf(path, sizeof(path), "%s/proc/%s", root, d->d_name);
+            rmdir(path);
+        }
+        closedir(dir);
+    }
+    snprintf(path, sizeof(path), "%s/proc/net", root);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/proc", root);
+    rmdir(path);
+    snprintf(path, sizeof(path), "%s/sys", root);
+    rmdir(path);
+    rmdir(root);
+}
+int
+main(int argc, char *argv[])
+{
+    char tmpl[MAX_PATH_LEN];
+    struct result r, base;
+    struct probe *probe;
+    char *fixtures = NULL;
+    char *root;
+    int ch;
+    int i;
+
+    while ((ch = getopt(argc, argv, "mR:t:")) != -1) {
+        switch (ch) {
+        case 'm':
+            flag_machine = 1;
+            break;
+        case 'R':
+            fixtures = optarg;
+            break;
+        case 't':
+            if ((benchtime = atoi(optarg)) <= 0)
+                usage();
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (flag_machine)
+        printf("# probe\tobjects\tticks\tns_gets\tns_get\tns_tick\tns_per_object\tgrowth\n");
+
+    for (probe = probes; probe->name != NULL; probe++) {
+        if (optind < argc) {
+            for (i = optind; i < argc; i++)
+                if (strcmp(probe->name, argv[i]) == 0)
+                    break;
+            if (i == argc)
+                continue;
+        }
+
+        if (fixtures != NULL) {
+            if (run(fixtures, probe, &r))
+                report(probe, &r, &r);
+            else
+                warning("%.200s: no result for fixture %.200s", probe->name, fixtures);
+            continue;
+        }
+
+        if (probe->generate == NULL && probe->tree == NULL)
+            continue;
+
+        for (i = 0; i < BENCH_SCALES && probe->scale[i] > 0; i++) {
+            snprintf(tmpl, sizeof(tmpl), "%s/probebench.XXXXXX",
+                     getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+            if ((root = mkdtemp(tmpl)) == NULL)
+                fatal("cannot create fixture directory: %.200s", strerror(errno));
+
+            generate(root, probe, probe->scale[i]);
+            if (run(root, probe, &r)) {
+                if (i == 0)
+                    base = r;
+                report(probe, &r, &base);
+            } else
+                warning("%.200s/%d: no result", probe->name, probe->scale[i]);
+            removetree(root);
+        }
+    }
+
+    return (EX_OK);
+}
@@ -59,6 +59,8 @@ my $streamitem =
 	        debug18 => 18, debug19 => 19},
      proc   => {number => 1, uticks => 2, sticks => 3, iticks => 4, cpusec => 5,
 	        cpupct => 6, procsz => 7, rsssz => 8},
+     proc1  => {number => 1, uticks => 2, sticks => 3, iticks => 4, cpusec => 5,
+	        cpupct => 6, procsz => 7, rsssz => 8},
      mbuf   => {totmbufs => 1, mt_data => 2, mt_oobdata => 3, mt_control => 4,
 	        mt_header => 5, mt_ftable => 6, mt_soname => 7, mt_soopts => 8,
 	        pgused => 9, pgtotal => 10, totmem => 11, totpct => 12,
@@ -74,8 +76,26 @@ my $streamitem =
                 air_flow_temp => 4, temperature => 5, reallocations => 6,
                 current_pending => 7, uncorrectables => 8,
                 soft_read_error_rate => 9, g_sense_error_rate => 10,
-                temperature2 => 10, free_fall_protection => 11},
-     load   => {load1 => 1, load5 => 2, load15 => 3}
+                temperature2 => 11, free_fall_protection => 12, age => 13},
+     smart1 => {read_error_rate => 1, reallocated_sectors => 2, spin_retries => 3,
+                air_flow_temp => 4, temperature => 5, reallocations => 6,
+                current_pending => 7, uncorrectables => 8,
+                soft_read_error_rate => 9, g_sense_error_rate => 10,
+                temperature2 => 11, free_fall_protection => 12},
+     nvme   => {critical_warning => 1, temperature => 2, available_spare => 3,
+                percentage_used => 4, data_read => 5, data_written => 6,
+                power_cycles => 7, power_on_hours => 8, unsafe_shutdowns => 9,
+                media_errors => 10, error_log_entries => 11},
+     cgroup => {cpu_usage => 1, cpu_user => 2, cpu_system => 3,
+                nr_throttled => 4, throttled => 5, mem_current => 6,
+                mem_anon => 7, mem_file => 8, pgmajfault => 9, rbytes => 10,
+                wbytes => 11, rios => 12, wios => 13, pids => 14},
+     psi    => {some10 => 1, some60 => 2, some300 => 3, some => 4,
+                full10 => 5, full60 => 6, full300 => 7, full => 8},
+     load   => {load1 => 1, load5 => 2, load15 => 3},
+     self   => {calls => 1, wall => 2, cpu => 3, max => 4, bytes => 5,
+		errors => 6, h10us => 7, h100us => 8, h1ms => 9, h10ms => 10,
+		h100ms => 11, h1s => 12, hslow => 13}
 };
 
 sub new {
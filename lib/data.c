@@ -55,12 +55,16 @@
 #include "xmalloc.h"
 
 __BEGIN_DECLS
+int bytelenform(char *);
 int bytelenvar(char);
 int checklen(int, int, int);
 struct stream *create_stream(int, char *);
 char *formatstrvar(char);
+int packid(char *, int, char *, int);
+int packvars(char *, char *, int, int, va_list);
 char *rrdstrvar(char);
 int strlenvar(char);
+char *unpackvars(char *, char *, char *);
 __END_DECLS
 
 /* Stream formats
@@ -73,6 +77,9 @@ __END_DECLS
  * s = u_int16
  * c = 3.2f <= u_int14 <= u_int16  (used in percentages)
  * b = u_int8
+ *
+ * A form that starts with '*' is a vector: a u_int16 count followed by count
+ * elements of the remaining form.
  */
 struct {
     char type;
@@ -114,9 +121,25 @@ struct {
     { MT_LOAD, "ccc" },
     { MT_FLUKSO, "D" },
     { MT_TEST, "LLLLDDDDllllssssccccbbbb" },
+    { MT_SELF, "LLLLLLLLLLLLL" },
+    { MT_CPUS, "*ccccc" },       /* vector of MT_CPU */
+    { MT_SMART2, "bbbbbbbbbbbbl" },
+    { MT_NVME, "bDbbLLLLLLL" },
+    { MT_PROC2, "lLLLlcLL" },
+    { MT_CGROUP, "LLLLLLLLLLLLLL" },
+    { MT_PSI, "cccLcccL" },
     { MT_EOT, "" }
 };
 
+/* vector streams of <type> carry elements of <elemtype> */
+struct {
+    int type;
+    int elemtype;
+} streamvector[] = {
+    { MT_CPUS, MT_CPU },
+    { MT_EOT, MT_EOT }
+};
+
 struct {
     int type;
     int token;
@@ -127,7 +150,7 @@ struct {
     { MT_IF1, LXT_IF1 },
     { MT_PF, LXT_PF },
     { MT_DEBUG, LXT_DEBUG },
-    { MT_PROC, LXT_PROC },
+    { MT_PROC, LXT_PROC1 },
     { MT_MBUF, LXT_MBUF },
     { MT_SENSOR, LXT_SENSOR },
     { MT_IO2, LXT_IO },
@@ -136,9 +159,17 @@ struct {
     { MT_MEM2, LXT_MEM },
     { MT_IF2, LXT_IF },
     { MT_CPUIOW, LXT_CPUIOW },
-    { MT_SMART, LXT_SMART },
+    { MT_SMART, LXT_SMART1 },
     { MT_LOAD, LXT_LOAD },
     { MT_FLUKSO, LXT_FLUKSO },
+    { MT_TEST, LXT_TEST },
+    { MT_SELF, LXT_SELF },
+    { MT_CPUS, LXT_CPUS },
+    { MT_SMART2, LXT_SMART },
+    { MT_NVME, LXT_NVME },
+    { MT_PROC2, LXT_PROC },
+    { MT_CGROUP, LXT_CGROUP },
+    { MT_PSI, LXT_PSI },
     { MT_EOT, LXT_BADTOKEN }
 };
 /* parallel crc32 table */
@@ -177,6 +208,28 @@ type2str(const int streamtype)
     /* NOT REACHED */
     return 0;
 }
+/* Return the packedstream form of type <type> */
+char *
+type2form(const int type)
+{
+    if (type < 0 || type >= MT_EOT)
+        fatal("%s:%d: internal error: type (%d) out of range",
+              __FILE__, __LINE__, type);
+
+    return streamform[type].form;
+}
+/* Return the type of the elements of vector stream <type>, or -1 */
+int
+type2elem(const int type)
+{
+    int i;
+
+    for (i = 0; streamvector[i].type < MT_EOT; i++)
+        if (streamvector[i].type == type)
+            return streamvector[i].elemtype;
+
+    return -1;
+}
 /* Return the maximum lenght of the ascii representation of type <type> */
 int
 strlentype(int type)
@@ -184,6 +237,10 @@ strlentype(int type)
     int i = 0;
     int sum = 0;
 
+    /* vectors are offered per element */
+    if (streamform[type].form[i] == '*')
+        i++;
+
     while (streamform[type].form[i])
         sum += strlenvar(streamform[type].form[i++]);
 
@@ -221,6 +278,17 @@ bytelenvar(char var)
     /* NOT REACHED */
     return 0;
 }
+/* Return the length of the network representation of <form> */
+int
+bytelenform(char *form)
+{
+    int len = 0;
+
+    while (*form)
+        len += bytelenvar(*form++);
+
+    return len;
+}
 /* Return the ascii format string for streamvar <var> */
 char *
 formatstrvar(char var)
@@ -310,6 +378,41 @@ getheader(char *buf, struct symonpacketheader *hph)
 
     return (p - buf);
 }
+int
+setsampleheader(char *buf, struct symonsampleheader *hsh)
+{
+    struct symonsampleheader nsh;
+    char *p;
+
+    nsh.offset = htonl(hsh->offset);
+    nsh.length = htons(hsh->length);
+
+    p = buf;
+
+    bcopy(&nsh.offset, p, sizeof(u_int32_t));
+    p += sizeof(u_int32_t);
+    bcopy(&nsh.length, p, sizeof(u_int16_t));
+    p += sizeof(u_int16_t);
+
+    return (p - buf);
+}
+int
+getsampleheader(char *buf, struct symonsampleheader *hsh)
+{
+    char *p;
+
+    p = buf;
+
+    bcopy(p, &hsh->offset, sizeof(u_int32_t));
+    p += sizeof(u_int32_t);
+    bcopy(p, &hsh->length, sizeof(u_int16_t));
+    p += sizeof(u_int16_t);
+
+    hsh->offset = ntohl(hsh->offset);
+    hsh->length = ntohs(hsh->length);
+
+    return (p - buf);
+}
 /*
  * Pack multiple arguments of a MT_TYPE into a network order bytestream.
  * snpack returns the number of bytes actually stored.
@@ -354,22 +457,76 @@ snpack2(char *buf, int maxlen, char *id, int type, ...)
 int
 snpackx(size_t maxarglen, char *buf, int maxlen, char *id, int type, va_list ap)
 {
-    u_int16_t b;
-    u_int16_t s;
-    u_int16_t c;
-    u_int32_t l;
-    u_int64_t q;
-    int64_t d;
-    double D;
-    int i = 0;
-    int offset = 0;
-    int arglen = 0;
+    int offset;
 
     if (type < 0 || type >= MT_EOT) {
         warning("stream type (%d) out of range", type);
         return 0;
     }
 
+    if (streamform[type].form[0] == '*') {
+        warning("stream type (%d) is a vector", type);
+        return 0;
+    }
+
+    if ((offset = packid(buf, maxlen, id, type)) < 0)
+        return -offset;
+
+    return packvars(streamform[type].form, buf, maxlen, offset, ap);
+}
+/*
+ * Pack the type, id and element count of a vector stream. The caller packs
+ * the <count> elements that follow with snpackelem. snpackv returns the
+ * number of bytes stored, or 0 if the whole vector does not fit.
+ */
+int
+snpackv(char *buf, int maxlen, char *id, int type, int count)
+{
+    u_int16_t s;
+    int offset;
+
+    if (type < 0 || type >= MT_EOT || streamform[type].form[0] != '*') {
+        warning("stream type (%d) is not a vector", type);
+        return 0;
+    }
+
+    if ((offset = packid(buf, maxlen, id, type)) < 0)
+        return 0;
+
+    if (count < 0 || count > 0xffff ||
+        checklen(maxlen, offset,
+                 sizeof(u_int16_t) + count * bytelenform(streamform[type].form + 1)))
+        return 0;
+
+    s = htons(count);
+    bcopy(&s, buf + offset, sizeof(u_int16_t));
+    offset += sizeof(u_int16_t);
+
+    return offset;
+}
+/* Pack a single element of vector stream <type>; returns the bytes stored */
+int
+snpackelem(char *buf, int maxlen, int type, ...)
+{
+    int result;
+    va_list ap;
+
+    va_start(ap, type);
+    result = packvars(streamform[type].form + 1, buf, maxlen, 0, ap);
+    va_end(ap);
+
+    return result;
+}
+/*
+ * Pack the type and id of a stream. Returns the offset after the id, or minus
+ * the offset reached if the id did not fit.
+ */
+int
+packid(char *buf, int maxlen, char *id, int type)
+{
+    int offset = 0;
+    int arglen = 0;
+
     if (maxlen < 2) {
         fatal("%s:%d: maxlen too small", __FILE__, __LINE__);
     } else {
@@ -384,14 +541,33 @@ snpackx(size_t maxarglen, char *buf, int maxlen, char *id, int type, va_list ap)
     }
 
     if (checklen(maxlen, offset, arglen)) {
-        return offset;
+        return -offset;
     } else {
         strncpy(&buf[offset], id, arglen);
+        buf[offset + arglen] = '\0';
         offset += arglen + 1;
     }
 
-    while (streamform[type].form[i] != '\0') {
-        if (checklen(maxlen, offset, bytelenvar(streamform[type].form[i])))
+    return offset;
+}
+/*
+ * Pack the arguments in <ap> as described by <form> at <offset> in buf.
+ * Returns the offset reached, or 0 for an unknown form.
+ */
+int
+packvars(char *form, char *buf, int maxlen, int offset, va_list ap)
+{
+    u_int16_t b;
+    u_int16_t s;
+    u_int16_t c;
+    u_int32_t l;
+    u_int64_t q;
+    int64_t d;
+    double D;
+    int i = 0;
+
+    while (form[i] != '\0') {
+        if (checklen(maxlen, offset, bytelenvar(form[i])))
             return offset;
 
         /*
@@ -400,7 +576,7 @@ snpackx(size_t maxarglen, char *buf, int maxlen, char *id, int type, va_list ap)
          * compiler decided to upgrade our short to a 32bit int. -- cheers
          * dhartmei@openbsd.org
          */
-        switch (streamform[type].form[i]) {
+        switch (form[i]) {
         case 'b':
             b = va_arg(ap, int);
             buf[offset++] = b;
@@ -444,9 +620,8 @@ snpackx(size_t maxarglen, char *buf, int maxlen, char *id, int type, va_list ap)
             break;
 
         default:
-            warning("unknown stream format identifier %c in type %d",
-                    streamform[type].form[i],
-                    type);
+            warning("unknown stream format identifier %c in form %.200s",
+                    form[i], form);
             return 0;
         }
         i++;
@@ -462,6 +637,10 @@ snpackx(size_t maxarglen, char *buf, int maxlen, char *id, int type, va_list ap)
  * description of the packedstream (streamform) to parse the actual bytes. This
  * description corresponds to the amount of bytes that will fit inside the
  * packedstream structure.
+ *
+ * The elements of a vector stream are left in buf; ps_vector points at them
+ * and sunpackelem unpacks them one by one. Callers need to check that the
+ * bytes read do not extend beyond their buffer.
  * TODO do more explicit bounds checking
  */
 int
@@ -483,14 +662,9 @@ sunpack2(char *buf, struct packedstream *ps)
 int
 sunpackx(size_t arglen, char *buf, struct packedstream *ps)
 {
-    char *in, *out;
-    int i = 0;
+    char *in;
     int type;
     u_int16_t s;
-    u_int16_t c;
-    u_int32_t l;
-    u_int64_t q;
-    int64_t d;
 
     bzero(ps, sizeof(struct packedstream));
 
@@ -512,10 +686,56 @@ sunpackx(size_t arglen, char *buf, struct packedstream *ps)
         in++;
     }
 
-    out = (char *) (&ps->data);
+    if (streamform[type].form[0] == '*') {
+        bcopy((void *) in, &s, sizeof(u_int16_t));
+        in += sizeof(u_int16_t);
+        ps->data.ps_vector.count = ntohs(s);
+        ps->data.ps_vector.elems = in;
+        in += ps->data.ps_vector.count * bytelenform(streamform[type].form + 1);
+    } else if ((in = unpackvars(streamform[type].form, in,
+                                (char *) (&ps->data))) == NULL) {
+        warning("unknown stream format in type %d", type);
+        return 0;
+    }
+
+    return (in - buf);
+}
+/*
+ * Unpack element <index> of vector packedstream <ps> into <eps>. The element
+ * is a stream of the element type with its index as argument. Returns 0 if
+ * there is no such element.
+ */
+int
+sunpackelem(struct packedstream *ps, int index, struct packedstream *eps)
+{
+    char *form;
+
+    if (index < 0 || index >= ps->data.ps_vector.count ||
+        (eps->type = type2elem(ps->type)) == -1)
+        return 0;
 
-    while (streamform[type].form[i] != '\0') {
-        switch (streamform[type].form[i]) {
+    form = streamform[ps->type].form + 1;
+    snprintf(eps->arg, sizeof(eps->arg), "%d", index);
+
+    return (unpackvars(form, ps->data.ps_vector.elems + index * bytelenform(form),
+                       (char *) (&eps->data)) != NULL);
+}
+/*
+ * Unpack the network representation of <form> from <in> to <out>. Returns the
+ * next byte to read, or NULL for an unknown form.
+ */
+char *
+unpackvars(char *form, char *in, char *out)
+{
+    u_int16_t s;
+    u_int16_t c;
+    u_int32_t l;
+    u_int64_t q;
+    int64_t d;
+    int i = 0;
+
+    while (form[i] != '\0') {
+        switch (form[i]) {
         case 'b':
             bcopy((void *) in, (void *) out, sizeof(u_int8_t));
             in++;
@@ -563,14 +783,13 @@ sunpackx(size_t arglen, char *buf, struct packedstream *ps)
             break;
 
         default:
-            warning("unknown stream format identifier %c in type %d",
-                    streamform[type].form[i],
-                    type);
-            return 0;
+            warning("unknown stream format identifier %c in form %.200s",
+                    form[i], form);
+            return NULL;
         }
         i++;
     }
-    return (in - buf);
+    return in;
 }
 /* Get the RRD or 'pretty' ascii representation of packedstream */
 int
@@ -587,10 +806,23 @@ ps2strn(struct packedstream * ps, char *buf, const int maxlen, int pretty)
     char *formatstr;
     char *in, *out;
     char vartype;
+    struct packedstream eps;
+    int len;
 
     in = (char *) (&ps->data);
     out = (char *) buf;
 
+    /* vectors are the concatenation of their elements */
+    if (streamform[ps->type].form[0] == '*') {
+        for (i = 0; i < ps->data.ps_vector.count; i++) {
+            if (!sunpackelem(ps, i, &eps) ||
+                (len = ps2strn(&eps, out, maxlen - (out - buf), pretty)) == 0)
+                return 0;
+            out += len;
+        }
+        return (out - buf);
+    }
+
     while ((vartype = streamform[ps->type].form[i]) != '\0') {
         /* check buffer overflow */
         if (checklen(maxlen, (out - buf), strlenvar(vartype)))
@@ -669,6 +901,7 @@ create_stream(int type, char *args)
     p = (struct stream *) xmalloc(sizeof(struct stream));
     bzero(p, sizeof(struct stream));
     p->type = type;
+    p->wakefd = -1;
 
     if (args != NULL)
         p->arg = xstrdup(args);
@@ -747,6 +980,44 @@ add_mux_stream(struct mux * mux, int type, char *args)
 
     return p;
 }
+/* Add a wildcard stream, whose argument is a pattern, to a mux */
+struct stream *
+add_mux_wildcard(struct mux * mux, int type, char *pattern)
+{
+    struct stream *p;
+
+    if (mux == NULL || pattern == NULL)
+        return NULL;
+
+    SLIST_FOREACH(p, &mux->wl, streams)
+        if (p->type == type && strcmp(pattern, p->arg) == 0)
+            return NULL;
+
+    p = create_stream(type, pattern);
+
+    SLIST_INSERT_HEAD(&mux->wl, p, streams);
+
+    return p;
+}
+/* Add a wildcard stream, whose argument is a pattern, to a source */
+struct stream *
+add_source_wildcard(struct source * source, int type, char *pattern)
+{
+    struct stream *p;
+
+    if (source == NULL || pattern == NULL)
+        return NULL;
+
+    SLIST_FOREACH(p, &source->wl, streams)
+        if (p->type == type && strcmp(pattern, p->arg) == 0)
+            return NULL;
+
+    p = create_stream(type, pattern);
+
+    SLIST_INSERT_HEAD(&source->wl, p, streams);
+
+    return p;
+}
 /* Find a source by name in a sourcelist */
 struct source *
 find_source(struct sourcelist * sol, char *name)
@@ -874,6 +1145,8 @@ free_muxlist(struct muxlist * mul)
             xfree(p->addr);
         if (p->port != NULL)
             xfree(p->port);
+        if (p->metricsdir != NULL)
+            xfree(p->metricsdir);
         if (p->clientsocket)
             close(p->clientsocket);
         if (p->symuxsocket)
@@ -886,6 +1159,7 @@ free_muxlist(struct muxlist * mul)
                 close(p->symonsocket[i]);
 
         free_streamlist(&p->sl);
+        free_streamlist(&p->wl);
         free_sourcelist(&p->sol);
         xfree(p);
 
@@ -896,6 +1170,7 @@ void
 free_streamlist(struct streamlist * sl)
 {
     struct stream *p, *np;
+    char **e;
 
     if (sl == NULL || SLIST_EMPTY(sl))
         return;
@@ -907,8 +1182,15 @@ free_streamlist(struct streamlist * sl)
 
         if (p->arg != NULL)
             xfree(p->arg);
+        if (p->exclude != NULL) {
+            for (e = p->exclude; *e != NULL; e++)
+                xfree(*e);
+            xfree(p->exclude);
+        }
         if (p->file != NULL)
             xfree(p->file);
+        if (p->pbuf != NULL)
+            xfree(p->pbuf);
         xfree(p);
 
         p = np;
@@ -930,7 +1212,11 @@ free_sourcelist(struct sourcelist * sol)
         if (p->addr != NULL)
             xfree(p->addr);
 
+        if (p->datadir != NULL)
+            xfree(p->datadir);
+
         free_streamlist(&p->sl);
+        free_streamlist(&p->wl);
         xfree(p);
 
         p = np;
@@ -944,11 +1230,25 @@ bytelen_streamlist(struct streamlist * sl)
 {
     struct stream *stream;
     int len = 0;
+
+    SLIST_FOREACH(stream, sl, streams)
+        len += bytelen_stream(stream);
+
+    return len;
+}
+/* Calculate maximum buffer space needed for a single packed stream */
+int
+bytelen_stream(struct stream * stream)
+{
+    int len = 0;
     int i;
 
-    SLIST_FOREACH(stream, sl, streams) {
-        len += 1; /* type */
-        len += strlen(stream->arg) + 1; /* arg */
+    len += 1; /* type */
+    len += strlen(stream->arg) + 1; /* arg */
+    if (streamform[stream->type].form[0] == '*') { /* vector */
+        len += sizeof(u_int16_t);
+        len += stream->count * bytelenform(streamform[stream->type].form + 1);
+    } else {
         for (i = 0; streamform[stream->type].form[i] != 0; i++) /* packedstream */
             len += bytelenvar(streamform[stream->type].form[i]);
     }
@@ -1001,6 +1301,14 @@ strlen_sourcelist(struct sourcelist * sol)
             len += strlentype(stream->type);
             n++;
         }
+        /* streams accepted by wildcards can have arguments of any length */
+        SLIST_FOREACH(stream, &source->wl, streams) {
+            len += stream->limit *
+                (strlen(type2str(stream->type)) + strlen(":") +
+                 SYMON_PS_ARGLENV2 + strlen(":") +
+                 (sizeof(time_t) * 3) + strlen(":") +
+                 strlentype(stream->type));
+        }
         if (len > maxlen)
             maxlen = len;
     }
@@ -1009,18 +1317,35 @@ strlen_sourcelist(struct sourcelist * sol)
 void
 init_symon_packet(struct mux * mux)
 {
-    if (mux->packet.data)
-        xfree(mux->packet.data);
+    char *old;
+    u_int32_t keep;
+
+    /* samples of a batch that is not yet sent survive a resize */
+    old = mux->packet.data;
+    keep = (old != NULL && mux->samples > 0) ? mux->packet.offset : 0;
+
+    mux->packet.size = sizeof(struct symonpacketheader);
+    if (mux->batch > 1)
+        mux->packet.size += mux->batch *
+            (sizeof(struct symonsampleheader) + bytelen_streamlist(&mux->sl));
+    else
+        mux->packet.size += bytelen_streamlist(&mux->sl);
 
-    mux->packet.size = sizeof(struct symonpacketheader) +
-        bytelen_streamlist(&mux->sl);
     if (mux->packet.size > SYMON_MAXPACKET) {
         warning("transport max packet size is not enough to transport all streams");
         mux->packet.size = SYMON_MAXPACKET;
     }
+    if (keep > mux->packet.size)
+        mux->packet.size = keep;
+
     mux->packet.data = xmalloc(mux->packet.size);
     bzero(mux->packet.data, mux->packet.size);
 
+    if (old != NULL) {
+        bcopy(old, mux->packet.data, keep);
+        xfree(old);
+    }
+
     debug("symon packet size=%d", mux->packet.size);
 }
 void
@@ -1029,9 +1354,9 @@ init_symux_packet(struct mux * mux)
     if (mux->packet.data)
         xfree(mux->packet.data);
 
-    /* determine optimal packet size */
-    mux->packet.size = sizeof(struct symonpacketheader) +
-        bytelen_sourcelist(&mux->sol);
+    /* determine optimal packet size; sources may batch samples */
+    mux->packet.size = sizeof(struct symonpacketheader) + SYMON_MAXBATCH *
+        (sizeof(struct symonsampleheader) + bytelen_sourcelist(&mux->sol));
     if (mux->packet.size > SYMON_MAXPACKET) {
         warning("transport max packet size is not enough to transport all streams");
         mux->packet.size = SYMON_MAXPACKET;
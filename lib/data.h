@@ -72,8 +72,19 @@ static inline u_int64_t
  * version 1 and 2:
  * symon_version:timestamp:length:crc:n*packedstream
  * packedstream = type:arg[<SYMON_PS_ARGLENVx]:data
+ *
+ * version 3:
+ * symon_version:timestamp:length:crc:n*sample
+ * sample = offset:length:n*packedstream
+ *
+ * Version 3 packets carry multiple samples; the timestamp is in milliseconds
+ * and each sample offset is the number of milliseconds the sample was taken
+ * after that timestamp. The sample length includes the sample header. symon
+ * also uses version 3 for sub-second intervals.
  */
-#define SYMON_PACKET_VER  2
+#define SYMON_PACKET_VER  3     /* highest version understood */
+#define SYMON_PACKET_VER2 2     /* single sample packets */
+#define SYMON_PACKET_VER3 3     /* batched sample packets */
 #define SYMON_UNKMUX   "<unknown mux>"  /* mux nodes without host addr */
 
 /* Sending structures over the network is dangerous as the compiler might have
@@ -89,8 +100,17 @@ struct symonpacketheader {
     u_int8_t reserved;
 };
 
+/* Each sample in a version 3 packet starts with a sampleheader. Like the
+ * packetheader it is (de)marshalled via setsampleheader and getsampleheader.
+ */
+struct symonsampleheader {
+    u_int32_t offset;
+    u_int16_t length;
+};
+
 struct symonpacket {
     struct symonpacketheader header;
+    u_int32_t sample;           /* offset of current sample in data */
     u_int32_t offset;
     u_int32_t size;
     char *data;
@@ -105,6 +125,19 @@ struct stream {
     int type;
     char *arg;
     char *file;
+    int interval;               /* symon; ms between measurements */
+    int due;                    /* symon; measured in current tick */
+    char *pbuf;                 /* symon; packed measurement */
+    int pbuflen;                /* symon; size of pbuf */
+    int plen;                   /* symon; bytes packed in pbuf */
+    int count;                  /* symon; elements in a vector stream */
+    char **exclude;             /* symon; wildcard; patterns not to discover */
+    int limit;                  /* wildcard; maximum streams discovered */
+    int pss;                    /* symon; proc; report pss instead of rss */
+    int trigger;                /* symon; psi; ms of stall that wakes symon */
+    int wakefd;                 /* symon; measure between ticks when readable */
+    int discovered;             /* symux; wildcard; streams accepted */
+    int pending;                /* symux; rrd file is being created */
     SLIST_ENTRY(stream) streams;
     union stream_parg parg;
 };
@@ -114,6 +147,10 @@ struct source {
     char *addr;
     struct sockaddr_storage sockaddr;
     struct streamlist sl;
+    struct streamlist wl;       /* symux; wildcard streams */
+    char *datadir;              /* symux; rrd directory of wildcard streams */
+    int rrdstep;                /* symux; seconds; create missing rrd files */
+    struct metric *metric;      /* symux; ingest metrics */
     SLIST_ENTRY(source) sources;
 };
 SLIST_HEAD(sourcelist, source);
@@ -127,12 +164,16 @@ struct mux {
     int clientsocket;           /* symux; incoming tcp connections */
     int symonsocket[AF_MAX];    /* symux; incoming symon data */
     int symuxsocket;            /* symon; outgoing data to mux */
-    int last;
-    int interval;
+    int interval;               /* symon; ms between measurements */
+    int batch;                  /* symon; samples per packet */
+    int samples;                /* symon; samples in current packet */
     struct symonpacket packet;
     struct sockaddr_storage sockaddr;
     struct streamlist sl;
+    struct streamlist wl;       /* symon; wildcard streams */
     u_int32_t senderr;
+    int metrics;                /* symux; seconds between metric reports */
+    char *metricsdir;           /* symux; rrd directory for metrics */
     SLIST_ENTRY(mux) muxes;
 };
 SLIST_HEAD(muxlist, mux);
@@ -143,8 +184,8 @@ SLIST_HEAD(muxlist, mux);
 
 /* Stream types
  *
- * Add new items at the bottom, before entries for test and eot to preserve
- * compatibility with older symon instances
+ * Add new items at the bottom, just before eot, to preserve compatibility
+ * with older symon instances; test stays at 18.
  */
 #define MT_IO1    0
 #define MT_CPU    1
@@ -165,7 +206,14 @@ SLIST_HEAD(muxlist, mux);
 #define MT_LOAD   16
 #define MT_FLUKSO 17
 #define MT_TEST   18
-#define MT_EOT    19
+#define MT_SELF   19
+#define MT_CPUS   20
+#define MT_SMART2 21
+#define MT_NVME   22
+#define MT_PROC2  23
+#define MT_CGROUP 24
+#define MT_PSI    25
+#define MT_EOT    26
 
 /*
  * Unpacking of incoming packets is done via a packedstream structure. This
@@ -346,6 +394,49 @@ struct packedstream {
             u_int8_t temperature2;
             u_int8_t free_fall_protection;
         }      ps_smart;
+        struct {
+            u_int8_t attr[12];  /* as ps_smart */
+            u_int32_t age;      /* seconds since the drive was read */
+        }      ps_smart2;
+        struct {
+            u_int8_t critical_warning;
+            int64_t temperature;
+            u_int8_t available_spare;
+            u_int8_t percentage_used;
+            u_int64_t data_read;
+            u_int64_t data_written;
+            u_int64_t power_cycles;
+            u_int64_t power_on_hours;
+            u_int64_t unsafe_shutdowns;
+            u_int64_t media_errors;
+            u_int64_t error_log_entries;
+        }      ps_nvme;
+        struct {
+            u_int64_t cpu_usage;        /* microseconds */
+            u_int64_t cpu_user;
+            u_int64_t cpu_system;
+            u_int64_t nr_throttled;
+            u_int64_t throttled;        /* microseconds */
+            u_int64_t mem_current;      /* bytes */
+            u_int64_t mem_anon;
+            u_int64_t mem_file;
+            u_int64_t pgmajfault;
+            u_int64_t rbytes;
+            u_int64_t wbytes;
+            u_int64_t rios;
+            u_int64_t wios;
+            u_int64_t pids;
+        }      ps_cgroup;
+        struct {
+            u_int16_t msome10;          /* percent of time stalled */
+            u_int16_t msome60;
+            u_int16_t msome300;
+            u_int64_t some;             /* microseconds */
+            u_int16_t mfull10;
+            u_int16_t mfull60;
+            u_int16_t mfull300;
+            u_int64_t full;
+        }      ps_psi;
         struct {
             u_int16_t mload1;
             u_int16_t mload2;
@@ -354,27 +445,48 @@ struct packedstream {
         struct {
             int64_t value;
         }      ps_flukso;
+        struct {
+            u_int64_t calls;
+            u_int64_t wall;
+            u_int64_t cpu;
+            u_int64_t max;
+            u_int64_t bytes;
+            u_int64_t errors;
+            u_int64_t hist[7];
+        }      ps_self;
+        struct {
+            u_int16_t count;
+            char *elems;        /* packed elements, see sunpackelem */
+        }      ps_vector;
     }     data;
 };
 
 /* prototypes */
 __BEGIN_DECLS
+char *type2form(const int);
 char *type2str(const int);
+int type2elem(const int);
 int bytelen_sourcelist(struct sourcelist *);
+int bytelen_stream(struct stream *);
 int bytelen_streamlist(struct streamlist *);
 int gcd(int a, int b);
 int getheader(char *, struct symonpacketheader *);
+int getsampleheader(char *, struct symonsampleheader *);
 int ps2strn(struct packedstream *, char *, int, int);
 int setheader(char *, struct symonpacketheader *);
+int setsampleheader(char *, struct symonsampleheader *);
 int snpack(char *, int, char *, int, ...);
 int snpack1(char *, int, char *, int, ...);
 int snpack2(char *, int, char *, int, ...);
 int snpackx(size_t, char *, int, char *, int, va_list);
+int snpackv(char *, int, char *, int, int);
+int snpackelem(char *, int, int, ...);
 int strlen_sourcelist(struct sourcelist *);
 int strlentype(int);
 int sunpack1(char *, struct packedstream *);
 int sunpack2(char *, struct packedstream *);
 int sunpackx(size_t, char *, struct packedstream *);
+int sunpackelem(struct packedstream *, int, struct packedstream *);
 int token2type(const int);
 struct mux *add_mux(struct muxlist *, char *);
 struct mux *find_mux(struct muxlist *, char *);
@@ -383,6 +495,8 @@ struct source *add_source(struct sourcelist *, char *);
 struct source *find_source(struct sourcelist *, char *);
 struct source *find_source_sockaddr(struct sourcelist *, struct sockaddr *);
 struct stream *add_mux_stream(struct mux *, int, char *);
+struct stream *add_mux_wildcard(struct mux *, int, char *);
+struct stream *add_source_wildcard(struct source *, int, char *);
 struct stream *add_source_stream(struct source *, int, char *);
 struct stream *find_mux_stream(struct mux *, int, char *);
 struct stream *find_source_stream(struct source *, int, char *);
@@ -68,12 +68,17 @@ static struct {
     { ")", LXT_CLOSE },
     { ",", LXT_COMMA },
     { "accept", LXT_ACCEPT },
+    { "batch", LXT_BATCH },
+    { "cgroup", LXT_CGROUP },
     { "cpu", LXT_CPU },
     { "cpuiow", LXT_CPUIOW },
+    { "cpus", LXT_CPUS },
+    { "create", LXT_CREATE },
     { "datadir", LXT_DATADIR },
     { "debug", LXT_DEBUG },
     { "df", LXT_DF },
     { "every", LXT_EVERY },
+    { "exclude", LXT_EXCLUDE },
     { "flukso", LXT_FLUKSO },
     { "from", LXT_FROM },
     { "if", LXT_IF },
@@ -83,24 +88,37 @@ static struct {
     { "io", LXT_IO },
     { "io1", LXT_IO1 },
     { "io2", LXT_IO },
+    { "limit", LXT_LIMIT },
     { "load", LXT_LOAD },
     { "mbuf", LXT_MBUF },
     { "mem", LXT_MEM },
     { "mem1", LXT_MEM1 },
     { "mem2", LXT_MEM },
+    { "metrics", LXT_METRICS },
+    { "milliseconds", LXT_MILLISECONDS },
     { "monitor", LXT_MONITOR },
     { "mux", LXT_MUX },
+    { "nvme", LXT_NVME },
     { "pf", LXT_PF },
     { "pfq", LXT_PFQ },
     { "port", LXT_PORT },
     { "proc", LXT_PROC },
+    { "proc1", LXT_PROC1 },
+    { "proc2", LXT_PROC },
+    { "psi", LXT_PSI },
+    { "pss", LXT_PSS },
     { "second", LXT_SECOND },
     { "seconds", LXT_SECONDS },
+    { "self", LXT_SELF },
     { "sensor", LXT_SENSOR },
     { "smart", LXT_SMART },
+    { "smart1", LXT_SMART1 },
+    { "smart2", LXT_SMART },
     { "source", LXT_SOURCE },
     { "stream", LXT_STREAM },
+    { "test", LXT_TEST },
     { "to", LXT_TO },
+    { "trigger", LXT_TRIGGER },
     { "write", LXT_WRITE },
     { NULL, 0 }
 };
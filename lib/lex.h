@@ -43,42 +43,58 @@
 /* Tokens known to lex */
 #define LXT_ACCEPT     1
 #define LXT_BADTOKEN   0
-#define LXT_BEGIN      2
-#define LXT_CLOSE      3
-#define LXT_COMMA      4
-#define LXT_CPU        5
-#define LXT_CPUIOW     6
-#define LXT_DATADIR    7
-#define LXT_DEBUG      8
-#define LXT_DF         9
-#define LXT_END       10
-#define LXT_EVERY     11
-#define LXT_FLUKSO    12
-#define LXT_FROM      13
-#define LXT_IF        14
-#define LXT_IF1       15
-#define LXT_IN        16
-#define LXT_IO        17
-#define LXT_IO1       18
-#define LXT_LOAD      19
-#define LXT_MBUF      20
-#define LXT_MEM       21
-#define LXT_MEM1      22
-#define LXT_MONITOR   23
-#define LXT_MUX       24
-#define LXT_OPEN      25
-#define LXT_PF        26
-#define LXT_PFQ       27
-#define LXT_PORT      28
-#define LXT_PROC      29
-#define LXT_SECOND    30
-#define LXT_SECONDS   31
-#define LXT_SENSOR    32
-#define LXT_SMART     33
-#define LXT_SOURCE    34
-#define LXT_STREAM    35
-#define LXT_TO        36
-#define LXT_WRITE     37
+#define LXT_BATCH      2
+#define LXT_BEGIN      3
+#define LXT_CGROUP     4
+#define LXT_CLOSE      5
+#define LXT_COMMA      6
+#define LXT_CPU        7
+#define LXT_CPUIOW     8
+#define LXT_CPUS       9
+#define LXT_CREATE    10
+#define LXT_DATADIR   11
+#define LXT_DEBUG     12
+#define LXT_DF        13
+#define LXT_END       14
+#define LXT_EVERY     15
+#define LXT_EXCLUDE   16
+#define LXT_FLUKSO    17
+#define LXT_FROM      18
+#define LXT_IF        19
+#define LXT_IF1       20
+#define LXT_IN        21
+#define LXT_IO        22
+#define LXT_IO1       23
+#define LXT_LIMIT     24
+#define LXT_LOAD      25
+#define LXT_MBUF      26
+#define LXT_MEM       27
+#define LXT_MEM1      28
+#define LXT_METRICS   29
+#define LXT_MILLISECONDS 30
+#define LXT_MONITOR   31
+#define LXT_MUX       32
+#define LXT_NVME      33
+#define LXT_OPEN      34
+#define LXT_PF        35
+#define LXT_PFQ       36
+#define LXT_PORT      37
+#define LXT_PROC      38
+#define LXT_PROC1     39
+#define LXT_PSI       40
+#define LXT_PSS       41
+#define LXT_SECOND    42
+#define LXT_SECONDS   43
+#define LXT_SELF      44
+#define LXT_SENSOR    45
+#define LXT_SMART     46
+#define LXT_SMART1    47
+#define LXT_SOURCE    48
+#define LXT_STREAM    49
+#define LXT_TEST      50
+#define LXT_TO        51
+#define LXT_TRIGGER   52
+#define LXT_WRITE     53
 
 struct lex {
     char *buffer;               /* current line(s) */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Open addressed FNV-1a hash index of named entries; see nameindex.h
+ */
+
+#include <sys/types.h>
+
+#include <string.h>
+#include <strings.h>
+
+#include "nameindex.h"
+#include "xmalloc.h"
+
+#define ENTRYNAME(base, stride, i) ((const char *) (base) + (size_t) (i) * (stride))
+
+static u_int32_t
+namehash(const char *name)
+{
+    u_int32_t h = 2166136261U;
+
+    while (*name)
+        h = (h ^ (u_char) *name++) * 16777619U;
+
+    return h;
+}
+
+void
+nameindex_build(struct nameindex *ni, const void *base, int count, size_t stride)
+{
+    unsigned int i, h;
+
+    /* keep the table at most half full */
+    if (ni->size < 2 * (unsigned int) count || ni->table == NULL) {
+        if (ni->table != NULL)
+            xfree(ni->table);
+        for (ni->size = 64; ni->size < 2 * (unsigned int) count; ni->size *= 2)
+            ;
+        ni->table = xmalloc(ni->size * sizeof(int));
+    }
+    bzero(ni->table, ni->size * sizeof(int));
+
+    for (i = 0; i < (unsigned int) count; i++) {
+        for (h = namehash(ENTRYNAME(base, stride, i)) & (ni->size - 1);
+             ni->table[h] != 0;
+             h = (h + 1) & (ni->size - 1))
+            ;
+        ni->table[h] = i + 1;
+    }
+}
+
+/* Returns the index of the entry called name, or -1 */
+int
+nameindex_lookup(struct nameindex *ni, const void *base, size_t stride, const char *name)
+{
+    unsigned int h;
+
+    if (ni->table == NULL)
+        return -1;
+
+    for (h = namehash(name) & (ni->size - 1);
+         ni->table[h] != 0;
+         h = (h + 1) & (ni->size - 1))
+        if (strcmp(ENTRYNAME(base, stride, ni->table[h] - 1), name) == 0)
+            return ni->table[h] - 1;
+
+    return -1;
+}
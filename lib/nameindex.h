@@ -0,0 +1,18 @@
+#ifndef _SYMON_LIB_NAMEINDEX_H
+#define _SYMON_LIB_NAMEINDEX_H
+
+#include <stddef.h>
+
+/*
+ * Hash index over an array of entries that start with a nul terminated name,
+ * e.g. struct { char name[IFNAMSIZ]; ... }. Probes rebuild it after parsing a
+ * snapshot of all objects, so that every stream is a lookup.
+ */
+struct nameindex {
+    int *table;                 /* entry index + 1, 0 is empty */
+    unsigned int size;          /* power of 2, at least twice the entries */
+};
+
+void nameindex_build(struct nameindex *, const void *, int, size_t);
+int nameindex_lookup(struct nameindex *, const void *, size_t, const char *);
+#endif /* _SYMON_LIB_NAMEINDEX_H */
@@ -59,3 +59,36 @@ percentages(int cnt, int64_t *out, int64_t *new, int64_t *old, int64_t *diffs)
     /* return the total in case the caller wants to use it */
     return (total_change);
 }
+/*
+ * percentages() for n rows of cnt states, stored row after row. The changes
+ * of all rows are determined in a single loop without dependencies between
+ * the iterations, which the compiler can vectorize.
+ */
+void
+percentagesv(int cnt, int n, int64_t *out, int64_t *new, int64_t *old, int64_t *diffs)
+{
+    int64_t change, total_change, half_total;
+    int i, j;
+
+    for (i = 0; i < cnt * n; i++) {
+        change = new[i] - old[i];
+        /* counters that wrap */
+        diffs[i] = (change < 0) ? (QUAD_MAX - old[i]) + new[i] : change;
+        old[i] = new[i];
+    }
+
+    for (j = 0; j < n; j++, out += cnt, diffs += cnt) {
+        total_change = 0;
+        for (i = 0; i < cnt; i++)
+            total_change += diffs[i];
+
+        /* avoid divide by zero potential */
+        if (total_change == 0)
+            total_change = 1;
+
+        /* calculate percentages based on overall change, rounding up */
+        half_total = total_change / 2l;
+        for (i = 0; i < cnt; i++)
+            out[i] = ((diffs[i] * 1000 + half_total) / total_change);
+    }
+}
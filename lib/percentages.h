@@ -1,4 +1,5 @@
 #ifndef _SYMON_LIB_PERCENTAGES_H
 #define _SYMON_LIB_PERCENTAGES_H
 int percentages(int cnt, int64_t *out, int64_t *new, int64_t *old, int64_t *diffs);
+void percentagesv(int cnt, int n, int64_t *out, int64_t *new, int64_t *old, int64_t *diffs);
 #endif /* _SYMON_LIB_PERCENTAGES_H */
@@ -31,6 +31,7 @@
 #include <sys/types.h>
 #include <strings.h>
 
+#include "data.h"
 #include "smart.h"
 
 /*
@@ -126,3 +127,41 @@ smart_status(unsigned char low, unsigned char high)
     /* Values do not make sense - signal to caller */
     return 2;
 }
+/*
+ * Pack a smart_report as a stream of <type>; smart1 streams carry the
+ * attributes, smart2 streams also carry the <age> of the data in seconds.
+ */
+int
+smart_pack(char *buf, int maxlen, char *arg, int type,
+           struct smart_report *sr, u_int32_t age)
+{
+    if (type == MT_SMART)
+        return snpack(buf, maxlen, arg, MT_SMART,
+                      sr->read_error_rate,
+                      sr->reallocated_sectors,
+                      sr->spin_retries,
+                      sr->air_flow_temp,
+                      sr->temperature,
+                      sr->reallocations,
+                      sr->current_pending,
+                      sr->uncorrectables,
+                      sr->soft_read_error_rate,
+                      sr->g_sense_error_rate,
+                      sr->temperature2,
+                      sr->free_fall_protection);
+
+    return snpack(buf, maxlen, arg, MT_SMART2,
+                  sr->read_error_rate,
+                  sr->reallocated_sectors,
+                  sr->spin_retries,
+                  sr->air_flow_temp,
+                  sr->temperature,
+                  sr->reallocations,
+                  sr->current_pending,
+                  sr->uncorrectables,
+                  sr->soft_read_error_rate,
+                  sr->g_sense_error_rate,
+                  sr->temperature2,
+                  sr->free_fall_protection,
+                  age);
+}
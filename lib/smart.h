@@ -77,5 +77,7 @@ struct smart_report {
 
 extern void smart_parse(struct smart_values *ds, struct smart_report *sr);
 extern int smart_status(unsigned char low, unsigned char high);
+extern int smart_pack(char *buf, int maxlen, char *arg, int type,
+                      struct smart_report *sr, u_int32_t age);
 
 #endif /* _SYMON_LIB_SMART_H */
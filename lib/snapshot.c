@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Snapshots of procfs and sysfs files, shared between probes; see snapshot.h
+ *
+ * symon calls tick_snapshots once per tick. The first probe that locks a
+ * snapshot in a tick rereads the file with pread into the reusable buffer
+ * of the snapshot, and parses it. Other probes that lock it in the same tick
+ * get the same contents and parsed form without any system call.
+ */
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "snapshot.h"
+#include "xmalloc.h"
+
+static SLIST_HEAD(, snapshot) snapshots = SLIST_HEAD_INITIALIZER(snapshots);
+static pthread_mutex_t snapshots_lock = PTHREAD_MUTEX_INITIALIZER;
+static u_int64_t generation = 1;
+
+__BEGIN_DECLS
+static void refresh_snapshot(struct snapshot *);
+__END_DECLS
+
+/* Return the snapshot of path, shared with earlier opens of the same path */
+struct snapshot *
+open_snapshot(const char *path, void (*parse) (struct snapshot *))
+{
+    struct snapshot *s;
+
+    pthread_mutex_lock(&snapshots_lock);
+
+    SLIST_FOREACH(s, &snapshots, snapshots) {
+        if (strcmp(s->path, path) == 0) {
+            if (s->parse == NULL)
+                s->parse = parse;
+            else if (parse != NULL && s->parse != parse)
+                fatal("%s:%d: internal error: %.200s opened with different parsers",
+                      __FILE__, __LINE__, path);
+            pthread_mutex_unlock(&snapshots_lock);
+            return s;
+        }
+    }
+
+    s = xmalloc(sizeof(struct snapshot));
+    bzero(s, sizeof(struct snapshot));
+    s->path = xstrdup(path);
+    s->parse = parse;
+    s->maxlen = SYMON_MAX_OBJSIZE;
+    s->buf = xmalloc(s->maxlen);
+    s->buf[0] = '\0';
+    pthread_mutex_init(&s->lock, NULL);
+
+    if ((s->fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        warning("cannot access %.200s: %.200s", path, strerror(errno));
+
+    SLIST_INSERT_HEAD(&snapshots, s, snapshots);
+    pthread_mutex_unlock(&snapshots_lock);
+
+    return s;
+}
+/* Start a new tick; snapshots are reread when they are next locked */
+void
+tick_snapshots(void)
+{
+    pthread_mutex_lock(&snapshots_lock);
+    generation++;
+    pthread_mutex_unlock(&snapshots_lock);
+}
+/* Return the current tick, for probes that keep state per tick */
+u_int64_t
+snapshot_tick(void)
+{
+    u_int64_t current;
+
+    pthread_mutex_lock(&snapshots_lock);
+    current = generation;
+    pthread_mutex_unlock(&snapshots_lock);
+
+    return current;
+}
+static void
+refresh_snapshot(struct snapshot *s)
+{
+    ssize_t n;
+
+    s->len = 0;
+
+    if (s->fd < 0 && (s->fd = open(s->path, O_RDONLY | O_CLOEXEC)) < 0)
+        goto done;
+
+    while ((n = pread(s->fd, s->buf + s->len, s->maxlen - s->len - 1, s->len)) > 0) {
+        s->len += n;
+        if (s->len == s->maxlen - 1) {
+            /* buffer is too small to hold the file */
+            if (s->maxlen * 2 > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS)
+                fatal("%s:%d: dynamic object limit (%d) exceeded for %.200s",
+                      __FILE__, __LINE__, SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS,
+                      s->path);
+            s->maxlen *= 2;
+            s->buf = xrealloc(s->buf, s->maxlen);
+        }
+    }
+
+    if (n < 0) {
+        warning("could not read %.200s: %.200s", s->path, strerror(errno));
+        s->len = 0;
+    }
+
+done:
+    s->buf[s->len] = '\0';
+    if (s->parse != NULL)
+        s->parse(s);
+}
+/*
+ * Lock a snapshot, rereading it when it is from an earlier tick. Returns 0
+ * when the file could not be read; the snapshot is locked nonetheless.
+ */
+int
+lock_snapshot(struct snapshot *s)
+{
+    u_int64_t current;
+
+    pthread_mutex_lock(&snapshots_lock);
+    current = generation;
+    pthread_mutex_unlock(&snapshots_lock);
+
+    pthread_mutex_lock(&s->lock);
+    if (s->generation != current) {
+        refresh_snapshot(s);
+        s->generation = current;
+    }
+
+    return (s->len > 0);
+}
+void
+unlock_snapshot(struct snapshot *s)
+{
+    pthread_mutex_unlock(&s->lock);
+}
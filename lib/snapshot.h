@@ -0,0 +1,35 @@
+#ifndef _SYMON_LIB_SNAPSHOT_H
+#define _SYMON_LIB_SNAPSHOT_H
+
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "platform.h"
+
+/*
+ * A file below /proc or /sys that is read at most once per tick and shared
+ * by all probes that need it. An optional parse function turns the contents
+ * into a parsed form (data) once per read, that is shared as well.
+ *
+ * Probes run on different threads: buf and data may only be used between
+ * lock_snapshot and unlock_snapshot.
+ */
+struct snapshot {
+    char *path;
+    int fd;
+    char *buf;                  /* nul terminated contents */
+    size_t len;
+    size_t maxlen;
+    u_int64_t generation;       /* tick of the contents */
+    void (*parse) (struct snapshot *);
+    void *data;                 /* parsed form, owned by parse */
+    pthread_mutex_t lock;
+    SLIST_ENTRY(snapshot) snapshots;
+};
+
+struct snapshot *open_snapshot(const char *, void (*) (struct snapshot *));
+void tick_snapshots(void);
+u_int64_t snapshot_tick(void);
+int lock_snapshot(struct snapshot *);
+void unlock_snapshot(struct snapshot *);
+#endif /* _SYMON_LIB_SNAPSHOT_H */
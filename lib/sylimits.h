@@ -10,10 +10,16 @@
 #define SYMON_MAX_OBJSIZE      (_POSIX2_LINE_MAX)
 #define SYMON_SENSORMASK       0xFF     /* sensors 0-255 are allowed */
 #define SYMON_MAXDEBUGID       20       /* = CTL_DEBUG_MAXID; depends lib/data.h */
-#define SYMON_MAXCPUID         16       /* cpu0 - cpu15 */
+#define SYMON_MAXCPUID         1024     /* cpu0 - cpu1023 */
 #define SYMON_DFBLOCKSIZE      512
 #define SYMON_DFNAMESIZE       64
 #define SYMON_MAXPACKET        65515    /* udp packet max payload 65Kb - 20 byte header */
+#define SYMON_MAXBATCH         32       /* maximum number of samples in a packet */
+#define SYMON_MAXWILDCARD      256      /* default limit of streams per wildcard */
+#define SYMON_SMARTINTERVAL    1000     /* ms; minimum time between smart reads */
+#define SYMON_NVMEINTERVAL     1000     /* ms; minimum time between nvme log reads */
+#define SYMON_DFTIMEOUT        100      /* ms; wait for statvfs of a mount */
+#define SYMON_PSIWINDOW        2000     /* ms; window of psi triggers */
 
 #define SYMON_MAXLEXNUM        65535    /* maximum numeric argument while lexing */
 #endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Location of the proc and sys filesystems as seen by the probes.
+ *
+ * Probes never open "/proc/..." directly but build their paths with
+ * procfs_path and sysfs_path. Pointing the root at a captured fixture tree
+ * (root/proc, root/sys) lets the probes run against recorded or synthetic
+ * kernel state.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "xmalloc.h"
+#include "sysroot.h"
+
+char *procfs_root = "/proc";
+char *sysfs_root = "/sys";
+
+void
+set_sysroot(const char *root)
+{
+    size_t len;
+
+    if (root == NULL || *root == '\0' || strcmp(root, "/") == 0) {
+        procfs_root = "/proc";
+        sysfs_root = "/sys";
+        return;
+    }
+
+    len = strlen(root) + sizeof("/proc");
+    procfs_root = xmalloc(len);
+    snprintf(procfs_root, len, "%s/proc", root);
+
+    sysfs_root = xmalloc(len);
+    snprintf(sysfs_root, len, "%s/sys", root);
+}
+
+char *
+procfs_path(char *buf, size_t len, const char *name)
+{
+    snprintf(buf, len, "%s/%s", procfs_root, name);
+
+    return buf;
+}
+
+char *
+sysfs_path(char *buf, size_t len, const char *name)
+{
+    snprintf(buf, len, "%s/%s", sysfs_root, name);
+
+    return buf;
+}
@@ -0,0 +1,13 @@
+#ifndef _SYMON_LIB_SYSROOT_H
+#define _SYMON_LIB_SYSROOT_H
+
+#include <stddef.h>
+
+/* Probes read kernel state below these roots; see set_sysroot */
+extern char *procfs_root;
+extern char *sysfs_root;
+
+void set_sysroot(const char *root);
+char *procfs_path(char *buf, size_t len, const char *name);
+char *sysfs_path(char *buf, size_t len, const char *name);
+#endif /* _SYMON_LIB_SYSROOT_H */
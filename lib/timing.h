@@ -0,0 +1,15 @@
+#ifndef _SYMON_LIB_TIMING_H
+#define _SYMON_LIB_TIMING_H
+
+#include <sys/types.h>
+
+#include <time.h>
+
+/* Clock readings, 0 if the clock cannot be read */
+u_int64_t clock_nsec(clockid_t);
+u_int64_t clock_usec(clockid_t);
+
+/* Histogram bucket of a duration in usec; buckets are <10us, <100us, ... and
+ * the last one takes the rest */
+int timing_bucket(u_int64_t, int);
+#endif /* _SYMON_LIB_TIMING_H */
@@ -0,0 +1,476 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * symon-loadgen simulates a fleet of symon hosts to load test symux.
+ *
+ * Every simulated source sends from its own address, counting up from the
+ * first source address. On Linux all of 127/8 is local; elsewhere loopback
+ * aliases are needed. Packets carry a configurable mix of streams, by default
+ * test streams, and are paced evenly over every second.
+ *
+ * When symux accepts listeners on its port, the lines it offers are counted
+ * to report its acceptance rate alongside the achieved send rate. symux
+ * offers a line for every sample it accepted from a configured source.
+ */
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "conf.h"
+#include "data.h"
+#include "error.h"
+#include "net.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+#define LOADGEN_SOURCE   "127.0.1.1"
+#define LOADGEN_MIX      "test*8"
+#define LOADGEN_PORT     "2100"
+#define LOADGEN_SOURCES  100
+#define LOADGEN_RATE     1
+#define LOADGEN_DURATION 10
+#define LOADGEN_DRAIN    2      /* seconds to wait for the last lines */
+#define LOADGEN_MAXMIX   64
+
+struct mixitem {
+    int type;
+    int count;
+};
+
+struct loadsource {
+    int sock;
+    struct in_addr addr;
+    char *packet;
+    int length;
+    u_int32_t seq;
+};
+
+struct loadcount {
+    u_int64_t packets;
+    u_int64_t bytes;
+    u_int64_t errors;
+    u_int64_t accepted;
+};
+
+__BEGIN_DECLS
+static void usage(void);
+static int parse_mix(char *, struct mixitem *);
+static void print_config(char *, char *, struct in_addr, int, struct mixitem *, int);
+static void init_source(struct loadsource *, struct mixitem *, int, int);
+static void send_source(struct loadsource *, struct loadcount *);
+static int connect_client(char *, char *);
+static void read_client(int, struct loadcount *);
+static void report(char *, struct loadcount *, struct loadcount *, double);
+__END_DECLS
+
+static struct sockaddr_storage muxaddr;
+
+static void
+usage(void)
+{
+    info("usage: %s [-cdv] [-a address] [-m mix] [-n sources] [-p port] "
+         "[-r rate] [-t seconds] [host]", __progname);
+    exit(EX_USAGE);
+}
+/* Parse "type[*count],..." into mix; returns number of items */
+static int
+parse_mix(char *spec, struct mixitem * mix)
+{
+    char *s, *item, *count;
+    int n = 0;
+    int type;
+
+    s = xstrdup(spec);
+    for (item = strtok(s, ","); item != NULL; item = strtok(NULL, ",")) {
+        if (n == LOADGEN_MAXMIX)
+            fatal("too many items in stream mix '%.200s'", spec);
+
+        if ((count = strchr(item, '*')) != NULL)
+            *count++ = '\0';
+
+        for (type = 0; type < MT_EOT; type++)
+            if (strcmp(type2str(type), item) == 0)
+                break;
+
+        if (type == MT_EOT)
+            fatal("unknown stream type '%.200s' in mix", item);
+        if (type2elem(type) != -1)
+            fatal("vector stream type '%.200s' cannot be used in a mix", item);
+
+        mix[n].type = type;
+        mix[n].count = (count != NULL) ? atoi(count) : 1;
+        if (mix[n].count <= 0)
+            fatal("bad count for stream type '%.200s' in mix", item);
+        n++;
+    }
+    xfree(s);
+
+    if (n == 0)
+        fatal("empty stream mix");
+
+    return n;
+}
+/* Print a symux.conf that accepts the simulated sources */
+static void
+print_config(char *host, char *port, struct in_addr first, int nsources,
+             struct mixitem * mix, int nmix)
+{
+    struct in_addr addr;
+    int i, j, k;
+    char *sep;
+
+    printf("mux %s %s\n", host, port);
+    printf("metrics every 10 seconds\n");
+
+    for (i = 0; i < nsources; i++) {
+        addr.s_addr = htonl(ntohl(first.s_addr) + i);
+        printf("source %s { accept {", inet_ntoa(addr));
+        sep = " ";
+        for (j = 0; j < nmix; j++) {
+            for (k = 0; k < mix[j].count; k++) {
+                printf("%s%s(%d)", sep, type2str(mix[j].type), k);
+                sep = ", ";
+            }
+        }
+        printf(" } }\n");
+    }
+}
+/* Prepare the socket and packet of a source. Stream values are filled with
+ * bytes that differ per source and stream; only their size matters to symux. */
+static void
+init_source(struct loadsource * ls, struct mixitem * mix, int nmix, int id)
+{
+    char arg[SYMON_PS_ARGLENV2];
+    struct symonpacketheader ph;
+    struct symonsampleheader sh;
+    struct sockaddr_in sin;
+    struct stream st;
+    int size, len;
+    int i, j, k;
+    char *p;
+
+    if ((ls->sock = socket(AF_INET, SOCK_DGRAM, 0)) == -1)
+        fatal("could not obtain socket: %.200s", strerror(errno));
+
+    bzero(&sin, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr = ls->addr;
+    if (bind(ls->sock, (struct sockaddr *) &sin, sizeof(sin)) == -1)
+        fatal("could not bind to source address %.200s: %.200s; "
+              "add loopback aliases or choose another -a",
+              inet_ntoa(ls->addr), strerror(errno));
+
+    if (connect(ls->sock, (struct sockaddr *) &muxaddr, SS_LEN(&muxaddr)) == -1)
+        fatal("could not connect to symux: %.200s", strerror(errno));
+
+    size = sizeof(struct symonpacketheader) + sizeof(struct symonsampleheader);
+    for (i = 0; i < nmix; i++)
+        for (k = 0; k < mix[i].count; k++) {
+            snprintf(arg, sizeof(arg), "%d", k);
+            st.type = mix[i].type;
+            st.arg = arg;
+            size += bytelen_stream(&st);
+        }
+
+    if (size > SYMON_MAXPACKET)
+        fatal("stream mix does not fit a packet (%d > %d bytes)", size, SYMON_MAXPACKET);
+
+    ls->packet = xmalloc(size);
+    bzero(ls->packet, size);
+
+    /* header and sampleheader are set for every packet */
+    bzero(&ph, sizeof(ph));
+    bzero(&sh, sizeof(sh));
+    ls->length = setheader(ls->packet, &ph);
+    ls->length += setsampleheader(ls->packet + ls->length, &sh);
+    for (i = 0; i < nmix; i++)
+        for (k = 0; k < mix[i].count; k++) {
+            p = ls->packet + ls->length;
+            snprintf(arg, sizeof(arg), "%d", k);
+            st.type = mix[i].type;
+            st.arg = arg;
+            len = bytelen_stream(&st);
+
+            p[0] = mix[i].type;
+            snprintf(&p[1], len - 1, "%s", arg);
+            for (j = strlen(arg) + 2; j < len; j++)
+                p[j] = (id * 7 + k * 13 + j) & 0xff;
+            ls->length += len;
+        }
+}
+/* Stamp and send the next packet of a source */
+static void
+send_source(struct loadsource * ls, struct loadcount * c)
+{
+    struct symonpacketheader ph;
+    struct symonsampleheader sh;
+    struct timeval tv;
+    int offset;
+
+    gettimeofday(&tv, NULL);
+
+    bzero(&ph, sizeof(ph));
+    ph.timestamp = ((u_int64_t) tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+    ph.length = ls->length;
+    ph.symon_version = SYMON_PACKET_VER3;
+    offset = setheader(ls->packet, &ph);
+
+    sh.offset = 0;
+    sh.length = ls->length - offset;
+    setsampleheader(ls->packet + offset, &sh);
+
+    /* values change a little in every packet */
+    ls->packet[ls->length - 1] = ls->seq++ & 0xff;
+
+    ph.crc = crc32(ls->packet, ls->length);
+    setheader(ls->packet, &ph);
+
+    if (send(ls->sock, ls->packet, ls->length, 0) == ls->length) {
+        c->packets++;
+        c->bytes += ls->length;
+    } else {
+        c->errors++;
+    }
+}
+/* Connect to the symux listener port; -1 if symux does not accept listeners */
+static int
+connect_client(char *host, char *port)
+{
+    struct sockaddr_storage sa;
+    int sock;
+
+    get_sockaddr(&sa, AF_INET, SOCK_STREAM, 0, host, port);
+
+    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) == -1)
+        return -1;
+
+    if (connect(sock, (struct sockaddr *) &sa, SS_LEN(&sa)) == -1) {
+        warning("could not listen to symux on %.200s %.200s: %.200s; "
+                "reporting send rates only", host, port, strerror(errno));
+        close(sock);
+        return -1;
+    }
+
+    fcntl(sock, F_SETFL, O_NONBLOCK);
+
+    return sock;
+}
+/* Count the sample lines symux offered; its own metrics lines are skipped */
+static void
+read_client(int sock, struct loadcount * c)
+{
+    static char line[sizeof("symux;")];
+    static int linelen = 0;
+    char buf[65536];
+    int len, i;
+
+    if (sock < 0)
+        return;
+
+    while ((len = read(sock, buf, sizeof(buf))) > 0) {
+        for (i = 0; i < len; i++) {
+            if (buf[i] == '\n') {
+                if (linelen > 0 && strncmp(line, "symux;", linelen) != 0)
+                    c->accepted++;
+                linelen = 0;
+            } else if (linelen < (int) sizeof(line) - 1) {
+                line[linelen++] = buf[i];
+            }
+        }
+    }
+}
+static void
+report(char *what, struct loadcount * now, struct loadcount * last, double secs)
+{
+    printf("%-6s sent %8.0f pkt/s %8.0f kB/s %6llu errors; "
+           "symux accepted %8.0f pkt/s (%5.1f%%)\n",
+           what,
+           (now->packets - last->packets) / secs,
+           (now->bytes - last->bytes) / secs / 1024,
+           (unsigned long long) (now->errors - last->errors),
+           (now->accepted - last->accepted) / secs,
+           (now->packets > last->packets) ?
+           100.0 * (now->accepted - last->accepted) / (now->packets - last->packets) : 0.0);
+    fflush(stdout);
+}
+int
+main(int argc, char *argv[])
+{
+    struct mixitem mix[LOADGEN_MAXMIX];
+    struct loadcount count, last;
+    struct loadsource *sources;
+    struct in_addr first;
+    struct timeval tv;
+    struct rlimit rl;
+    char *mixspec = LOADGEN_MIX;
+    char *srcaddr = LOADGEN_SOURCE;
+    char *port = LOADGEN_PORT;
+    char *host = "127.0.0.1";
+    char when[16];
+    fd_set readset;
+    u_int64_t start, elapsed, due, sent, next;
+    int nsources = LOADGEN_SOURCES;
+    int rate = LOADGEN_RATE;
+    int duration = LOADGEN_DURATION;
+    int flag_config = 0;
+    int client;
+    int nmix;
+    int ch;
+    int i;
+
+    while ((ch = getopt(argc, argv, "a:cdm:n:p:r:t:v")) != -1) {
+        switch (ch) {
+        case 'a':
+            srcaddr = optarg;
+            break;
+        case 'c':
+            flag_config = 1;
+            break;
+        case 'd':
+            flag_debug = 1;
+            break;
+        case 'm':
+            mixspec = optarg;
+            break;
+        case 'n':
+            if ((nsources = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 'p':
+            port = optarg;
+            break;
+        case 'r':
+            if ((rate = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 't':
+            if ((duration = atoi(optarg)) <= 0)
+                usage();
+            break;
+        case 'v':
+            info("symon-loadgen version %s", SYMON_VERSION);
+            /* FALLTHROUGH */
+        default:
+            usage();
+        }
+    }
+    argc -= optind;
+    argv += optind;
+
+    if (argc > 1)
+        usage();
+    if (argc == 1)
+        host = argv[0];
+
+    if (inet_pton(AF_INET, srcaddr, &first) != 1)
+        fatal("source address '%.200s' is not an ipv4 address", srcaddr);
+
+    nmix = parse_mix(mixspec, mix);
+
+    if (flag_config) {
+        print_config(host, port, first, nsources, mix, nmix);
+        exit(EX_OK);
+    }
+
+    /* a socket per source */
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < (rlim_t) nsources + 16) {
+        rl.rlim_cur = MIN(rl.rlim_max, (rlim_t) nsources + 16);
+        if (setrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur < (rlim_t) nsources + 16)
+            fatal("cannot open %d sockets; raise the open files limit", nsources);
+    }
+
+    init_crc32();
+    get_sockaddr(&muxaddr, AF_INET, SOCK_DGRAM, 0, host, port);
+
+    sources = xmalloc(nsources * sizeof(struct loadsource));
+    bzero(sources, nsources * sizeof(struct loadsource));
+    for (i = 0; i < nsources; i++) {
+        sources[i].addr.s_addr = htonl(ntohl(first.s_addr) + i);
+        init_source(&sources[i], mix, nmix, i);
+    }
+
+    client = connect_client(host, port);
+
+    info("sending %d packets/s from %d sources, %d bytes each, for %d seconds",
+         nsources * rate, nsources, sources[0].length, duration);
+
+    bzero(&count, sizeof(count));
+    bzero(&last, sizeof(last));
+    start = clock_usec(CLOCK_MONOTONIC);
+    next = 1000000;
+    sent = 0;
+
+    /* send at an even pace; sources take turns */
+    while ((elapsed = clock_usec(CLOCK_MONOTONIC) - start) <
+           (u_int64_t) duration * 1000000 + LOADGEN_DRAIN * 1000000) {
+        if (elapsed < (u_int64_t) duration * 1000000) {
+            due = elapsed * nsources * rate / 1000000;
+            for (; sent < due; sent++)
+                send_source(&sources[sent % nsources], &count);
+        }
+
+        read_client(client, &count);
+
+        if (elapsed >= next && next <= (u_int64_t) duration * 1000000) {
+            snprintf(when, sizeof(when), "%3llus", (unsigned long long) (next / 1000000));
+            report(when, &count, &last, 1.0);
+            last = count;
+            next += 1000000;
+        }
+
+        FD_ZERO(&readset);
+        if (client >= 0)
+            FD_SET(client, &readset);
+        tv.tv_sec = 0;
+        tv.tv_usec = 1000;
+        select(client + 1, &readset, NULL, NULL, &tv);
+    }
+
+    bzero(&last, sizeof(last));
+    report("total", &count, &last, duration);
+
+    return (EX_OK);
+}
@@ -172,8 +172,8 @@ get_proc(char *symon_buf, int maxlen, struct stream *st)
     u_int32_t cpu_secs = 0;
     double    cpu_pct = 0;
     double    cpu_pcti = 0;
-    u_int32_t mem_procsize = 0;
-    u_int32_t mem_rss = 0;
+    u_int64_t mem_procsize = 0;
+    u_int64_t mem_rss = 0;
     int n = 0;
 
     for (pp = proc_ps, i = 0; i < proc_cur; pp++, i++) {
@@ -228,8 +228,14 @@ get_proc(char *symon_buf, int maxlen, struct stream *st)
     cpu_ticks = cpu_uticks + cpu_sticks + cpu_iticks;
     cpu_secs = cpu_ticks / proc_stathz;
 
-    return snpack(symon_buf, maxlen, st->arg, MT_PROC,
+    if (st->type == MT_PROC)
+        return snpack(symon_buf, maxlen, st->arg, MT_PROC,
+                      n,
+                      cpu_uticks, cpu_sticks, cpu_iticks, cpu_secs, cpu_pcti,
+                      (u_int32_t) mem_procsize, (u_int32_t) mem_rss);
+
+    return snpack(symon_buf, maxlen, st->arg, MT_PROC2,
                   n,
                   cpu_uticks, cpu_sticks, cpu_iticks, cpu_secs, cpu_pcti,
-                  mem_procsize, mem_rss );
+                  mem_procsize, mem_rss);
 }
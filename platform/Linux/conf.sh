@@ -17,3 +17,22 @@ else
     echo "#undef HAS_HDDRIVECMDHDR"
 fi
 
+if grep -qs "NVME_IOCTL_ADMIN_CMD" /usr/include/linux/nvme_ioctl.h; then
+    echo "#define HAS_NVME_IOCTL 1"
+else
+    echo "#undef HAS_NVME_IOCTL"
+fi
+
+if grep -qs "timerfd_create" /usr/include/sys/timerfd.h /usr/include/*/sys/timerfd.h; then
+    echo "#define HAS_TIMERFD 1"
+else
+    echo "#undef HAS_TIMERFD"
+fi
+
+# 'SYMON_IF=procfs make' builds an if probe that only parses /proc/net/dev
+if [ "$SYMON_IF" != "procfs" ] &&
+   grep -qs "IFLA_STATS_LINK_64" /usr/include/linux/if_link.h; then
+    echo "#define HAS_RTNETLINK 1"
+else
+    echo "#undef HAS_RTNETLINK"
+fi
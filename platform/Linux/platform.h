@@ -51,29 +51,62 @@ union semun {
 #define SENSOR_IN        1
 #define SENSOR_TEMP      2
 
+/* probes with a list function, e.g. if and df, can be wildcard streams */
+#define HAS_DISCOVERY
+
+/* sm_if.c; rtnetlink is used when compiled in with HAS_RTNETLINK */
+#define IF_BACKEND_PROCFS  0
+#define IF_BACKEND_NETLINK 1
+extern int if_backend;
+
+/* sm_cpu.c; cpu lines of /proc/stat, shared by cpu and cpuiow */
+struct snapshot;
+struct cpu_stat {
+    char name[16];
+    int64_t time[CPUSTATES];
+};
+extern struct snapshot *open_cpu_stat(void);
+extern struct cpu_stat *find_cpu_stat(struct snapshot *, const char *);
+extern struct cpu_stat *list_cpu_stat(struct snapshot *, int *);
+
+/* sm_cgroup.c; cgroup v2 group directories, shared by cgroup and psi */
+extern int open_cgroup_root(void);
+extern int open_cgroup(char *);
+
 union stream_parg {
     struct {
         int64_t time[CPUSTATES];
         int64_t old[CPUSTATES];
         int64_t diff[CPUSTATES];
         int64_t states[CPUSTATES];
-        char name[6];
+        char name[16];
     } cp;
     struct {
         int64_t time[CPUSTATES];
         int64_t old[CPUSTATES];
         int64_t diff[CPUSTATES];
         int64_t states[CPUSTATES];
-        char name[6];
+        char name[16];
     } cpw;
     struct {
-        char mountpath[MAX_PATH_LEN];
+        int64_t *time;          /* CPUSTATES per cpu */
+        int64_t *old;
+        int64_t *diff;
+        int64_t *states;
+    } cps;
+    struct {
+        int mount;              /* index of the mount and its worker */
     } df;
     struct {
         int type;
         char path[MAX_PATH_LEN];
+        struct snapshot *snapshot;
     } sn;
     int smart;
+    int proc;                   /* index of the command group */
+    int nvme;
+    int cgroup;
+    int psi;
     char ifname[MAX_PATH_LEN];
     char flukso[MAX_PATH_LEN];
     char io[MAX_PATH_LEN];
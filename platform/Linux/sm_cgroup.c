@@ -0,0 +1,521 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Get the resource usage of cgroup v2 control groups
+ *
+ * cpu_usage : cpu_user : cpu_system : nr_throttled : throttled : mem_current :
+ * mem_anon : mem_file : pgmajfault : rbytes : wbytes : rios : wios : pids
+ *
+ * The argument is the path of a group below the cgroup mount, e.g.
+ * system.slice/sshd.service; without argument the root group is measured.
+ * The cgroup mount is opened before privileges are dropped. The directories
+ * and interface files of the groups are opened relative to it and reread with
+ * pread; a group is read once per measurement, however many streams report
+ * it. A group that disappears is looked up by name again, so that a restarted
+ * container is found. Groups that are no longer measured are closed.
+ *
+ * Container runtimes name their groups after 64 digit ids, which do not fit
+ * in a stream argument. Runs of more than 12 hex digits in names are
+ * shortened to their first 12, as docker ps does. Both forms are accepted as
+ * argument, wildcards list the short form.
+ */
+#include "conf.h"
+
+#include <sys/types.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "symon.h"
+#include "sysroot.h"
+#include "xmalloc.h"
+
+#define CG_IDLEN        12      /* hex digits kept of a container id */
+#define CG_IDLE         64      /* measurements before an unused group is closed */
+
+/* Globals for this module start with cg_ */
+enum { CG_CPU, CG_MEMCURRENT, CG_MEMSTAT, CG_IO, CG_PIDS, CG_NFILES };
+
+enum { CG_USAGE, CG_USER, CG_SYSTEM, CG_NRTHROTTLED, CG_THROTTLED, CG_MEM,
+       CG_ANON, CG_FILE, CG_PGMAJFAULT, CG_RBYTES, CG_WBYTES, CG_RIOS,
+       CG_WIOS, CG_NPIDS, CG_NVALUES };
+
+static char *cg_files[CG_NFILES] = {
+    "cpu.stat", "memory.current", "memory.stat", "io.stat", "pids.current"
+};
+
+/* Keys of the interface files; single value files have an empty key */
+static struct {
+    int file;
+    char *key;
+    int value;
+} cg_keys[] = {
+    { CG_CPU, "usage_usec", CG_USAGE },
+    { CG_CPU, "user_usec", CG_USER },
+    { CG_CPU, "system_usec", CG_SYSTEM },
+    { CG_CPU, "nr_throttled", CG_NRTHROTTLED },
+    { CG_CPU, "throttled_usec", CG_THROTTLED },
+    { CG_MEMCURRENT, "", CG_MEM },
+    { CG_MEMSTAT, "anon", CG_ANON },
+    { CG_MEMSTAT, "file", CG_FILE },
+    { CG_MEMSTAT, "pgmajfault", CG_PGMAJFAULT },
+    { CG_IO, "rbytes", CG_RBYTES },
+    { CG_IO, "wbytes", CG_WBYTES },
+    { CG_IO, "rios", CG_RIOS },
+    { CG_IO, "wios", CG_WIOS },
+    { CG_PIDS, "", CG_NPIDS }
+};
+
+struct cg_group {
+    char *name;
+    int dirfd;                  /* -1 while closed */
+    int fd[CG_NFILES];          /* -1 if the controller is not enabled */
+    int missing;                /* group did not exist at the last read */
+    int valid;
+    u_int64_t read;             /* measurement of the last read */
+    u_int64_t value[CG_NVALUES];
+};
+
+static int cg_rootfd = -1;
+static struct cg_group *cg_groups = NULL;
+static int cg_ngroups = 0;
+static char *cg_buf = NULL;
+static size_t cg_buflen = 4096;
+static u_int64_t cg_tick = 0;
+
+__BEGIN_DECLS
+static void cg_shorten(char *, size_t, const char *);
+static int cg_openat(int, char *);
+static int cg_open(struct cg_group *);
+static void cg_close(struct cg_group *);
+static ssize_t cg_pread(int);
+static void cg_add(struct cg_group *, int, char *, char *);
+static void cg_parse(struct cg_group *, int, char *);
+static void cg_read(struct cg_group *);
+static int cg_find(char *);
+static void cg_list(int, char *, size_t, void (*) (char *, void *), void *);
+__END_DECLS
+
+/* Copy a name, shortening runs of more than CG_IDLEN hex digits */
+static void
+cg_shorten(char *buf, size_t len, const char *name)
+{
+    size_t i, run;
+
+    for (i = 0, run = 0; *name && i < len - 1; name++) {
+        run = ((*name >= '0' && *name <= '9') ||
+               (*name >= 'a' && *name <= 'f')) ? run + 1 : 0;
+        if (run <= CG_IDLEN)
+            buf[i++] = *name;
+    }
+    buf[i] = '\0';
+}
+
+/* Open a child group directory by its full or short name */
+static int
+cg_openat(int dirfd, char *name)
+{
+    char shortname[MAX_PATH_LEN];
+    struct dirent *e;
+    DIR *dir;
+    int fd;
+
+    if ((fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) != -1 ||
+        errno != ENOENT)
+        return fd;
+
+    /* a dup would share its directory offset with concurrent lookups */
+    if ((fd = openat(dirfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+        return -1;
+    if ((dir = fdopendir(fd)) == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    fd = -1;
+    while ((e = readdir(dir)) != NULL) {
+        cg_shorten(shortname, sizeof(shortname), e->d_name);
+        if (strcmp(shortname, name) == 0) {
+            fd = openat(dirfd, e->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            break;
+        }
+    }
+    closedir(dir);
+
+    return fd;
+}
+
+/* Open the directory of a group by its full or short path; returns -1 if the
+ * group does not exist */
+int
+open_cgroup(char *name)
+{
+    char path[MAX_PATH_LEN];
+    char *p, *component;
+    int fd, next;
+
+    if (cg_rootfd == -1 ||
+        (fd = openat(cg_rootfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+        return -1;
+
+    strlcpy(path, name, sizeof(path));
+
+    for (p = path; fd != -1 && (component = strsep(&p, "/")) != NULL;) {
+        if (*component == '\0')
+            continue;
+        next = cg_openat(fd, component);
+        close(fd);
+        fd = next;
+    }
+
+    return fd;
+}
+
+/* Open the directory and interface files of a group; returns 0 if the group
+ * does not exist */
+static int
+cg_open(struct cg_group *g)
+{
+    int fd, i;
+
+    if ((fd = open_cgroup(g->name)) == -1)
+        return 0;
+
+    g->dirfd = fd;
+    for (i = 0; i < CG_NFILES; i++)
+        g->fd[i] = openat(fd, cg_files[i], O_RDONLY | O_CLOEXEC);
+
+    return 1;
+}
+
+static void
+cg_close(struct cg_group *g)
+{
+    int i;
+
+    for (i = 0; i < CG_NFILES; i++) {
+        if (g->fd[i] != -1)
+            close(g->fd[i]);
+        g->fd[i] = -1;
+    }
+    if (g->dirfd != -1)
+        close(g->dirfd);
+    g->dirfd = -1;
+}
+
+/* Read an interface file into cg_buf */
+static ssize_t
+cg_pread(int fd)
+{
+    ssize_t n;
+    size_t len;
+
+    len = 0;
+    while ((n = pread(fd, cg_buf + len, cg_buflen - len - 1, len)) > 0) {
+        len += n;
+        if (len == cg_buflen - 1) {
+            if (cg_buflen * 2 > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS)
+                break;
+            cg_buflen *= 2;
+            cg_buf = xrealloc(cg_buf, cg_buflen);
+        }
+    }
+
+    if (n < 0)
+        return -1;
+
+    cg_buf[len] = '\0';
+    return len;
+}
+
+static void
+cg_add(struct cg_group *g, int file, char *key, char *value)
+{
+    int i;
+
+    for (i = 0; i < (int) (sizeof(cg_keys) / sizeof(cg_keys[0])); i++)
+        if (cg_keys[i].file == file && strcmp(cg_keys[i].key, key) == 0) {
+            g->value[cg_keys[i].value] += strtoull(value, NULL, 10);
+            return;
+        }
+}
+
+/*
+ * Parse an interface file. cpu.stat and memory.stat are "key value" lines,
+ * io.stat has a line of "key=value" pairs per device, which are summed.
+ */
+static void
+cg_parse(struct cg_group *g, int file, char *buf)
+{
+    char *line, *word, *value;
+
+    if (file == CG_MEMCURRENT || file == CG_PIDS) {
+        cg_add(g, file, "", buf);
+        return;
+    }
+
+    while ((line = strsep(&buf, "\n")) != NULL) {
+        if (file == CG_IO) {
+            /* skip the major:minor of the device */
+            strsep(&line, " ");
+            while ((word = strsep(&line, " ")) != NULL)
+                if ((value = strchr(word, '=')) != NULL) {
+                    *value++ = '\0';
+                    cg_add(g, file, word, value);
+                }
+        } else if ((value = strchr(line, ' ')) != NULL) {
+            *value++ = '\0';
+            cg_add(g, file, line, value);
+        }
+    }
+}
+
+static void
+cg_read(struct cg_group *g)
+{
+    int i;
+
+    g->read = cg_tick;
+    g->valid = 0;
+    bzero(g->value, sizeof(g->value));
+
+    if (g->dirfd == -1 && !cg_open(g)) {
+        if (!g->missing)
+            warning("cgroup: group '%.200s' does not exist", g->name);
+        g->missing = 1;
+        return;
+    }
+
+    for (i = 0; i < CG_NFILES; i++) {
+        if (g->fd[i] == -1)
+            continue;
+
+        /* files of a removed group fail with ENODEV; it is looked up again
+         * at the next measurement */
+        if (cg_pread(g->fd[i]) < 0) {
+            cg_close(g);
+            return;
+        }
+        cg_parse(g, i, cg_buf);
+    }
+
+    if (g->missing)
+        info("cgroup: group '%.200s' found", g->name);
+    g->missing = 0;
+    g->valid = 1;
+}
+
+/* Return the group of a name; unused groups are recycled */
+static int
+cg_find(char *name)
+{
+    int i, slot;
+
+    slot = -1;
+    for (i = 0; i < cg_ngroups; i++) {
+        if (strcmp(cg_groups[i].name, name) == 0)
+            return i;
+        if (slot == -1 && cg_groups[i].dirfd == -1 &&
+            cg_groups[i].read + CG_IDLE < cg_tick)
+            slot = i;
+    }
+
+    if (slot == -1) {
+        if (cg_ngroups >= SYMON_MAX_DOBJECTS)
+            fatal("%s:%d: dynamic object limit (%d) exceeded for cgroup data",
+                  __FILE__, __LINE__, SYMON_MAX_DOBJECTS);
+
+        cg_groups = xrealloc(cg_groups, (cg_ngroups + 1) * sizeof(struct cg_group));
+        slot = cg_ngroups++;
+    } else {
+        xfree(cg_groups[slot].name);
+    }
+
+    bzero(&cg_groups[slot], sizeof(struct cg_group));
+    cg_groups[slot].name = xstrdup(name);
+    cg_groups[slot].dirfd = -1;
+    for (i = 0; i < CG_NFILES; i++)
+        cg_groups[slot].fd[i] = -1;
+    cg_groups[slot].read = cg_tick;
+
+    return slot;
+}
+
+/* Open the cgroup v2 mount before privileges are dropped; returns 0 if there
+ * is none */
+int
+open_cgroup_root(void)
+{
+    char path[MAX_PATH_LEN];
+
+    if (cg_rootfd != -1)
+        return 1;
+
+    /* hybrid hierarchies mount cgroup v2 below the v1 controllers */
+    if ((cg_rootfd = open(sysfs_path(path, sizeof(path), "fs/cgroup"),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+        return 0;
+
+    if (faccessat(cg_rootfd, "cgroup.controllers", F_OK, 0) == -1) {
+        close(cg_rootfd);
+        cg_rootfd = open(sysfs_path(path, sizeof(path), "fs/cgroup/unified"),
+                         O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+
+    return (cg_rootfd != -1);
+}
+
+void
+privinit_cgroup(void)
+{
+    char path[MAX_PATH_LEN];
+
+    if (!open_cgroup_root())
+        fatal("cgroup: no cgroup v2 hierarchy mounted on %.200s",
+              sysfs_path(path, sizeof(path), "fs/cgroup"));
+
+    if (cg_buf == NULL)
+        cg_buf = xmalloc(cg_buflen);
+}
+
+void
+init_cgroup(struct stream *st)
+{
+    privinit_cgroup();
+
+    st->parg.cgroup = cg_find(st->arg);
+
+    info("started module cgroup(%.200s)", st->arg);
+}
+
+void
+gets_cgroup(void)
+{
+    int i;
+
+    cg_tick++;
+
+    /* groups of streams that were removed keep their directories busy */
+    for (i = 0; i < cg_ngroups; i++)
+        if (cg_groups[i].dirfd != -1 && cg_groups[i].read + CG_IDLE < cg_tick)
+            cg_close(&cg_groups[i]);
+}
+
+int
+get_cgroup(char *symon_buf, int maxlen, struct stream *st)
+{
+    struct cg_group *g;
+
+    /* the group may have been recycled for another stream */
+    if (strcmp(cg_groups[st->parg.cgroup].name, st->arg) != 0)
+        st->parg.cgroup = cg_find(st->arg);
+
+    g = &cg_groups[st->parg.cgroup];
+    if (g->read != cg_tick)
+        cg_read(g);
+
+    if (!g->valid)
+        return 0;
+
+    return snpack(symon_buf, maxlen, st->arg, MT_CGROUP,
+                  g->value[CG_USAGE],
+                  g->value[CG_USER],
+                  g->value[CG_SYSTEM],
+                  g->value[CG_NRTHROTTLED],
+                  g->value[CG_THROTTLED],
+                  g->value[CG_MEM],
+                  g->value[CG_ANON],
+                  g->value[CG_FILE],
+                  g->value[CG_PGMAJFAULT],
+                  g->value[CG_RBYTES],
+                  g->value[CG_WBYTES],
+                  g->value[CG_RIOS],
+                  g->value[CG_WIOS],
+                  g->value[CG_NPIDS]);
+}
+
+/* List the groups below dirfd; path holds the short name of dirfd */
+static void
+cg_list(int dirfd, char *path, size_t len, void (*object) (char *, void *), void *arg)
+{
+    char name[MAX_PATH_LEN];
+    struct dirent *e;
+    size_t n;
+    DIR *dir;
+    int fd;
+
+    if ((fd = openat(dirfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+        return;
+    if ((dir = fdopendir(fd)) == NULL) {
+        close(fd);
+        return;
+    }
+
+    n = strlen(path);
+    while ((e = readdir(dir)) != NULL) {
+        if (e->d_type != DT_DIR || e->d_name[0] == '.')
+            continue;
+
+        cg_shorten(name, sizeof(name), e->d_name);
+        if (snprintf(path + n, len - n, "%s%s", n ? "/" : "", name) >= (int) (len - n))
+            continue;
+
+        object(path, arg);
+
+        if ((fd = openat(dirfd, e->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) != -1) {
+            cg_list(fd, path, len, object, arg);
+            close(fd);
+        }
+    }
+    path[n] = '\0';
+
+    closedir(dir);
+}
+
+/* List all groups by their short names */
+void
+list_cgroup(void (*object) (char *, void *), void *arg)
+{
+    char path[MAX_PATH_LEN];
+
+    if (cg_rootfd == -1)
+        return;
+
+    path[0] = '\0';
+    cg_list(cg_rootfd, path, sizeof(path), object, arg);
+}
@@ -49,35 +49,130 @@
 
 #include "conf.h"
 #include "error.h"
+#include "nameindex.h"
 #include "percentages.h"
+#include "snapshot.h"
 #include "symon.h"
+#include "sysroot.h"
 #include "xmalloc.h"
 
 /* Globals for this module all start with cp_ */
-static void *cp_buf = NULL;
-static int cp_size = 0;
-static int cp_maxsize = 0;
+static struct snapshot *cp_stat = NULL;
 
-static int fd;
+/*
+ * The cpu lines of /proc/stat are parsed once per tick into a table indexed
+ * by name. cpu and cpuiow share it through the snapshot of /proc/stat.
+ */
+struct cpu_stats {
+    struct cpu_stat *cpus;
+    int count;
+    int maxcount;
+    struct nameindex index;
+};
+
+__BEGIN_DECLS
+static void parse_cpu_stat(struct snapshot *);
+__END_DECLS
+
+static void
+parse_cpu_stat(struct snapshot *s)
+{
+    struct cpu_stats *cs = s->data;
+    struct cpu_stat *cpu;
+    char *line, *p, *end;
+    size_t len;
+    int i;
+
+    if (cs == NULL) {
+        cs = s->data = xmalloc(sizeof(struct cpu_stats));
+        bzero(cs, sizeof(struct cpu_stats));
+    }
+    cs->count = 0;
+
+    /* cpu3 1034 0 3425 89324 119 0 33 0 0 0 */
+    for (line = s->buf; line < s->buf + s->len && strncmp(line, "cpu", 3) == 0; line = end + 1) {
+        if ((end = strchr(line, '\n')) == NULL)
+            end = s->buf + s->len;
+
+        if ((p = strchr(line, ' ')) == NULL || p > end)
+            break;
+        len = p - line;
+        if (len >= sizeof(cpu->name))
+            continue;
+
+        if (cs->count == cs->maxcount) {
+            cs->maxcount = (cs->maxcount == 0) ? 32 : cs->maxcount * 2;
+            cs->cpus = xrealloc(cs->cpus, cs->maxcount * sizeof(struct cpu_stat));
+        }
+
+        cpu = &cs->cpus[cs->count];
+        memcpy(cpu->name, line, len);
+        cpu->name[len] = '\0';
+        bzero(cpu->time, sizeof(cpu->time));
+
+        for (i = 0; i < CPUSTATES; i++) {
+            cpu->time[i] = strtoll(p, &line, 10);
+            if (line == p || line > end)
+                break;
+            p = line;
+        }
+
+        /* /proc/stat might not support steal */
+        if (i >= CP_STEAL)
+            cs->count++;
+        else
+            warning("could not parse cpu statistics for %.200s", cpu->name);
+    }
+
+    nameindex_build(&cs->index, cs->cpus, cs->count, sizeof(struct cpu_stat));
+}
+
+struct snapshot *
+open_cpu_stat(void)
+{
+    char path[MAX_PATH_LEN];
+
+    return open_snapshot(procfs_path(path, sizeof(path), "stat"), parse_cpu_stat);
+}
+
+/* Find a cpu line in a locked snapshot of /proc/stat */
+struct cpu_stat *
+find_cpu_stat(struct snapshot *s, const char *name)
+{
+    struct cpu_stats *cs = s->data;
+    int i;
+
+    if (cs == NULL ||
+        (i = nameindex_lookup(&cs->index, cs->cpus, sizeof(struct cpu_stat), name)) < 0)
+        return NULL;
+
+    return &cs->cpus[i];
+}
+
+/* Get all cpu lines of a locked snapshot of /proc/stat */
+struct cpu_stat *
+list_cpu_stat(struct snapshot *s, int *count)
+{
+    struct cpu_stats *cs = s->data;
+
+    *count = (cs == NULL) ? 0 : cs->count;
+
+    return (cs == NULL) ? NULL : cs->cpus;
+}
 
 void
 init_cpu(struct stream *st)
 {
     char buf[SYMON_MAX_OBJSIZE];
 
-    if (cp_buf == NULL) {
-        cp_maxsize = SYMON_MAX_OBJSIZE;
-        cp_buf = xmalloc(cp_maxsize);
-    }
-
     if (st->arg != NULL && isdigit(*st->arg)) {
         snprintf(st->parg.cp.name, sizeof(st->parg.cp.name), "cpu%s", st->arg);
     } else {
         snprintf(st->parg.cp.name, sizeof(st->parg.cp.name), "cpu");
     }
 
-    if ((fd = open("/proc/stat", O_RDONLY)) < 0)
-        warning("cannot access /proc/stat: %.200s", strerror(errno));
+    if (cp_stat == NULL)
+        cp_stat = open_cpu_stat();
 
     gets_cpu();
     get_cpu(buf, sizeof(buf), st);
@@ -88,67 +183,28 @@ init_cpu(struct stream *st)
 void
 gets_cpu(void)
 {
-    if (lseek(fd, 0, SEEK_SET) != 0)
-        fatal("/proc/stat seek error: %.200s", strerror(errno));
-
-    bzero(cp_buf, cp_maxsize);
-    cp_size = read(fd, cp_buf, cp_maxsize);
-
-    if (cp_size == cp_maxsize) {
-        /* buffer is too small to hold all interface data */
-        cp_maxsize += SYMON_MAX_OBJSIZE;
-        if (cp_maxsize > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS) {
-            fatal("%s:%d: dynamic object limit (%d) exceeded for cp data",
-                  __FILE__, __LINE__, SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS);
-        }
-        cp_buf = xrealloc(cp_buf, cp_maxsize);
-        gets_cpu();
-        return;
-    }
-
-    if (cp_size == -1) {
-        warning("could not read if statistics from /proc/stat: %.200s", strerror(errno));
-    }
+    lock_snapshot(cp_stat);
+    unlock_snapshot(cp_stat);
 }
 
 int
 get_cpu(char *symon_buf, int maxlen, struct stream *st)
 {
-    char *line;
+    struct cpu_stat *cpu;
 
-    if (cp_size <= 0) {
+    if (!lock_snapshot(cp_stat)) {
+        unlock_snapshot(cp_stat);
         return 0;
     }
 
-    if ((line = strstr(cp_buf, st->parg.cp.name)) == NULL) {
+    if ((cpu = find_cpu_stat(cp_stat, st->parg.cp.name)) == NULL) {
+        unlock_snapshot(cp_stat);
         warning("could not find %s", st->parg.cp.name);
         return 0;
     }
 
-    line += strlen(st->parg.cp.name);
-    if (CPUSTATES > sscanf(line, "%" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 "\n",
-                           &st->parg.cp.time[CP_USER],
-                           &st->parg.cp.time[CP_NICE],
-                           &st->parg.cp.time[CP_SYS],
-                           &st->parg.cp.time[CP_IDLE],
-                           &st->parg.cp.time[CP_IOWAIT],
-                           &st->parg.cp.time[CP_HARDIRQ],
-                           &st->parg.cp.time[CP_SOFTIRQ],
-                           &st->parg.cp.time[CP_STEAL])) {
-      /* /proc/stat might not support steal */
-      st->parg.cp.time[CP_STEAL] = 0;
-      if ((CPUSTATES - 1) > sscanf(line, "%" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 "\n",
-				   &st->parg.cp.time[CP_USER],
-				   &st->parg.cp.time[CP_NICE],
-				   &st->parg.cp.time[CP_SYS],
-				   &st->parg.cp.time[CP_IDLE],
-				   &st->parg.cp.time[CP_IOWAIT],
-				   &st->parg.cp.time[CP_HARDIRQ],
-				   &st->parg.cp.time[CP_SOFTIRQ])) {
-        warning("could not parse cpu statistics for %.200s", &st->parg.cp.name);
-        return 0;
-      }
-    }
+    bcopy(cpu->time, st->parg.cp.time, sizeof(st->parg.cp.time));
+    unlock_snapshot(cp_stat);
 
     percentages(CPUSTATES, st->parg.cp.states, st->parg.cp.time,
                 st->parg.cp.old, st->parg.cp.diff);
@@ -50,33 +50,27 @@
 #include "conf.h"
 #include "error.h"
 #include "percentages.h"
+#include "snapshot.h"
 #include "symon.h"
+#include "sysroot.h"
 #include "xmalloc.h"
 
-/* Globals for this module all start with cpw_ */
-static void *cpw_buf = NULL;
-static int cpw_size = 0;
-static int cpw_maxsize = 0;
-static int fd;
+/* Globals for this module all start with cpw_; /proc/stat is parsed by sm_cpu */
+static struct snapshot *cpw_stat = NULL;
 
 void
 init_cpuiow(struct stream *st)
 {
     char buf[SYMON_MAX_OBJSIZE];
 
-    if (cpw_buf == NULL) {
-        cpw_maxsize = SYMON_MAX_OBJSIZE;
-        cpw_buf = xmalloc(cpw_maxsize);
-    }
-
     if (st->arg != NULL && isdigit(*st->arg)) {
         snprintf(st->parg.cpw.name, sizeof(st->parg.cpw.name), "cpu%s", st->arg);
     } else {
         snprintf(st->parg.cpw.name, sizeof(st->parg.cpw.name), "cpu");
     }
 
-    if ((fd = open("/proc/stat", O_RDONLY)) < 0)
-        warning("cannot access /proc/stat: %.200s", strerror(errno));
+    if (cpw_stat == NULL)
+        cpw_stat = open_cpu_stat();
 
     gets_cpuiow();
     get_cpuiow(buf, sizeof(buf), st);
@@ -87,67 +81,28 @@ init_cpuiow(struct stream *st)
 void
 gets_cpuiow(void)
 {
-    if (lseek(fd, 0, SEEK_SET) != 0)
-        fatal("/proc/stat seek error: %.200s", strerror(errno));
-
-    bzero(cpw_buf, cpw_maxsize);
-    cpw_size = read(fd, cpw_buf, cpw_maxsize);
-
-    if (cpw_size == cpw_maxsize) {
-        /* buffer is too small to hold all interface data */
-        cpw_maxsize += SYMON_MAX_OBJSIZE;
-        if (cpw_maxsize > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS) {
-            fatal("%s:%d: dynamic object limit (%d) exceeded for cp data",
-                  __FILE__, __LINE__, SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS);
-        }
-        cpw_buf = xrealloc(cpw_buf, cpw_maxsize);
-        gets_cpuiow();
-        return;
-    }
-
-    if (cpw_size == -1) {
-        warning("could not read if statistics from /proc/stat: %.200s", strerror(errno));
-    }
+    lock_snapshot(cpw_stat);
+    unlock_snapshot(cpw_stat);
 }
 
 int
 get_cpuiow(char *symon_buf, int maxlen, struct stream *st)
 {
-    char *line;
+    struct cpu_stat *cpu;
 
-    if (cpw_size <= 0) {
+    if (!lock_snapshot(cpw_stat)) {
+        unlock_snapshot(cpw_stat);
         return 0;
     }
 
-    if ((line = strstr(cpw_buf, st->parg.cpw.name)) == NULL) {
+    if ((cpu = find_cpu_stat(cpw_stat, st->parg.cpw.name)) == NULL) {
+        unlock_snapshot(cpw_stat);
         warning("could not find %s", st->parg.cpw.name);
         return 0;
     }
 
-    line += strlen(st->parg.cpw.name);
-    if (CPUSTATES > sscanf(line, "%" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 "\n",
-                           &st->parg.cp.time[CP_USER],
-                           &st->parg.cp.time[CP_NICE],
-                           &st->parg.cp.time[CP_SYS],
-                           &st->parg.cp.time[CP_IDLE],
-                           &st->parg.cp.time[CP_IOWAIT],
-                           &st->parg.cp.time[CP_HARDIRQ],
-                           &st->parg.cp.time[CP_SOFTIRQ],
-                           &st->parg.cp.time[CP_STEAL])) {
-      /* /proc/stat might not support steal */
-      st->parg.cp.time[CP_STEAL] = 0;
-      if ((CPUSTATES - 1) > sscanf(line, "%" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 " %" SCNd64 "\n",
-				   &st->parg.cp.time[CP_USER],
-				   &st->parg.cp.time[CP_NICE],
-				   &st->parg.cp.time[CP_SYS],
-				   &st->parg.cp.time[CP_IDLE],
-				   &st->parg.cp.time[CP_IOWAIT],
-				   &st->parg.cp.time[CP_HARDIRQ],
-				   &st->parg.cp.time[CP_SOFTIRQ])) {
-        warning("could not parse cpu statistics for %.200s", &st->parg.cp.name);
-        return 0;
-      }
-    }
+    bcopy(cpu->time, st->parg.cpw.time, sizeof(st->parg.cpw.time));
+    unlock_snapshot(cpw_stat);
 
     percentages(CPUSTATES, st->parg.cpw.states, st->parg.cpw.time,
                 st->parg.cpw.old, st->parg.cpw.diff);
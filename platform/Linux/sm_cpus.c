@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Get the cpu statistics of all cpus in percentages and return them in
+ * symon_buf as a vector of
+ *
+ * user : nice : system : interrupt : idle
+ *
+ * for cpu0 to cpuN. All cpus are taken from a single parse of /proc/stat.
+ */
+
+#include <sys/types.h>
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "conf.h"
+#include "error.h"
+#include "percentages.h"
+#include "snapshot.h"
+#include "symon.h"
+#include "xmalloc.h"
+
+/* Globals for this module all start with cps_ */
+static struct snapshot *cps_stat = NULL;
+
+__BEGIN_DECLS
+static int cps_id(struct cpu_stat *);
+__END_DECLS
+
+/* Return the id of a cpuN line, or -1 for the total cpu line */
+static int
+cps_id(struct cpu_stat *cpu)
+{
+    if (!isdigit((unsigned char) cpu->name[3]))
+        return -1;
+
+    return (int) strtol(&cpu->name[3], NULL, 10);
+}
+
+void
+init_cpus(struct stream *st)
+{
+    struct cpu_stat *cpu;
+    char *buf;
+    int i, id, n;
+    size_t len;
+
+    if (cps_stat == NULL)
+        cps_stat = open_cpu_stat();
+
+    /* cpus are numbered up to the highest id present */
+    st->count = 0;
+    lock_snapshot(cps_stat);
+    cpu = list_cpu_stat(cps_stat, &n);
+    for (i = 0; i < n; i++)
+        if ((id = cps_id(&cpu[i])) >= st->count)
+            st->count = id + 1;
+    unlock_snapshot(cps_stat);
+
+    if (st->count == 0)
+        fatal("%s:%d: no cpus found", __FILE__, __LINE__);
+
+    if (st->count > SYMON_MAXCPUID) {
+        warning("cpus: only reporting cpu0 to cpu%d", SYMON_MAXCPUID - 1);
+        st->count = SYMON_MAXCPUID;
+    }
+
+    len = st->count * CPUSTATES * sizeof(int64_t);
+    st->parg.cps.time = xmalloc(len);
+    st->parg.cps.old = xmalloc(len);
+    st->parg.cps.diff = xmalloc(len);
+    st->parg.cps.states = xmalloc(len);
+    bzero(st->parg.cps.time, len);
+    bzero(st->parg.cps.old, len);
+
+    /* prime the old counters */
+    len = bytelen_stream(st) + 1;
+    buf = xmalloc(len);
+    gets_cpus();
+    get_cpus(buf, len, st);
+    xfree(buf);
+
+    info("started module cpus(%d cpus)", st->count);
+}
+
+void
+gets_cpus(void)
+{
+    lock_snapshot(cps_stat);
+    unlock_snapshot(cps_stat);
+}
+
+int
+get_cpus(char *symon_buf, int maxlen, struct stream *st)
+{
+    struct cpu_stat *cpu;
+    int64_t *states;
+    int i, id, n;
+    int offset;
+
+    if (!lock_snapshot(cps_stat)) {
+        unlock_snapshot(cps_stat);
+        return 0;
+    }
+
+    /* cpus that went offline keep their last counters */
+    cpu = list_cpu_stat(cps_stat, &n);
+    for (i = 0; i < n; i++)
+        if ((id = cps_id(&cpu[i])) >= 0 && id < st->count)
+            bcopy(cpu[i].time, &st->parg.cps.time[id * CPUSTATES], sizeof(cpu[i].time));
+    unlock_snapshot(cps_stat);
+
+    percentagesv(CPUSTATES, st->count, st->parg.cps.states, st->parg.cps.time,
+                 st->parg.cps.old, st->parg.cps.diff);
+
+    if ((offset = snpackv(symon_buf, maxlen, st->arg, MT_CPUS, st->count)) == 0)
+        return 0;
+
+    for (i = 0; i < st->count; i++) {
+        states = &st->parg.cps.states[i * CPUSTATES];
+        offset += snpackelem(symon_buf + offset, maxlen - offset, MT_CPUS,
+                             (double) (states[CP_USER] / 10.0),
+                             (double) (states[CP_NICE] / 10.0),
+                             (double) (states[CP_SYS] / 10.0),
+                             (double) (states[CP_IOWAIT] +
+                                       states[CP_HARDIRQ] +
+                                       states[CP_SOFTIRQ] +
+                                       states[CP_STEAL]) / 10.0,
+                             (double) (states[CP_IDLE] / 10.0));
+    }
+
+    return offset;
+}
@@ -34,28 +34,286 @@
  *
  *   blocks : bfree : bavail : files : ffree : 0 : 0
  *   syncwrites : asyncwrites are not available on linux
+ *
+ * Mounts are looked up in /proc/self/mountinfo, which is only reread when
+ * poll reports that the mount table changed. Every mount has its own thread
+ * that calls statvfs, so that a hung network filesystem only stalls that
+ * thread. gets_df waits SYMON_DFTIMEOUT for the threads; a mount that does not
+ * answer in time keeps reporting its last values and counts as an error of the
+ * df module in the self stream.
  */
 
-
 #include <sys/types.h>
+#include <sys/statvfs.h>
+
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
-#include <mntent.h>
+#include <stdlib.h>
 #include <string.h>
-#include <sys/statvfs.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "conf.h"
 #include "error.h"
+#include "selfstat.h"
 #include "symon.h"
 #include "diskname.h"
+#include "sysroot.h"
+#include "xmalloc.h"
+
+/* Globals for this module start with df_ */
+struct df_entry {
+    char *source;
+    char *path;
+};
+
+struct df_mount {
+    char source[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN];
+    struct statvfs vfs;         /* last result */
+    int error;                  /* errno of last statvfs */
+    int valid;                  /* vfs holds a result */
+    int mounted;                /* source is in the mount table */
+    int stale;                  /* warned about a late statvfs */
+    int asked;                  /* statvfs requested this tick */
+    u_int64_t request;          /* statvfs calls requested */
+    u_int64_t done;             /* statvfs calls finished */
+};
+
+static struct df_entry *df_entries = NULL;
+static int df_count = 0;
+static int df_max = 0;
+static char *df_buf = NULL;
+static int df_buflen = 0;
+static int df_fd = -1;
+
+static struct df_mount **df_mounts = NULL;
+static int df_nmounts = 0;
+
+static pthread_mutex_t df_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t df_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t df_done;          /* on CLOCK_MONOTONIC */
+
+/* Undo the octal escapes of spaces, tabs and newlines in mountinfo */
+static char *
+df_unescape(char *s)
+{
+    char *r, *w;
+
+    for (r = w = s; *r; r++, w++) {
+        if (r[0] == '\\' && r[1] >= '0' && r[1] <= '3' &&
+            r[2] >= '0' && r[2] <= '7' && r[3] >= '0' && r[3] <= '7') {
+            *w = ((r[1] - '0') << 6) | ((r[2] - '0') << 3) | (r[3] - '0');
+            r += 3;
+        } else {
+            *w = *r;
+        }
+    }
+    *w = '\0';
+
+    return s;
+}
+
+/*
+ * Parse mountinfo lines into df_entries:
+ *
+ * 36 35 98:0 /mnt1 /mnt/parent rw,noatime master:1 - ext3 /dev/root rw
+ *
+ * field 5 is the mount point; the source follows the fs type after '-'.
+ */
+static void
+df_parse(void)
+{
+    char *line, *next, *f[6], *p;
+    int i;
+
+    df_count = 0;
+    for (line = df_buf; line && *line; line = next) {
+        if ((next = strchr(line, '\n')) != NULL)
+            *next++ = '\0';
+
+        for (i = 0, p = line; i < 5; i++) {
+            f[i] = strsep(&p, " ");
+            if (f[i] == NULL)
+                break;
+        }
+        if (i < 5)
+            continue;
+
+        while ((f[5] = strsep(&p, " ")) != NULL && strcmp(f[5], "-") != 0)
+            ;
+        if (f[5] == NULL || strsep(&p, " ") == NULL || (f[5] = strsep(&p, " ")) == NULL)
+            continue;
+
+        if (df_count == df_max) {
+            df_max = df_max ? df_max * 2 : 32;
+            df_entries = xrealloc(df_entries, df_max * sizeof(struct df_entry));
+        }
+        df_entries[df_count].source = df_unescape(f[5]);
+        df_entries[df_count].path = df_unescape(f[4]);
+        df_count++;
+    }
+}
+
+/* Return the mount point of <source>, the last mount if it is mounted more
+ * than once */
+static char *
+df_lookup(char *source)
+{
+    int i;
+
+    for (i = df_count - 1; i >= 0; i--)
+        if (strcmp(df_entries[i].source, source) == 0)
+            return df_entries[i].path;
+
+    return NULL;
+}
+
+/* Reread the mount table if it changed; returns 1 if it was reread */
+static int
+df_mountinfo(void)
+{
+    char path[MAX_PATH_LEN];
+    struct pollfd pfd;
+    ssize_t n;
+    int len;
+
+    if (df_fd == -1) {
+        if ((df_fd = open(procfs_path(path, sizeof(path), "self/mountinfo"), O_RDONLY)) == -1)
+            fatal("df: cannot open %.200s: %.200s", path, strerror(errno));
+    } else {
+        /* the kernel flags a changed mount table with POLLPRI */
+        pfd.fd = df_fd;
+        pfd.events = POLLPRI;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & (POLLPRI | POLLERR)))
+            return 0;
+    }
+
+    if (lseek(df_fd, 0, SEEK_SET) == -1)
+        fatal("df: cannot rewind mountinfo: %.200s", strerror(errno));
+
+    len = 0;
+    for (;;) {
+        if (df_buflen - len < 2) {
+            df_buflen = df_buflen ? df_buflen * 2 : 16384;
+            df_buf = xrealloc(df_buf, df_buflen);
+        }
+        if ((n = read(df_fd, df_buf + len, df_buflen - len - 1)) < 0) {
+            if (errno == EINTR)
+                continue;
+            fatal("df: cannot read mountinfo: %.200s", strerror(errno));
+        }
+        if (n == 0)
+            break;
+        len += n;
+    }
+    df_buf[len] = '\0';
+
+    df_parse();
+
+    return 1;
+}
+
+/* Thread that runs the statvfs calls of a single mount */
+static void *
+df_worker(void *arg)
+{
+    struct df_mount *m = arg;
+    char path[MAX_PATH_LEN];
+    struct statvfs vfs;
+    u_int64_t request;
+    int r;
+
+    for (;;) {
+        pthread_mutex_lock(&df_mutex);
+        while (m->done == m->request)
+            pthread_cond_wait(&df_work, &df_mutex);
+        request = m->request;
+        strlcpy(path, m->path, sizeof(path));
+        pthread_mutex_unlock(&df_mutex);
+
+        r = statvfs(path, &vfs);
+
+        pthread_mutex_lock(&df_mutex);
+        if (r == 0) {
+            memcpy(&m->vfs, &vfs, sizeof(struct statvfs));
+            m->valid = 1;
+            m->error = 0;
+        } else {
+            m->valid = 0;
+            m->error = errno;
+        }
+        m->done = request;
+        pthread_cond_broadcast(&df_done);
+        pthread_mutex_unlock(&df_mutex);
+    }
+
+    /* NOT REACHED */
+    return NULL;
+}
+
+/* Find or start the worker of the mount of <source> at <path> */
+static int
+df_mount(char *source, char *path)
+{
+    struct df_mount *m;
+    pthread_condattr_t attr;
+    pthread_t thread;
+    sigset_t all, old;
+    int i;
+
+    for (i = 0; i < df_nmounts; i++)
+        if (strcmp(df_mounts[i]->source, source) == 0)
+            return i;
+
+    /* the wait for statvfs must not move with wall clock steps */
+    if (df_nmounts == 0) {
+        pthread_condattr_init(&attr);
+        if ((errno = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC)) != 0 ||
+            (errno = pthread_cond_init(&df_done, &attr)) != 0)
+            fatal("df: cannot set up workers: %.200s", strerror(errno));
+        pthread_condattr_destroy(&attr);
+    }
+
+    if (df_nmounts > SYMON_MAX_DOBJECTS)
+        fatal("%s:%d: dynamic object limit (%d) exceeded for df data",
+              __FILE__, __LINE__, SYMON_MAX_DOBJECTS);
+
+    /* mounts are never freed; their worker may be stuck in statvfs */
+    m = xmalloc(sizeof(struct df_mount));
+    bzero(m, sizeof(struct df_mount));
+    strlcpy(m->source, source, sizeof(m->source));
+    strlcpy(m->path, path, sizeof(m->path));
+    m->mounted = 1;
+
+    /* signals are handled by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    if ((errno = pthread_create(&thread, NULL, df_worker, m)) != 0)
+        fatal("df: cannot start worker for %.200s: %.200s", path, strerror(errno));
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_detach(thread);
+
+    pthread_mutex_lock(&df_mutex);
+    df_mounts = xrealloc(df_mounts, (df_nmounts + 1) * sizeof(struct df_mount *));
+    df_mounts[df_nmounts] = m;
+    pthread_mutex_unlock(&df_mutex);
+
+    return df_nmounts++;
+}
 
 void
 init_df(struct stream *st)
 {
     struct disknamectx c;
     char drivename[MAX_PATH_LEN];
-    FILE *fp;
-    struct mntent *mount;
+    char path[MAX_PATH_LEN];
+    char *p;
 
     if (st->arg == NULL)
         fatal("df: need a <disk device|name> argument");
@@ -63,29 +321,93 @@ init_df(struct stream *st)
     initdisknamectx(&c, st->arg, drivename, sizeof(drivename));
 
     while (nextdiskname(&c)) {
-        fp = setmntent("/etc/mtab", "r");
+        pthread_mutex_lock(&df_mutex);
+        df_mountinfo();
+        if ((p = df_lookup(drivename)) != NULL)
+            strlcpy(path, p, sizeof(path));
+        pthread_mutex_unlock(&df_mutex);
 
-        if (fp == NULL)
-            fatal("df: cannot access /etc/mtab: %.200s", strerror(errno));
+        if (p != NULL) {
+            st->parg.df.mount = df_mount(drivename, path);
+            info("started module df(%.200s = %.200s)", st->arg, path);
+            return;
+        }
+    }
 
-        while ((mount = getmntent(fp))) {
-            if (strncmp(mount->mnt_fsname, drivename, sizeof(drivename)) == 0) {
-                strlcpy(st->parg.df.mountpath, mount->mnt_dir, sizeof(st->parg.df.mountpath));
-                info("started module df(%.200s = %.200s)", st->arg, st->parg.df.mountpath);
-                endmntent(fp);
-                return;
+    st->parg.df.mount = -1;
+    warning("df(%.200s): not mounted", st->arg);
+}
+
+void
+gets_df(void)
+{
+    struct df_mount *m;
+    struct timespec ts;
+    u_int64_t deadline;
+    char *path;
+    int i, waiting;
+
+    pthread_mutex_lock(&df_mutex);
+
+    /* follow mounts that moved or went away */
+    if (df_mountinfo()) {
+        for (i = 0; i < df_nmounts; i++) {
+            m = df_mounts[i];
+            if ((path = df_lookup(m->source)) != NULL) {
+                if (!m->mounted || strcmp(path, m->path) != 0)
+                    info("df: %.200s is mounted on %.200s", m->source, path);
+                strlcpy(m->path, path, sizeof(m->path));
+                m->mounted = 1;
+            } else if (m->mounted) {
+                info("df: %.200s is no longer mounted", m->source);
+                m->mounted = 0;
             }
         }
+    }
 
-        endmntent(fp);
+    /* mounts whose last statvfs is still running are not asked again, and
+     * not waited for */
+    for (i = 0; i < df_nmounts; i++) {
+        m = df_mounts[i];
+        if ((m->asked = (m->mounted && m->done == m->request)))
+            m->request++;
     }
+    pthread_cond_broadcast(&df_work);
 
-    warning("df(%.200s): not mounted", st->arg);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    deadline = ((u_int64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000) + SYMON_DFTIMEOUT;
+    ts.tv_sec = deadline / 1000;
+    ts.tv_nsec = (deadline % 1000) * 1000000;
+
+    do {
+        for (i = waiting = 0; i < df_nmounts; i++)
+            if (df_mounts[i]->asked && df_mounts[i]->done != df_mounts[i]->request)
+                waiting++;
+    } while (waiting && pthread_cond_timedwait(&df_done, &df_mutex, &ts) != ETIMEDOUT);
+
+    pthread_mutex_unlock(&df_mutex);
 }
 
+/* List mounted disk devices by the name that init_df resolves */
 void
-gets_df(void)
+list_df(void (*object) (char *, void *), void *arg)
 {
+    char *name;
+    int i;
+
+    pthread_mutex_lock(&df_mutex);
+    df_mountinfo();
+
+    for (i = 0; i < df_count; i++) {
+        if (strncmp(df_entries[i].source, "/dev/", sizeof("/dev/") - 1) != 0)
+            continue;
+
+        /* /dev/mapper/vg-root is found as vg-root */
+        name = strrchr(df_entries[i].source, '/') + 1;
+        if (*name != '\0')
+            object(name, arg);
+    }
+    pthread_mutex_unlock(&df_mutex);
 }
 
 /*
@@ -104,9 +426,38 @@ fsbtoblk(u_int64_t num, u_int64_t fsbs, u_int64_t bs)
 int
 get_df(char *symon_buf, int maxlen, struct stream *st)
 {
+    struct df_mount *m;
     struct statvfs buf;
+    int error, valid;
+
+    if (st->parg.df.mount < 0)
+        return 0;
+
+    pthread_mutex_lock(&df_mutex);
+    m = df_mounts[st->parg.df.mount];
+
+    if (!m->mounted) {
+        pthread_mutex_unlock(&df_mutex);
+        return 0;
+    }
+
+    if (m->done != m->request) {
+        if (!m->stale)
+            warning("df(%.200s): statvfs of %.200s did not finish in %d ms; reporting its last values",
+                    st->arg, m->path, SYMON_DFTIMEOUT);
+        m->stale = 1;
+        error_selfstat(&self_module[MT_DF], 1);
+    } else if (m->stale) {
+        info("df(%.200s): statvfs of %.200s finishes in time again", st->arg, m->path);
+        m->stale = 0;
+    }
+
+    error = m->error;
+    if ((valid = m->valid))
+        memcpy(&buf, &m->vfs, sizeof(struct statvfs));
+    pthread_mutex_unlock(&df_mutex);
 
-    if (statvfs(st->parg.df.mountpath, &buf) == 0 ) {
+    if (valid) {
         return snpack(symon_buf, maxlen, st->arg, MT_DF,
                       (u_int64_t)fsbtoblk(buf.f_blocks, buf.f_bsize, SYMON_DFBLOCKSIZE),
                       (u_int64_t)fsbtoblk(buf.f_bfree, buf.f_bsize, SYMON_DFBLOCKSIZE),
@@ -117,6 +468,8 @@ get_df(char *symon_buf, int maxlen, struct stream *st)
                       (u_int64_t)0);
     }
 
-    warning("df(%.200s) failed", st->arg);
+    /* no error means that the first statvfs has not finished yet */
+    if (error)
+        warning("df(%.200s) failed: %.200s", st->arg, strerror(error));
     return 0;
 }
@@ -33,64 +33,455 @@
  *
  * ipackets : opackets : ibytes : obytes : imcasts : omcasts : ierrors :
  * oerrors : colls : drops
+ *
+ * Statistics are dumped over rtnetlink when available, with the same
+ * aggregation of error counters as /proc/net/dev. /proc/net/dev is parsed
+ * when netlink is not compiled in, cannot be opened or when the probes read
+ * a fixture tree.
  */
 
+#include <sys/param.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <net/if.h>
 
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "conf.h"
+
+#ifdef HAS_RTNETLINK
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
 #include "xmalloc.h"
 #include "error.h"
+#include "nameindex.h"
+#include "snapshot.h"
 #include "symon.h"
+#include "sysroot.h"
 
 /* Globals for this module start with if_ */
-static void *if_buf = NULL;
-static int if_size = 0;
-static int if_maxsize = 0;
 struct if_device_stats
 {
-    u_int64_t rx_packets;             /* total packets received       */
-    u_int64_t tx_packets;             /* total packets transmitted    */
     u_int64_t rx_bytes;               /* total bytes received         */
-    u_int64_t tx_bytes;               /* total bytes transmitted      */
+    u_int64_t rx_packets;             /* total packets received       */
     u_int64_t rx_errors;              /* bad packets received         */
-    u_int64_t tx_errors;              /* packet transmit problems     */
     u_int64_t rx_dropped;             /* no space in linux buffers    */
-    u_int64_t tx_dropped;             /* no space available in linux  */
+    u_int64_t rx_fifo_errors;         /* recv'r fifo overrun          */
+    u_int64_t rx_frame_errors;        /* recv'd frame alignment error */
+    u_int64_t rx_compressed;
     u_int64_t multicast;              /* multicast packets received   */
+    u_int64_t tx_bytes;               /* total bytes transmitted      */
+    u_int64_t tx_packets;             /* total packets transmitted    */
+    u_int64_t tx_errors;              /* packet transmit problems     */
+    u_int64_t tx_dropped;             /* no space available in linux  */
+    u_int64_t tx_fifo_errors;
     u_int64_t collisions;
-    u_int64_t rx_frame_errors;        /* recv'd frame alignment error */
-    u_int64_t rx_fifo_errors;         /* recv'r fifo overrun          */
     u_int64_t tx_carrier_errors;
-    u_int64_t tx_fifo_errors;
-    u_int64_t rx_compressed;
     u_int64_t tx_compressed;
-    /* aggregates */
-    u_int64_t errors_in;
-    u_int64_t errors_out;
-    u_int64_t drops;
 };
+#define IF_FIELDS (sizeof(struct if_device_stats) / sizeof(u_int64_t))
 
-static int fd;
+/*
+ * gets_if collects the statistics of all interfaces once per tick into
+ * if_entries and indexes them by name. get_if is then a lookup of an exact
+ * interface name.
+ */
+struct if_entry
+{
+    char name[IFNAMSIZ];
+    struct if_device_stats stats;
+};
+static struct if_entry *if_entries = NULL;
+static int if_count = 0;
+static int if_maxcount = 0;
+static struct nameindex if_index;
+static u_int64_t if_tick = 0;           /* tick of last measurement */
 
-void
-init_if(struct stream *st)
+#ifdef HAS_RTNETLINK
+int if_backend = IF_BACKEND_NETLINK;
+#else
+int if_backend = IF_BACKEND_PROCFS;
+#endif
+
+static struct snapshot *if_netdev = NULL;
+static int if_nlfd = -1;            /* rtnetlink */
+
+__BEGIN_DECLS
+static struct if_entry *if_newentry(void);
+static void if_open(void);
+static void if_parse(char *, size_t);
+static void gets_if_procfs(void);
+#ifdef HAS_RTNETLINK
+static int if_netlink_socket(u_int32_t);
+static int if_netlink_open(void);
+static int if_namecmp(const void *, const void *);
+static void if_netlink_entry(char *, struct rtnl_link_stats64 *);
+static void if_netlink_link(struct nlmsghdr *);
+static void if_netlink_stats(struct nlmsghdr *);
+static int if_netlink_dump(int, void *, size_t, void (*) (struct nlmsghdr *));
+static void gets_if_netlink(void);
+#endif
+__END_DECLS
+
+static struct if_entry *
+if_newentry(void)
+{
+    if (if_count == if_maxcount) {
+        if_maxcount = (if_maxcount == 0) ? 32 : if_maxcount * 2;
+        if_entries = xrealloc(if_entries, if_maxcount * sizeof(struct if_entry));
+    }
+
+    return &if_entries[if_count];
+}
+
+static void
+if_parse(char *buf, size_t size)
+{
+    struct if_entry *entry;
+    u_int64_t *field;
+    unsigned int i;
+    char *line, *p, *end;
+    size_t len;
+
+    /* Inter-|   Receive                                                |  Transmit
+     *  face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed
+     *    lo: 2776770   11307    0    0    0     0          0         0  2776770   11307    0    0    0     0       0          0
+     */
+    for (line = buf; line < buf + size; line = end + 1) {
+        if ((end = strchr(line, '\n')) == NULL)
+            end = buf + size;
+
+        if ((p = memchr(line, ':', end - line)) == NULL)
+            continue;
+
+        while (*line == ' ')
+            line++;
+        len = p - line;
+        if (len == 0 || len >= IFNAMSIZ)
+            continue;
+
+        entry = if_newentry();
+        memcpy(entry->name, line, len);
+        entry->name[len] = '\0';
+
+        field = (u_int64_t *) &entry->stats;
+        for (p++, i = 0; i < IF_FIELDS; i++) {
+            field[i] = strtoull(p, &line, 10);
+            if (line == p || line > end)
+                break;
+            p = line;
+        }
+
+        if (i == IF_FIELDS)
+            if_count++;
+        else
+            warning("could not parse interface statistics for %.200s", entry->name);
+    }
+}
+
+static void
+gets_if_procfs(void)
+{
+    if (lock_snapshot(if_netdev))
+        if_parse(if_netdev->buf, if_netdev->len);
+    unlock_snapshot(if_netdev);
+}
+
+#ifdef HAS_RTNETLINK
+/*
+ * Statistics are dumped with RTM_GETSTATS, filtered to the 64 bit link
+ * counters. Those messages only carry an ifindex; names come from a
+ * RTM_GETLINK dump that is repeated only when a link changes, as announced on
+ * a second socket subscribed to RTMGRP_LINK. Kernels without RTM_GETSTATS get
+ * the counters from the RTM_GETLINK dump every tick.
+ */
+#define IF_NETLINK_BUFSIZE 65536   /* dump messages that do not fit are truncated */
+static char *if_buf = NULL;
+
+struct if_name
+{
+    int index;
+    char name[IFNAMSIZ];
+};
+static struct if_name *if_names = NULL;
+static int if_namecount = 0;
+static int if_maxnames = 0;
+static int if_namesstale = 1;
+static int if_getstats = 1;
+static int if_monitor = -1;
+static u_int32_t if_seq = 0;
+
+static int
+if_netlink_socket(u_int32_t groups)
+{
+    struct sockaddr_nl snl;
+    int s;
+
+    if ((s = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) < 0) {
+        warning("cannot open rtnetlink socket: %.200s", strerror(errno));
+        return -1;
+    }
+
+    bzero(&snl, sizeof(snl));
+    snl.nl_family = AF_NETLINK;
+    snl.nl_groups = groups;
+    if (bind(s, (struct sockaddr *) &snl, sizeof(snl)) < 0) {
+        warning("cannot bind rtnetlink socket: %.200s", strerror(errno));
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+static int
+if_netlink_open(void)
+{
+    if ((if_nlfd = if_netlink_socket(0)) < 0)
+        return 0;
+
+    /* without link notifications names are refreshed every tick */
+    if ((if_monitor = if_netlink_socket(RTMGRP_LINK)) >= 0)
+        fcntl(if_monitor, F_SETFL, O_NONBLOCK);
+
+    if (if_buf == NULL)
+        if_buf = xmalloc(IF_NETLINK_BUFSIZE);
+
+    return 1;
+}
+
+static int
+if_namecmp(const void *a, const void *b)
+{
+    return ((const struct if_name *) a)->index - ((const struct if_name *) b)->index;
+}
+
+/* Copy counters into a new entry, aggregating like /proc/net/dev */
+static void
+if_netlink_entry(char *name, struct rtnl_link_stats64 *ls)
+{
+    struct if_entry *entry;
+
+    entry = if_newentry();
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->stats.rx_bytes = ls->rx_bytes;
+    entry->stats.rx_packets = ls->rx_packets;
+    entry->stats.rx_errors = ls->rx_errors;
+    entry->stats.rx_dropped = ls->rx_dropped + ls->rx_missed_errors;
+    entry->stats.rx_fifo_errors = ls->rx_fifo_errors;
+    entry->stats.rx_frame_errors = ls->rx_length_errors + ls->rx_over_errors +
+        ls->rx_crc_errors + ls->rx_frame_errors;
+    entry->stats.rx_compressed = ls->rx_compressed;
+    entry->stats.multicast = ls->multicast;
+    entry->stats.tx_bytes = ls->tx_bytes;
+    entry->stats.tx_packets = ls->tx_packets;
+    entry->stats.tx_errors = ls->tx_errors;
+    entry->stats.tx_dropped = ls->tx_dropped;
+    entry->stats.tx_fifo_errors = ls->tx_fifo_errors;
+    entry->stats.collisions = ls->collisions;
+    entry->stats.tx_carrier_errors = ls->tx_carrier_errors + ls->tx_aborted_errors +
+        ls->tx_window_errors + ls->tx_heartbeat_errors;
+    entry->stats.tx_compressed = ls->tx_compressed;
+    if_count++;
+}
+
+/* RTM_NEWLINK; record the name and, without RTM_GETSTATS, the counters */
+static void
+if_netlink_link(struct nlmsghdr *h)
 {
-    if (if_buf == NULL) {
-        if_maxsize = SYMON_MAX_OBJSIZE;
-        if_buf = xmalloc(if_maxsize);
+    struct ifinfomsg *ifi = NLMSG_DATA(h);
+    struct rtnl_link_stats64 ls;
+    struct rtattr *rta;
+    char *name = NULL;
+    int havestats = 0;
+    int len;
+
+    len = IFLA_PAYLOAD(h);
+    for (rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type) {
+        case IFLA_IFNAME:
+            name = RTA_DATA(rta);
+            break;
+        case IFLA_STATS64:
+            /* attribute payload is only 4 byte aligned */
+            bzero(&ls, sizeof(ls));
+            memcpy(&ls, RTA_DATA(rta), MIN(RTA_PAYLOAD(rta), sizeof(ls)));
+            havestats = 1;
+            break;
+        }
     }
 
-    snprintf(st->parg.ifname, sizeof(st->parg.ifname), "%s:", st->arg);
+    if (name == NULL || strlen(name) >= IFNAMSIZ)
+        return;
+
+    if (if_namecount == if_maxnames) {
+        if_maxnames = (if_maxnames == 0) ? 32 : if_maxnames * 2;
+        if_names = xrealloc(if_names, if_maxnames * sizeof(struct if_name));
+    }
+    if_names[if_namecount].index = ifi->ifi_index;
+    snprintf(if_names[if_namecount].name, IFNAMSIZ, "%s", name);
+    if_namecount++;
+
+    if (!if_getstats && havestats)
+        if_netlink_entry(name, &ls);
+}
+
+/* RTM_NEWSTATS; counters of a single link by index */
+static void
+if_netlink_stats(struct nlmsghdr *h)
+{
+    struct if_stats_msg *ifsm = NLMSG_DATA(h);
+    struct rtnl_link_stats64 ls;
+    struct if_name key, *n;
+    struct rtattr *rta;
+    int len;
+
+    key.index = ifsm->ifindex;
+    if ((n = bsearch(&key, if_names, if_namecount, sizeof(struct if_name), if_namecmp)) == NULL) {
+        /* a link that appeared since the last name dump */
+        if_namesstale = 1;
+        return;
+    }
+
+    len = h->nlmsg_len - NLMSG_LENGTH(sizeof(struct if_stats_msg));
+    for (rta = (struct rtattr *) ((char *) ifsm + NLMSG_ALIGN(sizeof(struct if_stats_msg)));
+         RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == IFLA_STATS_LINK_64) {
+            bzero(&ls, sizeof(ls));
+            memcpy(&ls, RTA_DATA(rta), MIN(RTA_PAYLOAD(rta), sizeof(ls)));
+            if_netlink_entry(n->name, &ls);
+            return;
+        }
+    }
+}
+
+/* Send a dump request and feed all replies to parse; returns 0 on error, with
+ * errno set */
+static int
+if_netlink_dump(int type, void *payload, size_t len, void (*parse) (struct nlmsghdr *))
+{
+    struct {
+        struct nlmsghdr h;
+        char payload[sizeof(struct if_stats_msg) + sizeof(struct ifinfomsg)];
+    } req;
+    struct nlmsgerr *err;
+    struct nlmsghdr *h;
+    int n;
+
+    bzero(&req, sizeof(req));
+    req.h.nlmsg_len = NLMSG_LENGTH(len);
+    req.h.nlmsg_type = type;
+    req.h.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.h.nlmsg_seq = ++if_seq;
+    memcpy(req.payload, payload, len);
+
+    if (send(if_nlfd, &req, req.h.nlmsg_len, 0) < 0)
+        return 0;
+
+    for (;;) {
+        if ((n = recv(if_nlfd, if_buf, IF_NETLINK_BUFSIZE, 0)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+
+        for (h = (struct nlmsghdr *) if_buf; NLMSG_OK(h, (unsigned int) n); h = NLMSG_NEXT(h, n)) {
+            if (h->nlmsg_seq != if_seq)
+                continue;
+            if (h->nlmsg_type == NLMSG_DONE)
+                return 1;
+            if (h->nlmsg_type == NLMSG_ERROR) {
+                err = NLMSG_DATA(h);
+                errno = (h->nlmsg_len >= NLMSG_LENGTH(sizeof(struct nlmsgerr)) &&
+                         err->error < 0) ? -err->error : EIO;
+                return 0;
+            }
+            parse(h);
+        }
+    }
+}
+
+static void
+gets_if_netlink(void)
+{
+    struct if_stats_msg ifsm;
+    struct ifinfomsg ifi;
+    char drain[SYMON_MAX_OBJSIZE];
 
-    if ((fd = open("/proc/net/dev", O_RDONLY)) < 0)
-        warning("cannot access /proc/net/dev: %.200s", strerror(errno));
+    /* any link notification invalidates the names */
+    if (if_monitor < 0)
+        if_namesstale = 1;
+    else
+        while (recv(if_monitor, drain, sizeof(drain), MSG_DONTWAIT) > 0)
+            if_namesstale = 1;
+
+    if (if_namesstale || !if_getstats) {
+        bzero(&ifi, sizeof(ifi));
+        ifi.ifi_family = AF_UNSPEC;
+        if_namecount = 0;
+        if_count = 0;
+        if (!if_netlink_dump(RTM_GETLINK, &ifi, sizeof(ifi), if_netlink_link)) {
+            warning("could not dump links: %.200s", strerror(errno));
+            if_count = 0;
+            return;
+        }
+        qsort(if_names, if_namecount, sizeof(struct if_name), if_namecmp);
+        if_namesstale = 0;
+    }
+
+    if (!if_getstats)
+        return;
+
+    bzero(&ifsm, sizeof(ifsm));
+    ifsm.family = AF_UNSPEC;
+    ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+    if (!if_netlink_dump(RTM_GETSTATS, &ifsm, sizeof(ifsm), if_netlink_stats)) {
+        /* errors such as ENOBUFS are retried at the next measurement */
+        if (errno == EOPNOTSUPP || errno == EINVAL) {
+            info("rtnetlink does not support RTM_GETSTATS; dumping links instead");
+            if_getstats = 0;
+            gets_if_netlink();
+        } else {
+            warning("could not dump link statistics: %.200s", strerror(errno));
+            if_count = 0;
+        }
+    }
+}
+#endif
+
+static void
+if_open(void)
+{
+    char path[MAX_PATH_LEN];
+
+    /* fixture trees only hold procfs */
+    if (strcmp(procfs_root, "/proc") != 0)
+        if_backend = IF_BACKEND_PROCFS;
+
+#ifdef HAS_RTNETLINK
+    if (if_nlfd < 0 && if_backend == IF_BACKEND_NETLINK && !if_netlink_open())
+        if_backend = IF_BACKEND_PROCFS;
+#endif
+
+    if (if_backend == IF_BACKEND_PROCFS && if_netdev == NULL)
+        if_netdev = open_snapshot(procfs_path(path, sizeof(path), "net/dev"), NULL);
+}
+
+void
+init_if(struct stream *st)
+{
+    snprintf(st->parg.ifname, sizeof(st->parg.ifname), "%s", st->arg);
+
+    if_open();
 
     info("started module if(%.200s)", st->arg);
 }
@@ -98,75 +489,60 @@ init_if(struct stream *st)
 void
 gets_if(void)
 {
-    if (lseek(fd, 0, SEEK_SET) != 0)
-        fatal("/proc/net/dev seek error: %.200s", strerror(errno));
+    if_count = 0;
+    if_tick = snapshot_tick();
 
-    bzero(if_buf, if_maxsize);
-    if_size = read(fd, if_buf, if_maxsize);
+#ifdef HAS_RTNETLINK
+    if (if_backend == IF_BACKEND_NETLINK)
+        gets_if_netlink();
+    else
+#endif
+        gets_if_procfs();
 
-    if (if_size == if_maxsize) {
-        /* buffer is too small to hold all interface data */
-        if_maxsize += SYMON_MAX_OBJSIZE;
-        if (if_maxsize > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS) {
-            fatal("%s:%d: dynamic object limit (%d) exceeded for if data",
-                  __FILE__, __LINE__, SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS);
-        }
-        if_buf = xrealloc(if_buf, if_maxsize);
+    nameindex_build(&if_index, if_entries, if_count, sizeof(struct if_entry));
+}
+
+/* List the interfaces of this tick, measuring them if no stream did */
+void
+list_if(void (*object) (char *, void *), void *arg)
+{
+    int i;
+
+    if (if_tick != snapshot_tick()) {
+        if_open();
         gets_if();
-        return;
     }
 
-    if (if_size == -1) {
-        warning("could not read if statistics from /proc/net/dev: %.200s", strerror(errno));
-    }
+    for (i = 0; i < if_count; i++)
+        object(if_entries[i].name, arg);
 }
 
 int
 get_if(char *symon_buf, int maxlen, struct stream *st)
 {
-    char *line;
-    struct if_device_stats stats;
+    struct if_device_stats *stats;
+    int i;
 
-    if (if_size <= 0) {
+    if (if_count == 0) {
         return 0;
     }
 
-    if ((line = strstr(if_buf, st->parg.ifname)) == NULL) {
+    if ((i = nameindex_lookup(&if_index, if_entries, sizeof(struct if_entry), st->parg.ifname)) < 0) {
         warning("could not find interface %s", st->arg);
         return 0;
     }
 
-    line += strlen(st->parg.ifname);
-    bzero(&stats, sizeof(struct if_device_stats));
-
-    /* Inter-|   Receive                                                |  Transmit
-     *  face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed
-     */
-    if (16 > sscanf(line, "%" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %"
-                               SCNu64 " %" SCNu64 " %" SCNu64 " %"
-                               SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %"
-                               SCNu64 " %" SCNu64 " %" SCNu64 "\n",
-                    &stats.rx_bytes, &stats.rx_packets, &stats.rx_errors, &stats.rx_dropped, &stats.rx_fifo_errors,
-                    &stats.rx_frame_errors, &stats.rx_compressed, &stats.multicast,
-                    &stats.tx_bytes, &stats.tx_packets, &stats.tx_errors, &stats.tx_dropped, &stats.tx_fifo_errors,
-                    &stats.collisions, &stats.tx_carrier_errors, &stats.tx_compressed)) {
-        warning("could not parse interface statistics for %.200s", st->arg);
-        return 0;
-    }
-
-    stats.errors_in = (stats.rx_errors + stats.rx_fifo_errors + stats.rx_frame_errors);
-    stats.errors_out = (stats.tx_errors + stats.tx_fifo_errors + stats.tx_carrier_errors);
-    stats.drops = (stats.rx_dropped + stats.tx_dropped);
+    stats = &if_entries[i].stats;
 
     return snpack(symon_buf, maxlen, st->arg, MT_IF2,
-                  (u_int64_t) stats.rx_packets,
-                  (u_int64_t) stats.tx_packets,
-                  (u_int64_t) stats.rx_bytes,
-                  (u_int64_t) stats.tx_bytes,
-                  (u_int64_t) stats.multicast,
+                  (u_int64_t) stats->rx_packets,
+                  (u_int64_t) stats->tx_packets,
+                  (u_int64_t) stats->rx_bytes,
+                  (u_int64_t) stats->tx_bytes,
+                  (u_int64_t) stats->multicast,
                   (u_int64_t) 0,
-                  (u_int64_t) stats.errors_in,
-                  (u_int64_t) stats.errors_out,
-                  (u_int64_t) stats.collisions,
-                  (u_int64_t) stats.drops);
+                  (u_int64_t) (stats->rx_errors + stats->rx_fifo_errors + stats->rx_frame_errors),
+                  (u_int64_t) (stats->tx_errors + stats->tx_fifo_errors + stats->tx_carrier_errors),
+                  (u_int64_t) stats->collisions,
+                  (u_int64_t) (stats->rx_dropped + stats->tx_dropped));
 }
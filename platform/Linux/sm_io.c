@@ -39,22 +39,27 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "conf.h"
 #include "xmalloc.h"
 #include "error.h"
+#include "nameindex.h"
+#include "snapshot.h"
 #include "symon.h"
+#include "sysroot.h"
 #include "diskname.h"
 
 /* Globals for this module start with io_ */
-static void *io_buf = NULL;
-static int io_size = 0;
-static int io_maxsize = 0;
+static struct snapshot *io_stats = NULL;
+
+/* Fields of a diskstats line after the device name, in order */
 struct io_device_stats
 {
     u_int64_t read_issued;
@@ -68,37 +73,138 @@ struct io_device_stats
     u_int64_t progress_ios;
     u_int64_t progress_milliseconds;
     u_int64_t progress_weight;
+    /* 4.18 */
+    u_int64_t discard_issued;
+    u_int64_t discard_merged;
+    u_int64_t discard_sectors;
+    u_int64_t discard_milliseconds;
+    /* 5.5 */
+    u_int64_t flush_issued;
+    u_int64_t flush_milliseconds;
+};
+#define IO_FIELDS (sizeof(struct io_device_stats) / sizeof(u_int64_t))
+
+/*
+ * gets_io tokenizes the whole file once per tick into io_entries, indexed by
+ * device name. Fields a kernel does not report are 0; nfields tells how many
+ * were present.
+ */
+struct io_entry
+{
+    char name[64];
+    int nfields;
+    struct io_device_stats stats;
 };
+static struct io_entry *io_entries = NULL;
+static int io_count = 0;
+static int io_maxcount = 0;
+static struct nameindex io_index;
+static u_int64_t io_tick = 0;           /* tick of last measurement */
+
 #ifdef HAS_PROC_DISKSTATS
-char *io_filename = "/proc/diskstats";
+static char *io_filename = "diskstats";
 #else
 #ifdef HAS_PROC_PARTITIONS
-char *io_filename = "/proc/partitions";
+static char *io_filename = "partitions";
 #endif
 #endif
 
-static int fd;
 
 #if defined(HAS_PROC_DISKSTATS) || defined(HAS_PROC_PARTITIONS)
+__BEGIN_DECLS
+static void io_parse(char *, size_t);
+__END_DECLS
+
+static void
+io_parse(char *buf, size_t size)
+{
+    struct io_entry *entry;
+    struct io_device_stats old;
+    u_int64_t *field;
+    char *line, *p, *end, *name;
+    size_t len;
+    int i;
+
+    /* diskstats:  major minor name fields...
+     * partitions: major minor #blocks name fields... */
+    for (line = buf; line < buf + size; line = end + 1) {
+        if ((end = strchr(line, '\n')) == NULL)
+            end = buf + size;
+
+        p = line;
+#ifdef HAS_PROC_DISKSTATS
+        for (i = 0; i < 2; i++)
+#else
+        for (i = 0; i < 3; i++)
+#endif
+        {
+            strtoull(p, &name, 10);
+            if (name == p)
+                break;
+            p = name;
+        }
+        while (*p == ' ' || *p == '\t')
+            p++;
+        for (name = p; p < end && *p != ' ' && *p != '\t'; p++)
+            ;
+        len = p - name;
+        if (len == 0 || len >= sizeof(entry->name) || !isalpha((unsigned char) *name))
+            continue;
+
+        if (io_count == io_maxcount) {
+            io_maxcount = (io_maxcount == 0) ? 32 : io_maxcount * 2;
+            io_entries = xrealloc(io_entries, io_maxcount * sizeof(struct io_entry));
+        }
+
+        entry = &io_entries[io_count];
+        memcpy(entry->name, name, len);
+        entry->name[len] = '\0';
+        bzero(&entry->stats, sizeof(struct io_device_stats));
+
+        field = (u_int64_t *) &entry->stats;
+        for (i = 0; i < (int) IO_FIELDS; i++) {
+            /* strtoull would skip the newline into the next device */
+            while (p < end && (*p == ' ' || *p == '\t'))
+                p++;
+            if (p == end)
+                break;
+            field[i] = strtoull(p, &line, 10);
+            if (line == p)
+                break;
+            p = line;
+        }
+        entry->nfields = i;
+
+        if (i == 4) {
+            /* partitions on 2.6 kernels: rio rsect wio wsect */
+            old = entry->stats;
+            bzero(&entry->stats, sizeof(struct io_device_stats));
+            entry->stats.read_issued = old.read_issued;
+            entry->stats.read_sectors = old.read_merged;
+            entry->stats.write_issued = old.read_sectors;
+            entry->stats.write_sectors = old.read_milliseconds;
+        } else if (i < 11)
+            continue;
+
+        io_count++;
+    }
+}
+
 void
 init_io(struct stream *st)
 {
+    char path[MAX_PATH_LEN];
     struct disknamectx c;
     size_t lead = sizeof("/dev/") - 1;
 
-    if (io_buf == NULL) {
-        io_maxsize = SYMON_MAX_OBJSIZE;
-        io_buf = xmalloc(io_maxsize);
-    }
-
     if (st->arg == NULL)
         fatal("io: need a <device>|<devicename> argument");
 
-    if ((fd = open(io_filename, O_RDONLY)) < 0)
-        warning("cannot access %.200s: %.200s", io_filename, strerror(errno));
-
-    /* Retrieve io stats to search for devicename */
-    gets_io();
+    /* Retrieve io stats once to search for devicenames */
+    if (io_stats == NULL) {
+        io_stats = open_snapshot(procfs_path(path, sizeof(path), io_filename), NULL);
+        gets_io();
+    }
 
     initdisknamectx(&c, st->arg, st->parg.io, sizeof(st->parg.io));
 
@@ -107,7 +213,7 @@ init_io(struct stream *st)
         if (strncmp(st->parg.io, "/dev/", lead) == 0)
             memmove(&st->parg.io[0], &st->parg.io[0] + lead, sizeof(st->parg.io) - lead);
 
-        if (strstr(io_buf, st->parg.io)) {
+        if (nameindex_lookup(&io_index, io_entries, sizeof(struct io_entry), st->parg.io) >= 0) {
             if (strcmp(st->arg, st->parg.io) == 0)
                 info("started module io(%.200s)", st->parg.io);
             else
@@ -122,90 +228,55 @@ init_io(struct stream *st)
 void
 gets_io(void)
 {
-    int len;
-    char *p;
+    io_count = 0;
+    io_tick = snapshot_tick();
+    if (lock_snapshot(io_stats))
+        io_parse(io_stats->buf, io_stats->len);
+    unlock_snapshot(io_stats);
 
-    if (lseek(fd, 0, SEEK_SET) != 0)
-        fatal("%s seek error: %.200s", io_filename, strerror(errno));
+    nameindex_build(&io_index, io_entries, io_count, sizeof(struct io_entry));
+}
 
-    bzero(io_buf, io_maxsize);
+/* List the disks of this tick, measuring them if no stream did */
+void
+list_io(void (*object) (char *, void *), void *arg)
+{
+    char path[MAX_PATH_LEN];
+    int i;
 
-    len = 0;
-    p = io_buf;
-    io_size = 0;
-    while ((len = read(fd, p, io_maxsize - io_size)) > 0) {
-      p += len;
-      io_size += len;
-    }
+    if (io_stats == NULL)
+        io_stats = open_snapshot(procfs_path(path, sizeof(path), io_filename), NULL);
 
-    if (io_size == io_maxsize) {
-        /* buffer is too small to hold all interface data */
-        io_maxsize += SYMON_MAX_OBJSIZE;
-        if (io_maxsize > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS) {
-            fatal("%s:%d: dynamic object limit (%d) exceeded for io data",
-                  __FILE__, __LINE__, SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS);
-        }
-        io_buf = xrealloc(io_buf, io_maxsize);
+    if (io_tick != snapshot_tick())
         gets_io();
-        return;
-    }
 
-    if (io_size == -1) {
-        warning("could not read io statistics from %.200s: %.200s", io_filename, strerror(errno));
-    }
+    for (i = 0; i < io_count; i++)
+        object(io_entries[i].name, arg);
 }
 
 int
 get_io(char *symon_buf, int maxlen, struct stream *st)
 {
-    char *line;
-    struct io_device_stats stats;
+    struct io_device_stats *stats;
+    int i;
 
-    if (io_size <= 0) {
+    if (io_count == 0) {
         return 0;
     }
 
-    if ((line = strstr(io_buf, st->parg.io)) == NULL) {
+    if ((i = nameindex_lookup(&io_index, io_entries, sizeof(struct io_entry), st->parg.io)) < 0) {
         warning("could not find disk %.200s = %.200s", st->arg, st->parg.io);
         return 0;
     }
 
-    line += strlen(st->parg.io);
-    bzero(&stats, sizeof(struct io_device_stats));
-
-    if (11 > sscanf(line, " %" SCNu64 " %" SCNu64
-                          " %" SCNu64 " %" SCNu64
-                          " %" SCNu64 " %" SCNu64
-                          " %" SCNu64 " %" SCNu64
-                          " %" SCNu64 " %" SCNu64
-                          " %" SCNu64 "\n",
-                    &stats.read_issued, &stats.read_merged,
-                    &stats.read_sectors, &stats.read_milliseconds,
-                    &stats.write_issued, &stats.write_merged,
-                    &stats.write_sectors, &stats.write_milliseconds,
-                    &stats.progress_ios, &stats.progress_milliseconds,
-                    &stats.progress_weight)) {
-#ifdef HAS_PROC_DISKSTATS
-        if (4 > sscanf(line, " %" SCNu64 " %" SCNu64
-                             " %" SCNu64 " %" SCNu64 "\n",
-                       &stats.read_issued, &stats.read_sectors,
-                       &stats.write_issued, &stats.write_sectors)) {
-            warning("could not parse disk statistics for %.200s", st->arg);
-            return 0;
-        }
-    }
-#else
-        warning("could not parse disk statistics for %.200s", st->arg);
-        return 0;
-    }
-#endif
+    stats = &io_entries[i].stats;
 
     return snpack(symon_buf, maxlen, st->arg, MT_IO2,
-                  stats.read_issued,
-                  stats.write_issued,
+                  stats->read_issued,
+                  stats->write_issued,
                   (u_int64_t) 0,
-                  (u_int64_t)(stats.read_sectors * DEV_BSIZE),
-                  (u_int64_t)(stats.write_sectors * DEV_BSIZE));
+                  (u_int64_t)(stats->read_sectors * DEV_BSIZE),
+                  (u_int64_t)(stats->write_sectors * DEV_BSIZE));
 }
 #else
 void
@@ -218,6 +289,11 @@ gets_io(void)
 {
     fatal("io module not available");
 }
+void
+list_io(void (*object) (char *, void *), void *arg)
+{
+    /* EMPTY */
+}
 int
 get_io(char *symon_buf, int maxlen, struct stream *st)
 {
@@ -37,35 +37,173 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "error.h"
 #include "conf.h"
+#include "snapshot.h"
 #include "symon.h"
+#include "sysroot.h"
 #include "xmalloc.h"
 
 #define ktob(size) ((size) << 10)
 
+/*
+ * /proc/meminfo is parsed in a single pass into a struct meminfo, once per
+ * tick. Keys are looked up in a table indexed by a hash that is perfect for
+ * the keys below; a key that is not in the table hashes to a slot that holds
+ * another key, or none, and is skipped after a single compare.
+ */
+struct meminfo {
+    u_int64_t memtotal;         /* kB */
+    u_int64_t memfree;
+    u_int64_t memavailable;
+    u_int64_t buffers;
+    u_int64_t cached;
+    u_int64_t swapcached;
+    u_int64_t active;
+    u_int64_t inactive;
+    u_int64_t swaptotal;
+    u_int64_t swapfree;
+    u_int64_t dirty;
+    u_int64_t writeback;
+    u_int64_t anonpages;
+    u_int64_t mapped;
+    u_int64_t shmem;
+    u_int64_t slab;
+    u_int64_t sreclaimable;
+    u_int64_t sunreclaim;
+    u_int64_t kernelstack;
+    u_int64_t pagetables;
+    u_int64_t commitlimit;
+    u_int64_t committed_as;
+    u_int64_t hugepages_total;  /* pages */
+    u_int64_t hugepages_free;
+    u_int64_t hugepages_rsvd;
+    u_int64_t hugepages_surp;
+    u_int64_t hugepagesize;     /* kB */
+    int available;              /* MemAvailable was present; since 3.14 */
+};
+
+struct me_key {
+    char *name;
+    size_t len;
+    size_t offset;
+};
+
+#define ME_KEY(name, field) { name, sizeof(name) - 1, offsetof(struct meminfo, field) }
+static struct me_key me_keys[] = {
+    ME_KEY("MemTotal", memtotal),
+    ME_KEY("MemFree", memfree),
+    ME_KEY("MemAvailable", memavailable),
+    ME_KEY("Buffers", buffers),
+    ME_KEY("Cached", cached),
+    ME_KEY("SwapCached", swapcached),
+    ME_KEY("Active", active),
+    ME_KEY("Inactive", inactive),
+    ME_KEY("SwapTotal", swaptotal),
+    ME_KEY("SwapFree", swapfree),
+    ME_KEY("Dirty", dirty),
+    ME_KEY("Writeback", writeback),
+    ME_KEY("AnonPages", anonpages),
+    ME_KEY("Mapped", mapped),
+    ME_KEY("Shmem", shmem),
+    ME_KEY("Slab", slab),
+    ME_KEY("SReclaimable", sreclaimable),
+    ME_KEY("SUnreclaim", sunreclaim),
+    ME_KEY("KernelStack", kernelstack),
+    ME_KEY("PageTables", pagetables),
+    ME_KEY("CommitLimit", commitlimit),
+    ME_KEY("Committed_AS", committed_as),
+    ME_KEY("HugePages_Total", hugepages_total),
+    ME_KEY("HugePages_Free", hugepages_free),
+    ME_KEY("HugePages_Rsvd", hugepages_rsvd),
+    ME_KEY("HugePages_Surp", hugepages_surp),
+    ME_KEY("Hugepagesize", hugepagesize),
+    { NULL, 0, 0 }
+};
+
+/* me_hash is perfect for me_keys; a new key may need other multipliers */
+#define ME_HASHSIZE 64
+#define me_hash(k, l) \
+    (((l) * 8 + (k)[0] + (k)[(l) - 1] * 24 + (k)[(l) / 2]) & (ME_HASHSIZE - 1))
+
 /* Globals for this module all start with me_ */
-static void *me_buf = NULL;
-static u_int64_t me_size = 0;
-static u_int64_t me_maxsize = 0;
+static struct snapshot *me_info = NULL;
+static struct me_key *me_table[ME_HASHSIZE];
 static u_int64_t me_stats[5];
 
-static int fd;
+__BEGIN_DECLS
+static void me_parse(struct snapshot *);
+__END_DECLS
+
+/* Parse meminfo lines "Key:   value kB" into the struct meminfo of s */
+static void
+me_parse(struct snapshot *s)
+{
+    struct meminfo *mi = s->data;
+    struct me_key *k;
+    u_int64_t value;
+    char *p, *key, *end;
+    size_t len;
+
+    if (mi == NULL)
+        mi = s->data = xmalloc(sizeof(struct meminfo));
+    bzero(mi, sizeof(struct meminfo));
+
+    end = s->buf + s->len;
+    for (p = s->buf; p < end; p++) {
+        key = p;
+        while (p < end && *p != ':' && *p != '\n')
+            p++;
+        if (p == end)
+            break;
+        if (*p == '\n')
+            continue;
+
+        len = p - key;
+        k = (len > 0) ? me_table[me_hash(key, len)] : NULL;
+
+        value = 0;
+        for (p++; p < end && *p == ' '; p++)
+            ;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            value = value * 10 + (*p - '0');
+        while (p < end && *p != '\n')
+            p++;
+
+        if (k != NULL && k->len == len && memcmp(k->name, key, len) == 0) {
+            *(u_int64_t *) ((char *) mi + k->offset) = value;
+            if (k->offset == offsetof(struct meminfo, memavailable))
+                mi->available = 1;
+        }
+    }
+
+    /* estimate of older kernels */
+    if (!mi->available)
+        mi->memavailable = mi->memfree + mi->buffers + mi->cached;
+}
 
 void
 init_mem(struct stream *st)
 {
-    if (me_buf == NULL) {
-        me_maxsize = SYMON_MAX_OBJSIZE;
-        me_buf = xmalloc(me_maxsize);
-    }
+    char path[MAX_PATH_LEN];
+    int i, h;
+
+    if (me_info == NULL) {
+        for (i = 0; me_keys[i].name != NULL; i++) {
+            h = me_hash(me_keys[i].name, me_keys[i].len);
+            if (me_table[h] != NULL)
+                fatal("%s:%d: internal error: meminfo keys %s and %s collide",
+                      __FILE__, __LINE__, me_table[h]->name, me_keys[i].name);
+            me_table[h] = &me_keys[i];
+        }
 
-    if ((fd = open("/proc/meminfo", O_RDONLY)) < 0)
-        warning("cannot access /proc/meminfo: %.200s", strerror(errno));
+        me_info = open_snapshot(procfs_path(path, sizeof(path), "meminfo"), me_parse);
+    }
 
     info("started module mem(%.200s)", st->arg);
 }
@@ -73,71 +211,27 @@ init_mem(struct stream *st)
 void
 gets_mem(void)
 {
-   ssize_t r;
-
-   if (lseek(fd, 0, SEEK_SET) != 0)
-        fatal("/proc/meminfo seek error: %.200s", strerror(errno));
-
-   bzero(me_buf, me_maxsize);
-   r = read(fd, me_buf, me_maxsize);
-   if (r < 0) {
-       if (r != -1)
-           fatal("read returned %d", r);
-
-       warning("could not read if statistics from /proc/meminfo: %.200s", strerror(errno));
-       return;
-   }
-
-   me_size = r;
-
-   if (me_size == me_maxsize) {
-        /* buffer is too small to hold all memory data */
-        me_maxsize += SYMON_MAX_OBJSIZE;
-        if (me_maxsize > SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS) {
-            fatal("%s:%d: dynamic object limit (%d) exceeded for cp data",
-                __FILE__, __LINE__, SYMON_MAX_OBJSIZE * SYMON_MAX_DOBJECTS);
-        }
-        me_buf = xrealloc(me_buf, me_maxsize);
-        gets_mem();
-        return;
-    }
+    lock_snapshot(me_info);
+    unlock_snapshot(me_info);
 }
 
-u_int64_t
-mem_getitem(char *name)
+int
+get_mem(char *symon_buf, int maxlen, struct stream *st)
 {
-    u_int64_t stat;
-    char *line;
-
-    if (me_size <= 0) {
-        return 0;
-    }
+    struct meminfo *mi;
 
-    if ((line = strstr(me_buf, name)) == NULL) {
-        warning("could not find %s in /proc/meminfo", name);
+    if (!lock_snapshot(me_info)) {
+        unlock_snapshot(me_info);
         return 0;
     }
 
-    line += strlen(name);
-    if (1 < sscanf(line, ": %" SCNu64 " Kb", &stat)) {
-        warning("could not parse memory statistics");
-        return 0;
-    } else {
-        return stat;
-    }
-}
-
-int
-get_mem(char *symon_buf, int maxlen, struct stream *st)
-{
-    me_stats[0] = ktob(mem_getitem("Active"));
-    me_stats[1] = ktob(mem_getitem("MemTotal"));
-    me_stats[2] = ktob(mem_getitem("MemAvailable"));
-    me_stats[1] -= me_stats[2];
-    me_stats[3] = ktob(mem_getitem("SwapFree"));
-    me_stats[4] = ktob(mem_getitem("SwapTotal"));
-
-    me_stats[3] = me_stats[4] - me_stats[3];
+    mi = me_info->data;
+    me_stats[0] = ktob(mi->active);
+    me_stats[1] = ktob(mi->memtotal - mi->memavailable);
+    me_stats[2] = ktob(mi->memavailable);
+    me_stats[3] = ktob(mi->swaptotal - mi->swapfree);
+    me_stats[4] = ktob(mi->swaptotal);
+    unlock_snapshot(me_info);
 
     return snpack(symon_buf, maxlen, st->arg, MT_MEM2,
                   me_stats[0], me_stats[1], me_stats[2],
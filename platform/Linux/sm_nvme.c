@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Get the SMART / Health Information log of nvme controllers
+ *
+ * critical_warning : temperature : available_spare : percentage_used :
+ * data_read : data_written : power_cycles : power_on_hours :
+ * unsafe_shutdowns : media_errors : error_log_entries
+ *
+ * The log is fetched with an admin passthrough command on the controller
+ * device. A controller can take a while to answer, so the controllers are
+ * read by a background thread, each on the schedule of its streams, and
+ * get_nvme reports the last log read. Streams for a namespace, e.g. nvme0n1,
+ * report the log of its controller.
+ */
+#include "conf.h"
+
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "data.h"
+#include "diskname.h"
+#include "error.h"
+#include "symon.h"
+#include "sysroot.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+#ifdef HAS_NVME_IOCTL
+#include <linux/nvme_ioctl.h>
+
+#define NVME_ADMIN_GET_LOG_PAGE 0x02
+#define NVME_LOG_SMART          0x02
+#define NVME_NSID_ALL           0xffffffff
+#define NVME_LOG_LEN            512
+#define NVME_TIMEOUT            1000    /* ms */
+
+/* Globals for this module start with nvme_ */
+struct nvme_device {
+    u_int8_t log[NVME_LOG_LEN]; /* last log read */
+    char name[MAX_PATH_LEN];
+    int fd;
+    int interval;               /* ms between reads */
+    u_int64_t next;             /* ms; next read is due */
+    int failed;                 /* consecutive failed reads */
+    int valid;                  /* log holds the last read */
+};
+
+static struct nvme_device *nvme_devs = NULL;
+static int nvme_cur = 0;
+static int nvme_started = 0;
+static pthread_mutex_t nvme_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Health log fields are little endian; 128 bit counters are reported by their
+ * lower 64 bits */
+static u_int64_t
+nvme_le(u_int8_t *p, int len)
+{
+    u_int64_t v = 0;
+
+    while (len-- > 0)
+        v = (v << 8) | p[len];
+
+    return v;
+}
+
+/* Read the log of controller <i>; the ioctl is done without holding the
+ * mutex */
+static void
+nvme_read(int i)
+{
+    struct nvme_admin_cmd cmd;
+    u_int8_t log[NVME_LOG_LEN];
+    char name[MAX_PATH_LEN];
+    int fd, r, saved;
+
+    pthread_mutex_lock(&nvme_mutex);
+    fd = nvme_devs[i].fd;
+    strlcpy(name, nvme_devs[i].name, sizeof(name));
+    pthread_mutex_unlock(&nvme_mutex);
+
+    bzero(&cmd, sizeof(cmd));
+    cmd.opcode = NVME_ADMIN_GET_LOG_PAGE;
+    cmd.nsid = NVME_NSID_ALL;
+    cmd.addr = (u_int64_t) (uintptr_t) log;
+    cmd.data_len = NVME_LOG_LEN;
+    cmd.cdw10 = ((NVME_LOG_LEN / 4 - 1) << 16) | NVME_LOG_SMART;
+    cmd.timeout_ms = NVME_TIMEOUT;
+
+    /* the ioctl returns the nvme status of a command that the controller
+     * refused */
+    r = ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd);
+    saved = errno;
+
+    pthread_mutex_lock(&nvme_mutex);
+    if (r != 0) {
+        /* warn once; the controller may be resetting */
+        if (nvme_devs[i].failed++ == 0) {
+            if (r < 0)
+                warning("nvme: health log of '%.200s' cannot be read: %.200s",
+                        name, strerror(saved));
+            else
+                warning("nvme: health log of '%.200s' cannot be read: status 0x%x",
+                        name, r);
+        }
+        nvme_devs[i].valid = 0;
+    } else {
+        if (nvme_devs[i].failed)
+            info("nvme: health log of '%.200s' can be read again", name);
+        nvme_devs[i].failed = 0;
+        memcpy(nvme_devs[i].log, log, NVME_LOG_LEN);
+        nvme_devs[i].valid = 1;
+    }
+    pthread_mutex_unlock(&nvme_mutex);
+}
+
+/* Background thread that reads the controllers that are due */
+static void *
+nvme_poller(void *arg)
+{
+    struct timespec ts;
+    u_int64_t now, wait;
+    int i, n;
+
+    for (;;) {
+        now = clock_usec(CLOCK_MONOTONIC) / 1000;
+        wait = SYMON_NVMEINTERVAL;
+
+        pthread_mutex_lock(&nvme_mutex);
+        n = nvme_cur;
+        pthread_mutex_unlock(&nvme_mutex);
+
+        for (i = 0; i < n; i++) {
+            pthread_mutex_lock(&nvme_mutex);
+            if (nvme_devs[i].next <= now) {
+                nvme_devs[i].next = now + nvme_devs[i].interval;
+                pthread_mutex_unlock(&nvme_mutex);
+                nvme_read(i);
+                continue;
+            }
+            if (nvme_devs[i].next - now < wait)
+                wait = nvme_devs[i].next - now;
+            pthread_mutex_unlock(&nvme_mutex);
+        }
+
+        /* controllers added on reconfiguration are picked up within a
+         * second */
+        ts.tv_sec = wait / 1000;
+        ts.tv_nsec = (wait % 1000) * 1000000;
+        nanosleep(&ts, NULL);
+    }
+
+    /* NOT REACHED */
+    return NULL;
+}
+
+void
+init_nvme(struct stream *st)
+{
+    struct disknamectx c;
+    char drivename[MAX_PATH_LEN];
+    char *base;
+    u_int32_t ctrl, ns;
+    int interval;
+    int fd;
+    int i;
+
+    if (st->arg == NULL)
+        fatal("nvme: need a <controller|namespace device|name> argument");
+
+    initdisknamectx(&c, st->arg, drivename, sizeof(drivename));
+
+    fd = -1;
+    while (nextdiskname(&c))
+        if ((fd = open(drivename, O_RDONLY)) != -1)
+            break;
+
+    /* streams found by discovery are started after the privilege drop; the
+     * stream is skipped rather than taking symon down */
+    if (fd < 0) {
+        warning("nvme(%.200s): cannot open: %.200s", st->arg, strerror(errno));
+        st->parg.nvme = -1;
+        return;
+    }
+
+    /* the health log belongs to the controller; prefer its character device
+     * over a namespace, so that namespaces of one controller share a read */
+    base = (base = strrchr(drivename, '/')) ? base + 1 : drivename;
+    if (sscanf(base, "nvme%" SCNu32 "n%" SCNu32, &ctrl, &ns) == 2) {
+        snprintf(base, sizeof(drivename) - (base - drivename), "nvme%" PRIu32, ctrl);
+        if ((i = open(drivename, O_RDONLY)) != -1) {
+            close(fd);
+            fd = i;
+        } else {
+            snprintf(base, sizeof(drivename) - (base - drivename),
+                     "nvme%" PRIu32 "n%" PRIu32, ctrl, ns);
+        }
+    }
+
+    interval = st->interval;
+    if (interval < SYMON_NVMEINTERVAL)
+        interval = SYMON_NVMEINTERVAL;
+
+    pthread_mutex_lock(&nvme_mutex);
+
+    /* look for the controller in our global table; it is read as often as
+     * its most frequent stream needs */
+    for (i = 0; i < nvme_cur; i++) {
+        if (strncmp(nvme_devs[i].name, drivename, sizeof(drivename)) == 0) {
+            if (interval < nvme_devs[i].interval)
+                nvme_devs[i].interval = interval;
+            pthread_mutex_unlock(&nvme_mutex);
+            close(fd);
+            st->parg.nvme = i;
+            info("started module nvme(%.200s = %.200s)", st->arg, drivename);
+            return;
+        }
+    }
+
+    if (nvme_cur > SYMON_MAX_DOBJECTS) {
+        fatal("%s:%d: dynamic object limit (%d) exceeded for nvme data",
+              __FILE__, __LINE__, SYMON_MAX_DOBJECTS);
+    }
+
+    nvme_devs = xrealloc(nvme_devs, (nvme_cur + 1) * sizeof(struct nvme_device));
+    bzero(&nvme_devs[nvme_cur], sizeof(struct nvme_device));
+    strlcpy(nvme_devs[nvme_cur].name, drivename, sizeof(nvme_devs[0].name));
+    nvme_devs[nvme_cur].fd = fd;
+    nvme_devs[nvme_cur].interval = interval;
+
+    st->parg.nvme = nvme_cur;
+    nvme_cur++;
+
+    pthread_mutex_unlock(&nvme_mutex);
+
+    info("started module nvme(%.200s = %.200s)", st->arg, drivename);
+}
+
+/* Start the poller; controllers are never read from the measurement loop */
+void
+gets_nvme(void)
+{
+    pthread_t thread;
+    sigset_t all, old;
+
+    if (nvme_started)
+        return;
+    nvme_started = 1;
+
+    /* signals are handled by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    if ((errno = pthread_create(&thread, NULL, nvme_poller, NULL)) != 0)
+        fatal("nvme: cannot start poller: %.200s", strerror(errno));
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_detach(thread);
+}
+
+int
+get_nvme(char *symon_buf, int maxlen, struct stream *st)
+{
+    u_int8_t l[NVME_LOG_LEN];
+
+    pthread_mutex_lock(&nvme_mutex);
+    if ((st->parg.nvme < 0) || (st->parg.nvme >= nvme_cur) ||
+        !nvme_devs[st->parg.nvme].valid) {
+        pthread_mutex_unlock(&nvme_mutex);
+        return 0;
+    }
+    memcpy(l, nvme_devs[st->parg.nvme].log, NVME_LOG_LEN);
+    pthread_mutex_unlock(&nvme_mutex);
+
+    /* data units are thousands of 512 byte blocks */
+    return snpack(symon_buf, maxlen, st->arg, MT_NVME,
+                  l[0],
+                  (double) nvme_le(&l[1], 2) - 273.15,
+                  l[3],
+                  l[5],
+                  nvme_le(&l[32], 8) * 512000,
+                  nvme_le(&l[48], 8) * 512000,
+                  nvme_le(&l[112], 8),
+                  nvme_le(&l[128], 8),
+                  nvme_le(&l[144], 8),
+                  nvme_le(&l[160], 8),
+                  nvme_le(&l[176], 8));
+}
+
+/* List the nvme controllers known to the kernel */
+void
+list_nvme(void (*object) (char *, void *), void *arg)
+{
+    char path[MAX_PATH_LEN];
+    struct dirent *e;
+    u_int32_t n;
+    DIR *dir;
+
+    if ((dir = opendir(sysfs_path(path, sizeof(path), "class/nvme"))) == NULL)
+        return;
+
+    while ((e = readdir(dir)) != NULL)
+        if (sscanf(e->d_name, "nvme%" SCNu32, &n) == 1)
+            object(e->d_name, arg);
+
+    closedir(dir);
+}
+#else
+void
+init_nvme(struct stream *st)
+{
+    fatal("nvme module not available");
+}
+void
+gets_nvme(void)
+{
+    fatal("nvme module not available");
+}
+void
+list_nvme(void (*object) (char *, void *), void *arg)
+{
+    /* EMPTY */
+}
+int
+get_nvme(char *symon_buf, int maxlen, struct stream *st)
+{
+    fatal("nvme module not available");
+
+    /* NOT REACHED */
+    return 0;
+}
+#endif
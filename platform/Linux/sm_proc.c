@@ -0,0 +1,571 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Get process statistics from /proc and return them in symon_buf as
+ *
+ * number of processes : ticks_user : ticks_system : ticks_interrupt :
+ * cpuseconds : procsizes : resident segment sizes
+ *
+ * Processes are grouped by command name; a stream counts the processes whose
+ * name starts with its argument. /proc is scanned once per measurement with
+ * getdents64 on a directory fd that is kept open. A pid cache remembers which
+ * processes belong to a group: the stat files of those are kept open and
+ * reread with pread, other processes cost no more than their directory entry.
+ * Names of processes outside of all groups are checked again with an
+ * increasing delay, so that a fork that later execs a monitored command is
+ * found.
+ *
+ * Streams with the pss option report the proportional set size from
+ * smaps_rollup, which counts shared pages once, instead of the rss.
+ */
+
+#include "conf.h"
+
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "symon.h"
+#include "sysroot.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+#define PROC_HASHSIZE   16384   /* pid cache buckets; power of two */
+#define PROC_COMMLEN    16      /* TASK_COMM_LEN */
+#define PROC_MAXFDS     512     /* stat files kept open */
+#define PROC_MAXBACKOFF 64      /* ticks between name checks */
+#define PROC_DIRBUF     32768
+
+/* Globals for this module start with proc_ */
+struct proc_dirent {
+    u_int64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct proc_entry {
+    pid_t pid;
+    int next;                   /* hash chain */
+    int fd;                     /* stat fd, -1 if not kept open */
+    int matched;                /* comm matches a group */
+    u_int64_t seen;             /* tick this pid was last listed */
+    u_int64_t check;            /* tick to check comm again if unmatched */
+    int backoff;
+    char comm[PROC_COMMLEN];
+    u_int64_t utime;
+    u_int64_t stime;
+    u_int64_t oldticks;         /* utime + stime at the previous tick */
+    u_int64_t vsize;
+    u_int64_t rss;              /* bytes */
+};
+
+struct proc_group {
+    char *name;
+    size_t len;
+    int pss;
+    u_int32_t n;
+    u_int64_t utime;
+    u_int64_t stime;
+    u_int64_t vsize;
+    u_int64_t rss;
+    double pct;
+};
+
+static int proc_dirfd = -1;
+static char *proc_dirbuf = NULL;
+static struct proc_entry *proc_entries = NULL;
+static int proc_nentries = 0;
+static int proc_maxentries = 0;
+static int proc_free = -1;
+static int proc_hash[PROC_HASHSIZE];
+static int proc_nfds = 0;
+static struct proc_group *proc_groups = NULL;
+static int proc_ngroups = 0;
+static int proc_generation = 0;  /* configuration the groups belong to */
+static u_int64_t proc_tick = 0;
+static u_int64_t proc_last = 0;  /* ms; time of the previous scan */
+static long proc_hz = 100;
+static long proc_pagesize = 4096;
+static int proc_psswarned = 0;
+
+static void
+proc_close(struct proc_entry *e)
+{
+    if (e->fd != -1) {
+        close(e->fd);
+        e->fd = -1;
+        proc_nfds--;
+    }
+}
+
+/* Parse the unsigned number at s, or 0 */
+static u_int64_t
+proc_number(char *s, char **end)
+{
+    u_int64_t v = 0;
+
+    while (*s == ' ')
+        s++;
+    if (*s == '-')
+        s++;
+    while (*s >= '0' && *s <= '9')
+        v = v * 10 + (*s++ - '0');
+    if (end)
+        *end = s;
+
+    return v;
+}
+
+static int
+proc_matches(char *comm)
+{
+    int i;
+
+    for (i = 0; i < proc_ngroups; i++)
+        if (strncmp(proc_groups[i].name, comm, proc_groups[i].len) == 0)
+            return 1;
+
+    return 0;
+}
+
+/*
+ * Read /proc/<pid>/stat into e; returns 0 if the process is gone. The command
+ * name is between the first '(' and the last ')', as it may contain either.
+ *
+ * pid (comm) state ppid pgrp session tty tpgid flags minflt cminflt majflt
+ * cmajflt utime stime cutime cstime priority nice threads itreal starttime
+ * vsize rss ...
+ */
+static int
+proc_read_stat(struct proc_entry *e)
+{
+    char buf[1024];
+    char path[32];
+    char *p, *q;
+    ssize_t n;
+    int fd, i;
+
+    /* a kept fd fails once its process exits; the pid may have been reused by
+     * a new process since */
+    n = 0;
+    if (e->fd != -1 && (n = pread(e->fd, buf, sizeof(buf) - 1, 0)) <= 0) {
+        proc_close(e);
+        e->oldticks = 0;
+    }
+
+    if (e->fd == -1) {
+        snprintf(path, sizeof(path), "%d/stat", (int) e->pid);
+        if ((fd = openat(proc_dirfd, path, O_RDONLY | O_CLOEXEC)) == -1)
+            return 0;
+
+        n = pread(fd, buf, sizeof(buf) - 1, 0);
+
+        /* only the stat files of grouped processes are worth keeping open */
+        if (n > 0 && e->matched && proc_nfds < PROC_MAXFDS) {
+            e->fd = fd;
+            proc_nfds++;
+        } else {
+            close(fd);
+        }
+    }
+
+    if (n <= 0)
+        return 0;
+    buf[n] = '\0';
+
+    if ((p = strchr(buf, '(')) == NULL || (q = strrchr(buf, ')')) == NULL || q < p)
+        return 0;
+
+    n = q - p - 1;
+    if (n >= PROC_COMMLEN)
+        n = PROC_COMMLEN - 1;
+    memcpy(e->comm, p + 1, n);
+    e->comm[n] = '\0';
+
+    /* q + 2 is the state, field 3; skip to utime, field 14 */
+    for (p = q + 2, i = 3; i < 14 && p; i++)
+        if ((p = strchr(p, ' ')) != NULL)
+            p++;
+    if (p == NULL)
+        return 0;
+
+    e->utime = proc_number(p, &p);
+    e->stime = proc_number(p, &p);
+    for (i = 16; i < 23 && *p; i++)
+        proc_number(p, &p);
+    e->vsize = proc_number(p, &p);
+    e->rss = proc_number(p, &p) * proc_pagesize;
+
+    return 1;
+}
+
+/* Return the Pss of a process in bytes; falls back to its rss if smaps_rollup
+ * cannot be read */
+static u_int64_t
+proc_read_pss(struct proc_entry *e)
+{
+    char buf[4096];
+    char path[32];
+    char *p;
+    ssize_t n;
+    int fd;
+
+    snprintf(path, sizeof(path), "%d/smaps_rollup", (int) e->pid);
+    if ((fd = openat(proc_dirfd, path, O_RDONLY | O_CLOEXEC)) == -1) {
+        /* other users' processes need ptrace read access */
+        if ((errno == EACCES || errno == EPERM) && !proc_psswarned) {
+            warning("proc: cannot read %.200s: %.200s; reporting rss instead of pss",
+                    path, strerror(errno));
+            proc_psswarned = 1;
+        }
+        return e->rss;
+    }
+
+    n = pread(fd, buf, sizeof(buf) - 1, 0);
+    close(fd);
+    if (n <= 0)
+        return e->rss;
+    buf[n] = '\0';
+
+    if ((p = strstr(buf, "\nPss:")) == NULL)
+        return e->rss;
+
+    return proc_number(p + 5, NULL) * 1024;
+}
+
+static void
+proc_release(int i)
+{
+    struct proc_entry *e = &proc_entries[i];
+
+    proc_close(e);
+    e->pid = 0;
+    e->next = proc_free;
+    proc_free = i;
+}
+
+static int
+proc_alloc(pid_t pid)
+{
+    struct proc_entry *e;
+    int i, h;
+
+    if (proc_free != -1) {
+        i = proc_free;
+        proc_free = proc_entries[i].next;
+    } else {
+        if (proc_nentries == proc_maxentries) {
+            proc_maxentries = proc_maxentries ? proc_maxentries * 2 : 1024;
+            proc_entries = xrealloc(proc_entries, proc_maxentries * sizeof(struct proc_entry));
+        }
+        i = proc_nentries++;
+    }
+
+    e = &proc_entries[i];
+    bzero(e, sizeof(struct proc_entry));
+    e->pid = pid;
+    e->fd = -1;
+
+    h = pid & (PROC_HASHSIZE - 1);
+    e->next = proc_hash[h];
+    proc_hash[h] = i;
+
+    return i;
+}
+
+static int
+proc_lookup(pid_t pid)
+{
+    int i;
+
+    for (i = proc_hash[pid & (PROC_HASHSIZE - 1)]; i != -1; i = proc_entries[i].next)
+        if (proc_entries[i].pid == pid)
+            return i;
+
+    return -1;
+}
+
+/* Forget processes that were not listed in this scan */
+static void
+proc_sweep(void)
+{
+    int h, i, *prev;
+
+    for (h = 0; h < PROC_HASHSIZE; h++) {
+        prev = &proc_hash[h];
+        while ((i = *prev) != -1) {
+            if (proc_entries[i].seen != proc_tick) {
+                *prev = proc_entries[i].next;
+                proc_release(i);
+            } else {
+                prev = &proc_entries[i].next;
+            }
+        }
+    }
+}
+
+/* Add the measurement of a grouped process to all groups it belongs to */
+static void
+proc_account(struct proc_entry *e, double elapsed)
+{
+    struct proc_group *g;
+    u_int64_t ticks, pss;
+    int i;
+
+    ticks = e->utime + e->stime;
+    pss = 0;
+
+    for (i = 0; i < proc_ngroups; i++) {
+        g = &proc_groups[i];
+        if (strncmp(g->name, e->comm, g->len) != 0)
+            continue;
+
+        g->n++;
+        g->utime += e->utime;
+        g->stime += e->stime;
+        g->vsize += e->vsize;
+        if (g->pss) {
+            if (pss == 0)
+                pss = proc_read_pss(e);
+            g->rss += pss;
+        } else {
+            g->rss += e->rss;
+        }
+        if (e->oldticks && elapsed > 0 && ticks >= e->oldticks)
+            g->pct += (ticks - e->oldticks) * 100.0 / (proc_hz * elapsed);
+    }
+
+    e->oldticks = ticks;
+}
+
+/* Forget the groups of a previous configuration */
+static void
+proc_reset(void)
+{
+    int i;
+
+    for (i = 0; i < proc_ngroups; i++)
+        xfree(proc_groups[i].name);
+    if (proc_groups != NULL)
+        xfree(proc_groups);
+    proc_groups = NULL;
+    proc_ngroups = 0;
+}
+
+void
+privinit_proc(void)
+{
+    char path[MAX_PATH_LEN];
+    int i;
+
+    if (proc_dirfd != -1)
+        return;
+
+    /* the directory fd is opened before chroot and kept */
+    if ((proc_dirfd = open(procfs_path(path, sizeof(path), ""),
+                           O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1)
+        fatal("proc: cannot open %.200s: %.200s", path, strerror(errno));
+
+    for (i = 0; i < PROC_HASHSIZE; i++)
+        proc_hash[i] = -1;
+
+    proc_dirbuf = xmalloc(PROC_DIRBUF);
+
+    if ((proc_hz = sysconf(_SC_CLK_TCK)) <= 0)
+        proc_hz = 100;
+    if ((proc_pagesize = sysconf(_SC_PAGESIZE)) <= 0)
+        proc_pagesize = 4096;
+}
+
+void
+init_proc(struct stream *st)
+{
+    int i;
+
+    privinit_proc();
+
+    /* a new configuration brings its own groups */
+    if (proc_generation != symon_generation) {
+        proc_reset();
+        proc_generation = symon_generation;
+    }
+
+    /* processes that did not match the old groups may match the new one */
+    for (i = 0; i < proc_nentries; i++)
+        proc_entries[i].check = 0;
+
+    for (i = 0; i < proc_ngroups; i++) {
+        if (strcmp(proc_groups[i].name, st->arg) == 0) {
+            proc_groups[i].pss = st->pss;
+            st->parg.proc = i;
+            info("started module proc(%.200s)", st->arg);
+            return;
+        }
+    }
+
+    if (proc_ngroups > SYMON_MAX_DOBJECTS)
+        fatal("%s:%d: dynamic object limit (%d) exceeded for proc groups",
+              __FILE__, __LINE__, SYMON_MAX_DOBJECTS);
+
+    proc_groups = xrealloc(proc_groups, (proc_ngroups + 1) * sizeof(struct proc_group));
+    bzero(&proc_groups[proc_ngroups], sizeof(struct proc_group));
+    proc_groups[proc_ngroups].name = xstrdup(st->arg);
+    proc_groups[proc_ngroups].len = strlen(st->arg);
+    proc_groups[proc_ngroups].pss = st->pss;
+    st->parg.proc = proc_ngroups++;
+
+    info("started module proc(%.200s)", st->arg);
+}
+
+void
+gets_proc(void)
+{
+    struct proc_dirent *d;
+    struct proc_entry *e;
+    u_int64_t now;
+    double elapsed;
+    char *p;
+    pid_t pid;
+    long n, off;
+    int i;
+
+    proc_tick++;
+    now = clock_usec(CLOCK_MONOTONIC) / 1000;
+    elapsed = proc_last ? (now - proc_last) / 1000.0 : 0;
+    proc_last = now;
+
+    for (i = 0; i < proc_ngroups; i++) {
+        proc_groups[i].n = 0;
+        proc_groups[i].utime = proc_groups[i].stime = 0;
+        proc_groups[i].vsize = proc_groups[i].rss = 0;
+        proc_groups[i].pct = 0;
+    }
+
+    if (lseek(proc_dirfd, 0, SEEK_SET) == -1) {
+        warning("proc: cannot rewind /proc: %.200s", strerror(errno));
+        return;
+    }
+
+    while ((n = syscall(SYS_getdents64, proc_dirfd, proc_dirbuf, PROC_DIRBUF)) > 0) {
+        for (off = 0; off < n; off += d->d_reclen) {
+            d = (struct proc_dirent *) (proc_dirbuf + off);
+
+            /* only the numeric entries are processes */
+            for (pid = 0, p = d->d_name; *p >= '0' && *p <= '9'; p++)
+                pid = pid * 10 + (*p - '0');
+            if (*p != '\0' || pid == 0)
+                continue;
+
+            if ((i = proc_lookup(pid)) == -1)
+                i = proc_alloc(pid);
+            e = &proc_entries[i];
+            e->seen = proc_tick;
+
+            if (!e->matched) {
+                if (e->check > proc_tick)
+                    continue;
+
+                /* the process may have exec'd since it was last checked */
+                if (!proc_read_stat(e))
+                    continue;
+                if (!(e->matched = proc_matches(e->comm))) {
+                    e->backoff = e->backoff ? e->backoff * 2 : 1;
+                    if (e->backoff > PROC_MAXBACKOFF)
+                        e->backoff = PROC_MAXBACKOFF;
+                    /* spread the checks so that processes seen together
+                     * are not all read again in the same tick */
+                    e->check = proc_tick + e->backoff + (e->pid & (e->backoff - 1));
+                    continue;
+                }
+            } else if (!proc_read_stat(e)) {
+                continue;
+            }
+
+            /* a grouped process that execs something else leaves its group */
+            if (!proc_matches(e->comm)) {
+                proc_close(e);
+                e->matched = 0;
+                e->backoff = 0;
+                continue;
+            }
+
+            proc_account(e, elapsed);
+        }
+    }
+
+    if (n < 0)
+        warning("proc: cannot read /proc: %.200s", strerror(errno));
+
+    proc_sweep();
+}
+
+int
+get_proc(char *symon_buf, int maxlen, struct stream *st)
+{
+    struct proc_group *g;
+    u_int64_t ticks;
+    double pct;
+
+    if (st->parg.proc >= proc_ngroups)
+        return 0;
+
+    g = &proc_groups[st->parg.proc];
+    ticks = g->utime + g->stime;
+
+    /* the network format carries at most 655.35% */
+    pct = (g->pct > 655.35) ? 655.35 : g->pct;
+
+    /* proc1 carries 32 bit sizes */
+    if (st->type == MT_PROC)
+        return snpack(symon_buf, maxlen, st->arg, MT_PROC,
+                      g->n,
+                      g->utime, g->stime, (u_int64_t) 0,
+                      (u_int32_t) (ticks / proc_hz), pct,
+                      (u_int32_t) ((g->vsize > 0xffffffff) ? 0xffffffff : g->vsize),
+                      (u_int32_t) ((g->rss > 0xffffffff) ? 0xffffffff : g->rss));
+
+    return snpack(symon_buf, maxlen, st->arg, MT_PROC2,
+                  g->n,
+                  g->utime, g->stime, (u_int64_t) 0,
+                  (u_int32_t) (ticks / proc_hz), pct,
+                  g->vsize, g->rss);
+}
@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Get pressure stall information
+ *
+ * some10 : some60 : some300 : some : full10 : full60 : full300 : full
+ *
+ * psi(cpu), psi(memory), psi(io) and psi(irq) report the system from
+ * /proc/pressure, which is read as a shared snapshot. psi(<group>/<resource>)
+ * reports the <resource>.pressure file of a cgroup v2 group, named as for the
+ * cgroup probe; that file is kept open and reread with pread.
+ *
+ * A stream with a trigger registers a psi trigger for a "some" stall, or a
+ * "full" stall for irq, of that many ms within SYMON_PSIWINDOW. symon polls
+ * the trigger and measures the stream as soon as it fires, between its regular
+ * measurements. The kernel signals a trigger at most once per window. The
+ * system files are opened for writing before privileges are dropped; triggers
+ * on groups need write access to their pressure file.
+ */
+#include "conf.h"
+
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include "error.h"
+#include "snapshot.h"
+#include "symon.h"
+#include "sysroot.h"
+#include "xmalloc.h"
+
+#define PSI_IRQ         3
+#define PSI_NRES        4
+
+/* Globals for this module start with psi_ */
+static char *psi_res[PSI_NRES] = { "cpu", "memory", "io", "irq" };
+
+struct psi_source {
+    char *name;                 /* stream argument */
+    char *group;                /* cgroup path, NULL for the system */
+    int res;
+    struct snapshot *snapshot;  /* system */
+    int fd;                     /* group; -1 while closed */
+    int trigfd;                 /* -1 without trigger */
+    int trigger;                /* ms */
+    int missing;
+    int valid;
+    u_int64_t read;             /* measurement of the last read */
+    double avg[2][3];           /* some and full avg10, avg60, avg300 */
+    u_int64_t total[2];         /* us */
+};
+
+static struct psi_source *psi_sources = NULL;
+static int psi_nsources = 0;
+static int psi_privfd[PSI_NRES] = { -1, -1, -1, -1 };
+static int psi_started = 0;
+static u_int64_t psi_tick = 0;
+
+__BEGIN_DECLS
+static int psi_parse(struct psi_source *, char *);
+static void psi_read(struct psi_source *);
+static void psi_arm(struct psi_source *, int);
+static int psi_find(char *);
+__END_DECLS
+
+/*
+ * some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+ * full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+ *
+ * Older kernels have no full line for cpu; irq only has a full line.
+ */
+static int
+psi_parse(struct psi_source *src, char *buf)
+{
+    char label[5];
+    char *line;
+    double avg[3];
+    u_int64_t total;
+    int i, found;
+
+    bzero(src->avg, sizeof(src->avg));
+    bzero(src->total, sizeof(src->total));
+
+    found = 0;
+    while ((line = strsep(&buf, "\n")) != NULL) {
+        if (sscanf(line, "%4s avg10=%lf avg60=%lf avg300=%lf total=%" SCNu64,
+                   label, &avg[0], &avg[1], &avg[2], &total) != 5)
+            continue;
+
+        if (strcmp(label, "some") == 0)
+            i = 0;
+        else if (strcmp(label, "full") == 0)
+            i = 1;
+        else
+            continue;
+
+        bcopy(avg, src->avg[i], sizeof(avg));
+        src->total[i] = total;
+        found = 1;
+    }
+
+    return found;
+}
+
+static void
+psi_read(struct psi_source *src)
+{
+    char buf[256];
+    char path[MAX_PATH_LEN];
+    ssize_t n;
+    int dirfd;
+
+    src->read = psi_tick;
+    src->valid = 0;
+
+    if (src->group == NULL) {
+        buf[0] = '\0';
+        if (lock_snapshot(src->snapshot))
+            strlcpy(buf, src->snapshot->buf, sizeof(buf));
+        unlock_snapshot(src->snapshot);
+
+        src->valid = psi_parse(src, buf);
+        return;
+    }
+
+    if (src->fd == -1) {
+        snprintf(path, sizeof(path), "%s.pressure", psi_res[src->res]);
+        if ((dirfd = open_cgroup(src->group)) != -1) {
+            src->fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+            close(dirfd);
+        }
+
+        if (src->fd == -1) {
+            if (!src->missing)
+                warning("psi: group '%.200s' has no %.200s", src->group, path);
+            src->missing = 1;
+            return;
+        }
+
+        if (src->missing)
+            info("psi: group '%.200s' found", src->group);
+        src->missing = 0;
+    }
+
+    /* the file of a removed group fails; it is looked up again at the next
+     * measurement */
+    if ((n = pread(src->fd, buf, sizeof(buf) - 1, 0)) <= 0) {
+        close(src->fd);
+        src->fd = -1;
+        return;
+    }
+    buf[n] = '\0';
+
+    src->valid = psi_parse(src, buf);
+}
+
+/* Register a trigger for a stall of ms within the window */
+static void
+psi_arm(struct psi_source *src, int ms)
+{
+    char path[MAX_PATH_LEN];
+    char file[32];
+    char trigger[64];
+    int dirfd, fd;
+
+    if (src->trigfd != -1) {
+        if (src->trigger != ms)
+            warning("psi(%.200s): trigger already set to %d ms", src->name,
+                    src->trigger);
+        return;
+    }
+
+    fd = -1;
+    if (src->group == NULL) {
+        /* fds opened before the privilege drop may set any window */
+        if ((fd = psi_privfd[src->res]) != -1)
+            psi_privfd[src->res] = -1;
+        else {
+            snprintf(file, sizeof(file), "pressure/%s", psi_res[src->res]);
+            fd = open(procfs_path(path, sizeof(path), file),
+                      O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        }
+    } else if ((dirfd = open_cgroup(src->group)) != -1) {
+        snprintf(file, sizeof(file), "%s.pressure", psi_res[src->res]);
+        fd = openat(dirfd, file, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        close(dirfd);
+    }
+
+    /* irq only accounts full stalls */
+    snprintf(trigger, sizeof(trigger), "%s %d %d",
+             (src->res == PSI_IRQ) ? "full" : "some", ms * 1000,
+             SYMON_PSIWINDOW * 1000);
+
+    if (fd == -1 || write(fd, trigger, strlen(trigger) + 1) == -1) {
+        warning("psi(%.200s): cannot set trigger: %.200s", src->name,
+                strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+
+    src->trigfd = fd;
+    src->trigger = ms;
+}
+
+/* Return the source of a stream argument */
+static int
+psi_find(char *name)
+{
+    struct psi_source *src;
+    char path[MAX_PATH_LEN];
+    char file[32];
+    char *res;
+    int i;
+
+    for (i = 0; i < psi_nsources; i++)
+        if (strcmp(psi_sources[i].name, name) == 0)
+            return i;
+
+    res = strrchr(name, '/');
+    res = (res == NULL) ? name : res + 1;
+    for (i = 0; i < PSI_NRES; i++)
+        if (strcmp(psi_res[i], res) == 0)
+            break;
+    if (i == PSI_NRES)
+        fatal("psi(%.200s): resource '%.200s' is not one of cpu, memory, io or irq",
+              name, res);
+
+    if (psi_nsources >= SYMON_MAX_DOBJECTS)
+        fatal("%s:%d: dynamic object limit (%d) exceeded for psi data",
+              __FILE__, __LINE__, SYMON_MAX_DOBJECTS);
+
+    psi_sources = xrealloc(psi_sources, (psi_nsources + 1) * sizeof(struct psi_source));
+    src = &psi_sources[psi_nsources];
+    bzero(src, sizeof(struct psi_source));
+    src->name = xstrdup(name);
+    src->res = i;
+    src->fd = -1;
+    src->trigfd = -1;
+
+    if (res == name) {
+        snprintf(file, sizeof(file), "pressure/%s", psi_res[i]);
+        src->snapshot = open_snapshot(procfs_path(path, sizeof(path), file), NULL);
+    } else {
+        src->group = xstrdup(name);
+        src->group[res - name - 1] = '\0';
+        if (!open_cgroup_root())
+            fatal("psi(%.200s): no cgroup v2 hierarchy mounted", name);
+    }
+
+    return psi_nsources++;
+}
+
+void
+privinit_psi(void)
+{
+    char path[MAX_PATH_LEN];
+    char file[32];
+    int i;
+
+    if (psi_started)
+        return;
+    psi_started = 1;
+
+    for (i = 0; i < PSI_NRES; i++) {
+        snprintf(file, sizeof(file), "pressure/%s", psi_res[i]);
+        psi_privfd[i] = open(procfs_path(path, sizeof(path), file),
+                             O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    }
+
+    /* groups are optional */
+    open_cgroup_root();
+}
+
+void
+init_psi(struct stream *st)
+{
+    struct psi_source *src;
+
+    privinit_psi();
+
+    st->parg.psi = psi_find(st->arg);
+    src = &psi_sources[st->parg.psi];
+
+    if (st->trigger)
+        psi_arm(src, st->trigger);
+    st->wakefd = src->trigfd;
+
+    info("started module psi(%.200s)", st->arg);
+}
+
+void
+gets_psi(void)
+{
+    psi_tick++;
+}
+
+int
+get_psi(char *symon_buf, int maxlen, struct stream *st)
+{
+    struct psi_source *src = &psi_sources[st->parg.psi];
+
+    if (src->read != psi_tick)
+        psi_read(src);
+
+    if (!src->valid)
+        return 0;
+
+    return snpack(symon_buf, maxlen, st->arg, MT_PSI,
+                  src->avg[0][0], src->avg[0][1], src->avg[0][2], src->total[0],
+                  src->avg[1][0], src->avg[1][1], src->avg[1][2], src->total[1]);
+}
+
+/* List the resources of the system */
+void
+list_psi(void (*object) (char *, void *), void *arg)
+{
+    char path[MAX_PATH_LEN];
+    char file[32];
+    int i;
+
+    for (i = 0; i < PSI_NRES; i++) {
+        snprintf(file, sizeof(file), "pressure/%s", psi_res[i]);
+        if (access(procfs_path(path, sizeof(path), file), R_OK) == 0)
+            object(psi_res[i], arg);
+    }
+}
@@ -33,6 +33,11 @@
  *
  * num : value
  *
+ * All hwmon chips are enumerated once. Sensors are named chip.label, with the
+ * chip name taken from the hwmon name attribute and the label from the
+ * <input>_label attribute, so that names survive hwmon renumbering across
+ * boots. Values are read through the per-path snapshot, which keeps the file
+ * open and rereads it with pread.
  */
 
 #include "conf.h"
@@ -41,31 +46,284 @@
 #include <sys/stat.h>
 
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "error.h"
+#include "snapshot.h"
 #include "symon.h"
+#include "sysroot.h"
 #include "xmalloc.h"
 
+/* Globals for this module start with sn_ */
+#define SN_NAMELEN 32
+
+struct sn_chip {
+    char name[SN_NAMELEN];
+    char dev[MAX_PATH_LEN];     /* resolved device, orders equal names */
+    char dir[MAX_PATH_LEN];
+};
+
+struct sn_entry {
+    char id[SYMON_PS_ARGLENV2]; /* chip.label */
+    char chip[SN_NAMELEN];
+    char input[SN_NAMELEN];     /* e.g. temp1 */
+    char path[MAX_PATH_LEN];
+    int type;
+};
+
+static struct sn_entry *sn_entries = NULL;
+static int sn_count = 0;
+static int sn_max = 0;
+static int sn_scanned = 0;
+
+/* Read a short sysfs attribute into buf, dropping the trailing newline */
+static int
+sn_attr(char *path, char *buf, size_t len)
+{
+    ssize_t n;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 0;
+
+    n = read(fd, buf, len - 1);
+    close(fd);
+
+    if (n <= 0)
+        return 0;
+
+    buf[n] = '\0';
+    buf[strcspn(buf, "\n")] = '\0';
+
+    return (buf[0] != '\0');
+}
+
+/* Replace characters that do not belong in a stream argument */
+static void
+sn_sanitise(char *s)
+{
+    for (; *s; s++)
+        if (!isalnum((unsigned char) *s) && *s != '.' && *s != '-' && *s != '_')
+            *s = '_';
+}
+
+static int
+sn_type(char *name)
+{
+    int32_t n;
+    char c;
+
+    if (sscanf(name, "fan%" SCNd32 "%c", &n, &c) == 1)
+        return SENSOR_FAN;
+    else if (sscanf(name, "in%" SCNd32 "%c", &n, &c) == 1)
+        return SENSOR_IN;
+    else if (sscanf(name, "temp%" SCNd32 "%c", &n, &c) == 1)
+        return SENSOR_TEMP;
+
+    return -1;
+}
+
+static int
+sn_cmpchip(const void *a, const void *b)
+{
+    const struct sn_chip *ca = a;
+    const struct sn_chip *cb = b;
+    int r;
+
+    if ((r = strcmp(ca->name, cb->name)) != 0)
+        return r;
+
+    if ((r = strcmp(ca->dev, cb->dev)) != 0)
+        return r;
+
+    return strcmp(ca->dir, cb->dir);
+}
+
+static int
+sn_cmpentry(const void *a, const void *b)
+{
+    const struct sn_entry *ea = a;
+    const struct sn_entry *eb = b;
+    int r;
+
+    if ((r = strcmp(ea->id, eb->id)) != 0)
+        return r;
+
+    return strcmp(ea->path, eb->path);
+}
+
+static int
+sn_cmpid(const void *key, const void *b)
+{
+    return strcmp(key, ((const struct sn_entry *) b)->id);
+}
+
+/* Add all fan, in and temp inputs in dir for chip */
+static void
+sn_scan_dir(char *dir, char *chip)
+{
+    char path[MAX_PATH_LEN];
+    char label[SN_NAMELEN];
+    struct sn_entry *e;
+    struct dirent *d;
+    DIR *dh;
+    char *p;
+    int type;
+    int l;
+
+    if ((dh = opendir(dir)) == NULL)
+        return;
+
+    while ((d = readdir(dh)) != NULL) {
+        if ((p = strstr(d->d_name, "_input")) == NULL || p[6] != '\0')
+            continue;
+
+        l = p - d->d_name;
+        if (l >= SN_NAMELEN)
+            continue;
+
+        if (sn_count == sn_max) {
+            sn_max = sn_max ? sn_max * 2 : 32;
+            sn_entries = xrealloc(sn_entries, sn_max * sizeof(struct sn_entry));
+        }
+        e = &sn_entries[sn_count];
+
+        snprintf(e->input, sizeof(e->input), "%.*s", l, d->d_name);
+        if ((type = sn_type(e->input)) < 0)
+            continue;
+
+        snprintf(path, sizeof(path), "%.900s/%s_label", dir, e->input);
+        if (!sn_attr(path, label, sizeof(label)))
+            snprintf(label, sizeof(label), "%s", e->input);
+        sn_sanitise(label);
+
+        snprintf(e->id, sizeof(e->id), "%s.%s", chip, label);
+        snprintf(e->chip, sizeof(e->chip), "%s", chip);
+        snprintf(e->path, sizeof(e->path), "%.900s/%s_input", dir, e->input);
+        e->type = type;
+        sn_count++;
+    }
+
+    closedir(dh);
+}
+
+/* Enumerate the inputs of all hwmon chips, once */
+static void
+sn_scan(void)
+{
+    char path[MAX_PATH_LEN];
+    char hwmon[MAX_PATH_LEN];
+    char name[SN_NAMELEN];
+    struct sn_chip *chips = NULL;
+    struct dirent *d;
+    DIR *dh;
+    int nchips = 0;
+    int maxchips = 0;
+    int i, j, n;
+
+    if (sn_scanned)
+        return;
+    sn_scanned = 1;
+
+    if ((dh = opendir(sysfs_path(hwmon, sizeof(hwmon), "class/hwmon"))) == NULL) {
+        info("sensor: no hwmon chips found in %.200s", hwmon);
+        return;
+    }
+
+    while ((d = readdir(dh)) != NULL) {
+        if (strncmp(d->d_name, "hwmon", 5) != 0)
+            continue;
+
+        if (nchips == maxchips) {
+            maxchips = maxchips ? maxchips * 2 : 8;
+            chips = xrealloc(chips, maxchips * sizeof(struct sn_chip));
+        }
+
+        snprintf(chips[nchips].dir, MAX_PATH_LEN, "%.900s/%.64s", hwmon, d->d_name);
+
+        /* name lives in the hwmon directory, or in the device for old drivers */
+        snprintf(path, sizeof(path), "%.1000s/name", chips[nchips].dir);
+        if (!sn_attr(path, name, sizeof(name))) {
+            snprintf(path, sizeof(path), "%.1000s/device/name", chips[nchips].dir);
+            if (!sn_attr(path, name, sizeof(name)))
+                snprintf(name, sizeof(name), "%.31s", d->d_name);
+        }
+        sn_sanitise(name);
+        snprintf(chips[nchips].name, SN_NAMELEN, "%s", name);
+
+        snprintf(path, sizeof(path), "%.1000s/device", chips[nchips].dir);
+        if (realpath(path, chips[nchips].dev) == NULL)
+            chips[nchips].dev[0] = '\0';
+
+        nchips++;
+    }
+    closedir(dh);
+
+    /* chips that share a name are told apart by device order: coretemp,
+     * coretemp-1, ... */
+    qsort(chips, nchips, sizeof(struct sn_chip), sn_cmpchip);
+    for (i = 0; i < nchips; i = j) {
+        for (j = i + 1; j < nchips && strcmp(chips[i].name, chips[j].name) == 0; j++)
+            ;
+
+        for (n = i; n < j; n++) {
+            if (n > i) {
+                snprintf(name, sizeof(name), "%.24s-%d", chips[n].name, n - i);
+                snprintf(chips[n].name, SN_NAMELEN, "%s", name);
+            }
+
+            sn_scan_dir(chips[n].dir, chips[n].name);
+            snprintf(path, sizeof(path), "%.1000s/device", chips[n].dir);
+            sn_scan_dir(path, chips[n].name);
+        }
+    }
+    xfree(chips);
+
+    /* labels are not unique per chip; fall back to the input name for
+     * sensors that share a label */
+    qsort(sn_entries, sn_count, sizeof(struct sn_entry), sn_cmpentry);
+    for (i = 0; i < sn_count; i = j) {
+        for (j = i + 1; j < sn_count && strcmp(sn_entries[i].id, sn_entries[j].id) == 0; j++)
+            ;
+
+        if (j - i > 1)
+            for (n = i; n < j; n++)
+                snprintf(sn_entries[n].id, SYMON_PS_ARGLENV2, "%s.%s",
+                         sn_entries[n].chip, sn_entries[n].input);
+    }
+    qsort(sn_entries, sn_count, sizeof(struct sn_entry), sn_cmpentry);
+
+    info("sensor: found %d sensors on %d hwmon chips", sn_count, nchips);
+}
+
 void
 privinit_sensor(void)
 {
-    /* EMPTY */
+    sn_scan();
 }
 
 void
 init_sensor(struct stream *st)
 {
     char buf[SYMON_MAX_OBJSIZE];
+    char rel[MAX_PATH_LEN];
     struct stat pathinfo;
+    struct sn_entry *e;
     char *name, *p;
-    int32_t n;
+    int type;
 
     /* sensors can be identified as using
+     *
+     * - chip.label, as listed by the hwmon enumeration, e.g. coretemp.Core_0
+     *   or nct6775.fan2
      *
      * - a relative path; /sys/class/hwmon[/hwmon0][/device]/${arg}_input is
      *   then assumed: hwmon0/fan1 or fan1
@@ -77,51 +335,59 @@ init_sensor(struct stream *st)
      *   that need to some calculation before returning usable results,
      *   e.g. /symon/fan1
      *
-     * Note that _input is always appended to the sensor argument.
+     * Note that _input is always appended to the sensor argument if it is a
+     * path.
      */
 
     if (strlen(st->arg) < 1)
         fatal("sensor(): no valid argument");
 
-    /* Determine the sensor type */
-    if ((name = strrchr(st->arg, '/')))
-        name += 1;
-    else
-        name = st->arg;
-
-    if (sscanf(name, "fan%" SCNd32, &n) == 1)
-        st->parg.sn.type = SENSOR_FAN;
-    else if (sscanf(name, "in%" SCNd32, &n) == 1)
-        st->parg.sn.type = SENSOR_IN;
-    else if (sscanf(name, "temp%" SCNd32, &n) == 1)
-        st->parg.sn.type = SENSOR_TEMP;
-    else
-        fatal("sensor(%.200s): '%s' is a unknown sensor type; expected fan/in/temp",
-              st->arg, name);
-
-    /* Find the sensor in sysfs */
     p = &st->parg.sn.path[0];
-    if (st->arg[0] == '/') {
-        snprintf(p, MAX_PATH_LEN - 1, "%s_input", st->arg);
-        p[MAX_PATH_LEN - 1] = '\0';
+    if (strchr(st->arg, '/') == NULL && strchr(st->arg, '.') != NULL) {
+        sn_scan();
+        if ((e = bsearch(st->arg, sn_entries, sn_count, sizeof(struct sn_entry),
+                         sn_cmpid)) == NULL)
+            fatal("sensor(%.200s): not found among the hwmon sensors in %.200s/class/hwmon",
+                  st->arg, sysfs_root);
 
-        if (stat(p, &pathinfo) < 0)
-            fatal("sensor(%.200s): could not find sensor at '%.200s'",
-                  st->arg, p);
+        st->parg.sn.type = e->type;
+        snprintf(p, MAX_PATH_LEN, "%s", e->path);
     } else {
-        snprintf(p, MAX_PATH_LEN - 1, "/sys/class/hwmon/hwmon0/%s_input", st->arg);
-        p[MAX_PATH_LEN - 1] = '\0';
+        /* Determine the sensor type */
+        if ((name = strrchr(st->arg, '/')))
+            name += 1;
+        else
+            name = st->arg;
+
+        if ((type = sn_type(name)) < 0)
+            fatal("sensor(%.200s): '%s' is a unknown sensor type; expected fan/in/temp",
+                  st->arg, name);
+        st->parg.sn.type = type;
 
-        if (stat(p, &pathinfo) < 0) {
-            snprintf(p, MAX_PATH_LEN - 1, "/sys/class/hwmon/hwmon0/device/%s_input", st->arg);
+        /* Find the sensor in sysfs */
+        if (st->arg[0] == '/') {
+            snprintf(p, MAX_PATH_LEN - 1, "%s_input", st->arg);
             p[MAX_PATH_LEN - 1] = '\0';
 
             if (stat(p, &pathinfo) < 0)
-                fatal("sensor(%.200s): could not be found in /sys/class/hwmon/hwmon0[/device]/%s_input",
-                      st->arg, st->arg);
+                fatal("sensor(%.200s): could not find sensor at '%.200s'",
+                      st->arg, p);
+        } else {
+            snprintf(rel, sizeof(rel), "class/hwmon/hwmon0/%s_input", st->arg);
+            sysfs_path(p, MAX_PATH_LEN, rel);
+
+            if (stat(p, &pathinfo) < 0) {
+                snprintf(rel, sizeof(rel), "class/hwmon/hwmon0/device/%s_input", st->arg);
+                sysfs_path(p, MAX_PATH_LEN, rel);
+
+                if (stat(p, &pathinfo) < 0)
+                    fatal("sensor(%.200s): could not be found in %.200s/class/hwmon/hwmon0[/device]/%s_input",
+                          st->arg, sysfs_root, st->arg);
+            }
         }
     }
 
+    st->parg.sn.snapshot = open_snapshot(p, NULL);
     get_sensor(buf, sizeof(buf), st);
 
     info("started module sensor(%.200s)", st->arg);
@@ -130,22 +396,39 @@ init_sensor(struct stream *st)
 int
 get_sensor(char *symon_buf, int maxlen, struct stream *st)
 {
-    FILE *f;
+    struct snapshot *s = st->parg.sn.snapshot;
+    int64_t v = 0;
+    char *p, *end;
     double t;
+    int neg;
 
-    if ((f = fopen(st->parg.sn.path, "r")) == NULL)
-        fatal("sensor(%s): cannot access %.200s: %.200s",
-              st->arg, st->parg.sn.path, strerror(errno));
-
-    if (fscanf(f, "%lf", &t) < 0) {
-        warning("sensor(%s): cannot read sensor value",
-                st->arg);
+    if (!lock_snapshot(s)) {
+        unlock_snapshot(s);
+        warning("sensor(%s): cannot read sensor value", st->arg);
         return 0;
     }
 
-    if (fclose(f) < 0)
-        warning("sensor(%s): cannot close '%.200s'",
-                st->arg, st->parg.sn.path);
+    /* hwmon attributes are plain integers; only values computed outside of
+     * sysfs need the full float conversion */
+    p = s->buf;
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if ((neg = (*p == '-')))
+        p++;
+    for (end = p; *end >= '0' && *end <= '9'; end++)
+        v = v * 10 + (*end - '0');
+
+    if (end != p && *end != '.' && *end != 'e' && *end != 'E') {
+        t = (double) (neg ? -v : v);
+    } else {
+        t = strtod(s->buf, &end);
+        if (end == s->buf) {
+            unlock_snapshot(s);
+            warning("sensor(%s): cannot read sensor value", st->arg);
+            return 0;
+        }
+    }
+    unlock_snapshot(s);
 
     switch (st->parg.sn.type) {
     case SENSOR_TEMP:
@@ -156,3 +439,15 @@ get_sensor(char *symon_buf, int maxlen, struct stream *st)
 
     return snpack(symon_buf, maxlen, st->arg, MT_SENSOR, t);
 }
+
+/* List the sensors of all hwmon chips by their chip.label names */
+void
+list_sensor(void (*object) (char *, void *), void *arg)
+{
+    int i;
+
+    sn_scan();
+
+    for (i = 0; i < sn_count; i++)
+        object(sn_entries[i].id, arg);
+}
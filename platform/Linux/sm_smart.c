@@ -28,15 +28,28 @@
  *
  */
 
+/*
+ * Get smart data from ata disks
+ *
+ * A drive can take tens of milliseconds to answer a smart command, and a drive
+ * in standby would have to spin up. The drives are therefore read by a
+ * background thread, each on the schedule of its streams, and get_smart
+ * reports the last values read together with their age. Drives in standby are
+ * not woken; their values age until the drive spins up by itself.
+ */
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <strings.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 #include <linux/hdreg.h>
 
 #include "conf.h"
@@ -44,6 +57,7 @@
 #include "error.h"
 #include "xmalloc.h"
 #include "smart.h"
+#include "timing.h"
 #include "diskname.h"
 
 #ifndef HAS_HDDRIVECMDHDR
@@ -57,6 +71,10 @@ struct hd_drive_cmd_hdr {
 };
 #endif
 
+#ifndef WIN_CHECKPOWERMODE1
+#define WIN_CHECKPOWERMODE1 0xE5
+#endif
+
 /* Ata command register set for requesting smart values */
 static struct hd_drive_cmd_hdr smart_cmd = {
     WIN_SMART, /* command code */
@@ -65,23 +83,138 @@ static struct hd_drive_cmd_hdr smart_cmd = {
     1 /* sector count */
 };
 
-/* Per drive storage structure; the ata cmd is followed by the data buffer that
- * is filled by the ioctl. There can be no room between the two; hence the
- * pragma for byte alignment.
+/* Ata command buffer; the ata cmd is followed by the data buffer that is
+ * filled by the ioctl. There can be no room between the two; hence the pragma
+ * for byte alignment.
  */
 #pragma pack(1)
-struct smart_device {
+struct smart_command {
     struct hd_drive_cmd_hdr cmd;
     struct smart_values data;
+};
+#pragma pack()
+
+/* Per drive storage structure */
+struct smart_device {
+    struct smart_values data;   /* last values read */
     char name[MAX_PATH_LEN];
     int fd;
-    int type;
+    int interval;               /* ms between reads */
+    u_int64_t next;             /* ms; next read is due */
+    u_int64_t read;             /* ms; last succesful read, 0 = never */
     int failed;
+    int standby;
 };
-#pragma pack()
 
 static struct smart_device *smart_devs = NULL;
 static int smart_cur = 0;
+static int smart_started = 0;
+static pthread_mutex_t smart_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Return 1 if the drive reports that it is in standby */
+static int
+smart_standby(int fd)
+{
+    unsigned char args[4] = { WIN_CHECKPOWERMODE1, 0, 0, 0 };
+
+    /* drives that do not support the command are assumed to be active */
+    if (ioctl(fd, HDIO_DRIVE_CMD, args))
+        return 0;
+
+    return (args[2] == 0);
+}
+
+/* Read drive <i>; the ioctl is done without holding the mutex */
+static void
+smart_read(int i)
+{
+    struct smart_command c;
+    char name[MAX_PATH_LEN];
+    int fd, standby, failed;
+    int saved;
+
+    pthread_mutex_lock(&smart_mutex);
+    fd = smart_devs[i].fd;
+    strlcpy(name, smart_devs[i].name, sizeof(name));
+    pthread_mutex_unlock(&smart_mutex);
+
+    failed = 0;
+    saved = 0;
+    if (!(standby = smart_standby(fd))) {
+        /* populate ata command header */
+        memcpy(&c.cmd, (void *) &smart_cmd, sizeof(struct hd_drive_cmd_hdr));
+        if (ioctl(fd, HDIO_DRIVE_CMD, &c)) {
+            saved = errno;
+            failed = 1;
+        }
+
+        /* Linux does not allow checking the smart return code using the
+         * HDIO_DRIVE_CMD */
+
+        /* Some drives do not calculate the smart checksum correctly;
+         * additional code that identifies these drives would increase our
+         * footprint and the amount of datajuggling we need to do; we would
+         * rather ignore the checksums.
+         */
+    }
+
+    pthread_mutex_lock(&smart_mutex);
+    if (standby != smart_devs[i].standby)
+        info("smart: drive '%.200s' %s", name,
+             standby ? "is in standby; not reading it" : "is active again");
+    if (failed && !smart_devs[i].failed)
+        warning("smart: ioctl for drive '%.200s' failed: %.200s",
+                name, strerror(saved));
+
+    smart_devs[i].standby = standby;
+    if (!standby) {
+        smart_devs[i].failed = failed;
+        if (!failed) {
+            memcpy(&smart_devs[i].data, &c.data, sizeof(struct smart_values));
+            smart_devs[i].read = clock_usec(CLOCK_MONOTONIC) / 1000;
+        }
+    }
+    pthread_mutex_unlock(&smart_mutex);
+}
+
+/* Background thread that reads the drives that are due */
+static void *
+smart_poller(void *arg)
+{
+    struct timespec ts;
+    u_int64_t now, wait;
+    int i, n;
+
+    for (;;) {
+        now = clock_usec(CLOCK_MONOTONIC) / 1000;
+        wait = SYMON_SMARTINTERVAL;
+
+        pthread_mutex_lock(&smart_mutex);
+        n = smart_cur;
+        pthread_mutex_unlock(&smart_mutex);
+
+        for (i = 0; i < n; i++) {
+            pthread_mutex_lock(&smart_mutex);
+            if (smart_devs[i].next <= now) {
+                smart_devs[i].next = now + smart_devs[i].interval;
+                pthread_mutex_unlock(&smart_mutex);
+                smart_read(i);
+                continue;
+            }
+            if (smart_devs[i].next - now < wait)
+                wait = smart_devs[i].next - now;
+            pthread_mutex_unlock(&smart_mutex);
+        }
+
+        /* drives added on reconfiguration are picked up within a second */
+        ts.tv_sec = wait / 1000;
+        ts.tv_nsec = (wait % 1000) * 1000000;
+        nanosleep(&ts, NULL);
+    }
+
+    /* NOT REACHED */
+    return NULL;
+}
 
 void
 init_smart(struct stream *st)
@@ -89,7 +222,9 @@ init_smart(struct stream *st)
     struct disknamectx c;
     int fd;
     int i;
+    int interval;
     char drivename[MAX_PATH_LEN];
+    char *p;
 
     if (sizeof(struct smart_values) != DISK_BLOCK_LEN) {
         fatal("smart: internal error: smart values structure is broken");
@@ -109,9 +244,24 @@ init_smart(struct stream *st)
     if (fd < 0)
         fatal("smart: cannot open '%.200s'", st->arg);
 
-    /* look for drive in our global table */
+    if (strncmp((p = strrchr(drivename, '/')) ? p + 1 : drivename, "nvme", 4) == 0)
+        fatal("smart(%.200s): nvme drives do not speak ata; use nvme(%.200s)",
+              st->arg, st->arg);
+
+    interval = st->interval;
+    if (interval < SYMON_SMARTINTERVAL)
+        interval = SYMON_SMARTINTERVAL;
+
+    pthread_mutex_lock(&smart_mutex);
+
+    /* look for drive in our global table; a drive is read as often as its
+     * most frequent stream needs */
     for (i = 0; i < smart_cur; i++) {
         if (strncmp(smart_devs[i].name, drivename, sizeof(drivename)) == 0) {
+            if (interval < smart_devs[i].interval)
+                smart_devs[i].interval = interval;
+            pthread_mutex_unlock(&smart_mutex);
+            close(fd);
             st->parg.smart = i;
             return;
         }
@@ -132,65 +282,56 @@ init_smart(struct stream *st)
 
     /* store filedescriptor to device */
     smart_devs[smart_cur].fd = fd;
+    smart_devs[smart_cur].interval = interval;
 
     /* store smart dev entry in stream to facilitate quick get */
     st->parg.smart = smart_cur;
 
     smart_cur++;
 
+    pthread_mutex_unlock(&smart_mutex);
+
     info("started module smart(%.200s = %.200s)", st->arg, smart_devs[st->parg.smart].name);
 }
 
+/* Start the poller; drives are never read from the measurement loop */
 void
 gets_smart(void)
 {
-  int i;
-
-    for (i = 0; i < smart_cur; i++) {
-        /* populate ata command header */
-        memcpy(&smart_devs[i].cmd, (void *) &smart_cmd, sizeof(struct hd_drive_cmd_hdr));
-        if (ioctl(smart_devs[i].fd, HDIO_DRIVE_CMD, &smart_devs[i].cmd)) {
-            warning("smart: ioctl for drive '%.200s' failed: %.200s",
-                    &smart_devs[i].name, strerror(errno));
-            smart_devs[i].failed = 1;
-        }
+    pthread_t thread;
+    sigset_t all, old;
 
-        /* Linux does not allow checking the smart return code using the
-         * HDIO_DRIVE_CMD */
+    if (smart_started)
+        return;
+    smart_started = 1;
 
-        /* Some drives do not calculate the smart checksum correctly;
-         * additional code that identifies these drives would increase our
-         * footprint and the amount of datajuggling we need to do; we would
-         * rather ignore the checksums.
-         */
-        smart_devs[i].failed = 0;
-    }
-    return;
+    /* signals are handled by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    if ((errno = pthread_create(&thread, NULL, smart_poller, NULL)) != 0)
+        fatal("smart: cannot start poller: %.200s", strerror(errno));
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_detach(thread);
 }
 
 int
 get_smart(char *symon_buf, int maxlen, struct stream *st)
 {
     struct smart_report sr;
+    u_int32_t age;
 
+    pthread_mutex_lock(&smart_mutex);
     if ((st->parg.smart < smart_cur) &&
-        (!smart_devs[st->parg.smart].failed))
+        (smart_devs[st->parg.smart].read != 0))
     {
         smart_parse(&smart_devs[st->parg.smart].data, &sr);
-        return snpack(symon_buf, maxlen, st->arg, MT_SMART,
-                      sr.read_error_rate,
-                      sr.reallocated_sectors,
-                      sr.spin_retries,
-                      sr.air_flow_temp,
-                      sr.temperature,
-                      sr.reallocations,
-                      sr.current_pending,
-                      sr.uncorrectables,
-                      sr.soft_read_error_rate,
-                      sr.g_sense_error_rate,
-                      sr.temperature2,
-                      sr.free_fall_protection);
+        age = (clock_usec(CLOCK_MONOTONIC) / 1000 -
+               smart_devs[st->parg.smart].read) / 1000;
+        pthread_mutex_unlock(&smart_mutex);
+
+        return smart_pack(symon_buf, maxlen, st->arg, st->type, &sr, age);
     }
+    pthread_mutex_unlock(&smart_mutex);
 
     return 0;
 }
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Get cost statistics of symon itself
+ *
+ * self          = scheduler; calls are ticks, wall time is tick lateness,
+ *                 cpu time is that of the whole process and errors are
+ *                 skipped measurements
+ * self(send)    = sending packets; bytes sent and send errors
+ * self(<probe>) = a probe, e.g. self(io); bytes packed, empty measurements
+ *                 and missed deadlines
+ */
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <string.h>
+
+#include "conf.h"
+#include "error.h"
+#include "selfstat.h"
+#include "symon.h"
+
+__BEGIN_DECLS
+static int self_target(char *);
+__END_DECLS
+
+#define SELF_SCHED   -1
+#define SELF_SEND    -2
+#define SELF_UNKNOWN -3
+
+/* Map a self argument onto its target */
+static int
+self_target(char *arg)
+{
+    int type;
+
+    if (arg == NULL || arg[0] == '\0')
+        return SELF_SCHED;
+
+    if (strcmp(arg, "send") == 0)
+        return SELF_SEND;
+
+    for (type = 0; type < MT_EOT; type++)
+        if (type != MT_TEST && strcmp(type2str(type), arg) == 0)
+            return type;
+
+    return SELF_UNKNOWN;
+}
+void
+init_self(struct stream *st)
+{
+    if (self_target(st->arg) == SELF_UNKNOWN)
+        warning("self(%.200s): unknown probe; reporting zeros", st->arg);
+
+    info("started module self(%.200s)", st->arg);
+}
+int
+get_self(char *symon_buf, int maxlen, struct stream *st)
+{
+    struct selfstat s, m;
+    struct rusage ru;
+    int target;
+    int type;
+    int i;
+
+    bzero(&s, sizeof(s));
+    target = self_target(st->arg);
+
+    if (target == SELF_SCHED) {
+        read_selfstat(&self_sched, &s);
+        if (getrusage(RUSAGE_SELF, &ru) == 0)
+            s.cpu = ((u_int64_t) ru.ru_utime.tv_sec * 1000000) + ru.ru_utime.tv_usec +
+                ((u_int64_t) ru.ru_stime.tv_sec * 1000000) + ru.ru_stime.tv_usec;
+    } else if (target == SELF_SEND) {
+        read_selfstat(&self_send, &s);
+    } else if (target >= 0) {
+        /* versions of a stream share their probe, e.g. io1 and io */
+        for (type = 0; type < MT_EOT; type++) {
+            if (streamfunc[type].get != streamfunc[target].get)
+                continue;
+
+            read_selfstat(&self_module[type], &m);
+            s.calls += m.calls;
+            s.wall += m.wall;
+            s.cpu += m.cpu;
+            if (m.max > s.max)
+                s.max = m.max;
+            s.bytes += m.bytes;
+            s.errors += m.errors;
+            for (i = 0; i < SELF_BUCKETS; i++)
+                s.hist[i] += m.hist[i];
+        }
+    }
+
+    return snpack(symon_buf, maxlen, st->arg, MT_SELF,
+                  s.calls, s.wall, s.cpu, s.max, s.bytes, s.errors,
+                  s.hist[0], s.hist[1], s.hist[2], s.hist[3],
+                  s.hist[4], s.hist[5], s.hist[6]);
+}
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+
+#include "sylimits.h"
+#include "data.h"
+#include "error.h"
+
+void
+privinit_cgroup(void)
+{
+    fatal("cgroup module not available");
+}
+
+void
+init_cgroup(struct stream *st)
+{
+    fatal("cgroup module not available");
+}
+
+void
+gets_cgroup(void)
+{
+    fatal("cgroup module not available");
+}
+
+int
+get_cgroup(char *symon_buf, int maxlen, struct stream *st)
+{
+    fatal("cgroup module not available");
+    /* NOT REACHED */
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include <stdlib.h>
+
+#include "sylimits.h"
+#include "data.h"
+#include "error.h"
+
+void
+init_cpus(struct stream *st)
+{
+    fatal("cpus module not available");
+}
+
+void
+gets_cpus(void)
+{
+    fatal("cpus module not available");
+}
+
+int
+get_cpus(char *symon_buf, int maxlen, struct stream *st)
+{
+    fatal("cpus module not available");
+    /* NOT REACHED */
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include <stdlib.h>
+
+#include "sylimits.h"
+#include "data.h"
+#include "error.h"
+
+void
+init_nvme(struct stream *st)
+{
+    fatal("nvme module not available");
+}
+
+void
+gets_nvme(void)
+{
+    fatal("nvme module not available");
+}
+
+int
+get_nvme(char *symon_buf, int maxlen, struct stream *st)
+{
+    fatal("nvme module not available");
+    /* NOT REACHED */
+    return 0;
+}
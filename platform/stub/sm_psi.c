@@ -0,0 +1,31 @@
+#include <stdlib.h>
+
+#include "sylimits.h"
+#include "data.h"
+#include "error.h"
+
+void
+privinit_psi(void)
+{
+    fatal("psi module not available");
+}
+
+void
+init_psi(struct stream *st)
+{
+    fatal("psi module not available");
+}
+
+void
+gets_psi(void)
+{
+    fatal("psi module not available");
+}
+
+int
+get_psi(char *symon_buf, int maxlen, struct stream *st)
+{
+    fatal("psi module not available");
+    /* NOT REACHED */
+    return 0;
+}
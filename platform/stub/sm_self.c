@@ -0,0 +1,19 @@
+#include <stdlib.h>
+
+#include "sylimits.h"
+#include "data.h"
+#include "error.h"
+
+void
+init_self(struct stream *st)
+{
+    fatal("self module not available");
+}
+
+int
+get_self(char *symon_buf, int maxlen, struct stream *st)
+{
+    fatal("self module not available");
+    /* NOT REACHED */
+    return 0;
+}
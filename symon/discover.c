@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Wildcard streams are expanded by asking the module of the stream to list
+ * the objects it measured last. Streams are added for objects that match the
+ * pattern and removed for objects that disappeared; the caller then rebuilds
+ * the probe groups and timers. Discovery runs in the main thread between
+ * ticks and only when no probe is still running, as modules keep their state
+ * in static variables.
+ */
+
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conf.h"
+#include "data.h"
+#include "discover.h"
+#include "error.h"
+#include "pool.h"
+#include "symon.h"
+#include "xmalloc.h"
+
+__BEGIN_DECLS
+static int cmp_discovered(const void *, const void *);
+static int cmp_name(const void *, const void *);
+static void found_object(char *, void *);
+static int run_discovery(struct discovery *);
+__END_DECLS
+
+static struct discoverylist discoveries = SLIST_HEAD_INITIALIZER(discoveries);
+
+static int
+cmp_discovered(const void *a, const void *b)
+{
+    return strcmp(((struct discovered *) a)->name,
+                  ((struct discovered *) b)->name);
+}
+static int
+cmp_name(const void *a, const void *b)
+{
+    return strcmp(*(char **) a, *(char **) b);
+}
+/* Callback for the list function of a module */
+static void
+found_object(char *name, void *arg)
+{
+    struct discovery *d = (struct discovery *) arg;
+    struct discovered *e, key;
+    char **x;
+
+    if (fnmatch(d->wildcard->arg, name, 0) != 0)
+        return;
+
+    if (d->wildcard->exclude != NULL)
+        for (x = d->wildcard->exclude; *x != NULL; x++)
+            if (fnmatch(*x, name, 0) == 0)
+                return;
+
+    /* names that do not fit the network format cannot be told apart */
+    if (strlen(name) > (SYMON_PS_ARGLENV2 - 1))
+        return;
+
+    key.name = name;
+    e = bsearch(&key, d->entries, d->count, sizeof(struct discovered), cmp_discovered);
+    if (e != NULL) {
+        e->seen = 1;
+        return;
+    }
+
+    if (d->nfound == d->maxfound) {
+        d->maxfound = d->maxfound ? d->maxfound * 2 : 16;
+        d->found = xrealloc(d->found, d->maxfound * sizeof(char *));
+    }
+    d->found[d->nfound++] = xstrdup(name);
+}
+/* Reset discoveries for all wildcard streams of a new configuration */
+void
+init_discovery(struct muxlist * mul)
+{
+    struct discovery *d;
+    struct stream *wildcard;
+    struct mux *mux;
+    int i;
+
+    while ((d = SLIST_FIRST(&discoveries)) != NULL) {
+        SLIST_REMOVE_HEAD(&discoveries, discoveries);
+        for (i = 0; i < d->count; i++)
+            xfree(d->entries[i].name);
+        if (d->entries)
+            xfree(d->entries);
+        if (d->found)
+            xfree(d->found);
+        xfree(d);
+    }
+
+    SLIST_FOREACH(mux, mul, muxes) {
+        SLIST_FOREACH(wildcard, &mux->wl, streams) {
+            d = xmalloc(sizeof(struct discovery));
+            bzero(d, sizeof(struct discovery));
+            d->mux = mux;
+            d->wildcard = wildcard;
+            SLIST_INSERT_HEAD(&discoveries, d, discoveries);
+        }
+    }
+}
+/* Update the streams of one wildcard; returns the number of changes */
+static int
+run_discovery(struct discovery * d)
+{
+    struct streamlist gone;
+    struct stream *w, *stream;
+    char *last;
+    int changes;
+    int i, j;
+
+    w = d->wildcard;
+
+    for (i = 0; i < d->count; i++)
+        d->entries[i].seen = 0;
+    d->nfound = 0;
+
+    (streamfunc[w->type].list) (found_object, d);
+
+    /* remove streams of objects that disappeared */
+    changes = 0;
+    SLIST_INIT(&gone);
+    for (i = j = 0; i < d->count; i++) {
+        if (d->entries[i].seen) {
+            d->entries[j++] = d->entries[i];
+            continue;
+        }
+
+        if ((stream = d->entries[i].stream) != NULL) {
+            info("%.200s(%.200s): no longer present", type2str(stream->type), stream->arg);
+            SLIST_REMOVE(&d->mux->sl, stream, stream, streams);
+            SLIST_INSERT_HEAD(&gone, stream, streams);
+            d->owned--;
+            changes++;
+        }
+        xfree(d->entries[i].name);
+    }
+    d->count = j;
+    free_streamlist(&gone);
+
+    /* add streams for new objects; some modules list an object twice */
+    qsort(d->found, d->nfound, sizeof(char *), cmp_name);
+    last = NULL;
+    for (i = 0; i < d->nfound; i++) {
+        if (last != NULL && strcmp(last, d->found[i]) == 0)
+            continue;
+        last = d->found[i];
+
+        if ((stream = find_mux_stream(d->mux, w->type, d->found[i])) != NULL) {
+            /* measured by another stream, which is not ours to remove */
+            stream = NULL;
+        } else if (d->owned >= w->limit) {
+            if (!d->limited)
+                warning("%.200s(%.200s): limit of %d streams reached; not adding %.200s",
+                        type2str(w->type), w->arg, w->limit, d->found[i]);
+            d->limited = 1;
+            continue;
+        } else {
+            stream = add_mux_stream(d->mux, w->type, d->found[i]);
+            stream->interval = w->interval;
+            stream->trigger = w->trigger;
+            (streamfunc[stream->type].init) (stream);
+            info("%.200s(%.200s): discovered", type2str(stream->type), stream->arg);
+            d->owned++;
+            changes++;
+        }
+
+        if (d->count == d->max) {
+            d->max = d->max ? d->max * 2 : 16;
+            d->entries = xrealloc(d->entries, d->max * sizeof(struct discovered));
+        }
+        d->entries[d->count].name = d->found[i];
+        d->entries[d->count].stream = stream;
+        d->entries[d->count].seen = 1;
+        d->count++;
+        d->found[i] = NULL;
+    }
+
+    for (i = 0; i < d->nfound; i++)
+        if (d->found[i] != NULL)
+            xfree(d->found[i]);
+
+    qsort(d->entries, d->count, sizeof(struct discovered), cmp_discovered);
+
+    return changes;
+}
+/*
+ * Expand all wildcard streams. Returns whether streams were added or removed,
+ * in which case the probe pool and timers need to be rebuilt.
+ */
+int
+discover_streams(void)
+{
+    struct discovery *d;
+    int changed;
+
+    if (SLIST_EMPTY(&discoveries) || !idle_pool())
+        return 0;
+
+    changed = 0;
+    SLIST_FOREACH(d, &discoveries, discoveries) {
+        /* objects are listed when the wildcard stream is due */
+        if (d->started && (now % d->wildcard->interval) != 0)
+            continue;
+        d->started = 1;
+
+        if (run_discovery(d)) {
+            /* samples of a batch in progress are kept */
+            init_symon_packet(d->mux);
+            changed = 1;
+        }
+    }
+
+    return changed;
+}
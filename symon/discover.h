@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SYMON_DISCOVER_H
+#define _SYMON_DISCOVER_H
+
+#include "data.h"
+
+/*
+ * A discovery expands a wildcard stream, e.g. if(eth*), into a stream per
+ * object that matches. Entries are kept sorted by name. Objects that are
+ * measured by a stream that was configured explicitly, or by another
+ * wildcard, are remembered without a stream.
+ */
+struct discovered {
+    char *name;
+    struct stream *stream;      /* stream added by this discovery, or NULL */
+    int seen;                   /* object was listed this pass */
+};
+
+struct discovery {
+    struct mux *mux;
+    struct stream *wildcard;
+    struct discovered *entries;
+    int count;
+    int max;
+    char **found;               /* new objects found this pass */
+    int nfound;
+    int maxfound;
+    int owned;                  /* streams added by this discovery */
+    int limited;                /* reached limit has been reported */
+    int started;                /* first pass was made */
+    SLIST_ENTRY(discovery) discoveries;
+};
+SLIST_HEAD(discoverylist, discovery);
+
+/* prototypes */
+__BEGIN_DECLS
+void init_discovery(struct muxlist *);
+int discover_streams(void);
+__END_DECLS
+#endif                          /* _SYMON_DISCOVER_H */
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Worker pool that takes the measurements of a tick. Every probe group with
+ * due streams becomes a job. The main thread waits for the jobs until a
+ * deadline; streams of groups that are still running after that are omitted
+ * from the packets of this tick. A group that is still running is not started
+ * again until it finishes.
+ */
+#include <sys/types.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "conf.h"
+#include "data.h"
+#include "error.h"
+#include "pool.h"
+#include "selfstat.h"
+#include "snapshot.h"
+#include "symon.h"
+#include "xmalloc.h"
+
+__BEGIN_DECLS
+static void *worker(void *);
+static void run_group(struct probegroup *);
+static struct probegroup *find_group(struct stream *);
+__END_DECLS
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done;        /* on CLOCK_MONOTONIC */
+static struct probejobs pool_jobs = TAILQ_HEAD_INITIALIZER(pool_jobs);
+static struct probegrouplist pool_groups = SLIST_HEAD_INITIALIZER(pool_groups);
+static int pool_busy = 0;               /* groups queued or running */
+static int pool_started = 0;
+
+/* Measure all due streams of a group into their own buffers */
+static void
+run_group(struct probegroup * g)
+{
+    struct selftimer timer;
+    struct stream *stream;
+    int i;
+
+    if (g->gets != NULL) {
+        start_selftimer(&timer);
+        (g->gets) ();
+        stop_selftimer(&timer, &self_module[g->type], 0, 0);
+    }
+
+    for (i = 0; i < g->ndue; i++) {
+        stream = g->due[i];
+        start_selftimer(&timer);
+        stream->plen = (g->get) (stream->pbuf, stream->pbuflen, stream);
+        stop_selftimer(&timer, &self_module[stream->type], stream->plen,
+                       (stream->plen <= 0));
+    }
+}
+static void *
+worker(void *arg)
+{
+    struct probegroup *g;
+
+    for (;;) {
+        pthread_mutex_lock(&pool_mutex);
+        while (TAILQ_EMPTY(&pool_jobs))
+            pthread_cond_wait(&pool_work, &pool_mutex);
+        g = TAILQ_FIRST(&pool_jobs);
+        TAILQ_REMOVE(&pool_jobs, g, jobs);
+        pthread_mutex_unlock(&pool_mutex);
+
+        run_group(g);
+
+        pthread_mutex_lock(&pool_mutex);
+        g->busy = 0;
+        pool_busy--;
+        pthread_cond_signal(&pool_done);
+        pthread_mutex_unlock(&pool_mutex);
+    }
+
+    return NULL;
+}
+/* Wait for all running groups to finish */
+void
+drain_pool(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    if (pool_busy)
+        info("waiting for %d probe(s) to finish", pool_busy);
+    while (pool_busy)
+        pthread_cond_wait(&pool_done, &pool_mutex);
+    pthread_mutex_unlock(&pool_mutex);
+}
+/* Check whether no groups are queued or being measured */
+int
+idle_pool(void)
+{
+    int idle;
+
+    pthread_mutex_lock(&pool_mutex);
+    idle = (pool_busy == 0);
+    pthread_mutex_unlock(&pool_mutex);
+
+    return idle;
+}
+/* Group the streams of all muxes by module and start the workers */
+void
+init_pool(struct muxlist * mul)
+{
+    struct probegroup *g;
+    struct stream *stream;
+    struct mux *mux;
+    pthread_condattr_t attr;
+    sigset_t all, old;
+    pthread_t thread;
+    int i;
+
+    /* the deadline of a tick must not move with wall clock steps */
+    if (!pool_started) {
+        pthread_condattr_init(&attr);
+        if ((errno = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC)) != 0 ||
+            (errno = pthread_cond_init(&pool_done, &attr)) != 0)
+            fatal("could not set up probe pool: %.200s", strerror(errno));
+        pthread_condattr_destroy(&attr);
+    }
+
+    drain_pool();
+
+    while ((g = SLIST_FIRST(&pool_groups)) != NULL) {
+        SLIST_REMOVE_HEAD(&pool_groups, groups);
+        xfree(g->due);
+        xfree(g);
+    }
+
+    SLIST_FOREACH(mux, mul, muxes) {
+        SLIST_FOREACH(stream, &mux->sl, streams) {
+            SLIST_FOREACH(g, &pool_groups, groups)
+                if (g->get == streamfunc[stream->type].get)
+                    break;
+
+            if (g == NULL) {
+                g = xmalloc(sizeof(struct probegroup));
+                bzero(g, sizeof(struct probegroup));
+                g->type = stream->type;
+                g->gets = streamfunc[stream->type].gets;
+                g->get = streamfunc[stream->type].get;
+                SLIST_INSERT_HEAD(&pool_groups, g, groups);
+            }
+            g->nstreams++;
+
+            if (stream->pbuf == NULL) {
+                /* snpack needs a spare byte at the end */
+                stream->pbuflen = bytelen_stream(stream) + 1;
+                stream->pbuf = xmalloc(stream->pbuflen);
+            }
+        }
+    }
+
+    SLIST_FOREACH(g, &pool_groups, groups)
+        g->due = xmalloc(g->nstreams * sizeof(struct stream *));
+
+    if (pool_started)
+        return;
+
+    /* signals are handled by the main thread */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (i = 0; i < SYMON_WORKERS; i++)
+        if ((errno = pthread_create(&thread, NULL, worker, NULL)) != 0)
+            fatal("could not start probe worker: %.200s", strerror(errno));
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    pool_started = 1;
+}
+/* Find the group that measures a stream */
+static struct probegroup *
+find_group(struct stream * stream)
+{
+    struct probegroup *g;
+
+    SLIST_FOREACH(g, &pool_groups, groups)
+        if (g->get == streamfunc[stream->type].get)
+            return g;
+
+    fatal("%s:%d: internal error: stream without probe group", __FILE__, __LINE__);
+
+    /* NOTREACHED */
+    return NULL;
+}
+/*
+ * Measure all due streams, waiting at most timeout ms. Due streams that were
+ * not measured in time are no longer due after this.
+ */
+void
+run_pool(struct muxlist * mul, int timeout)
+{
+    struct probegroup *g;
+    struct stream *stream;
+    struct mux *mux;
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        fatal("cannot read clock: %.200s", strerror(errno));
+    ts.tv_sec += timeout / 1000;
+    ts.tv_nsec += (timeout % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    /* probes reread shared proc and sys files once in this tick */
+    tick_snapshots();
+
+    pthread_mutex_lock(&pool_mutex);
+
+    /* queue a job for every idle group with due streams; the job gets its
+     * own list of due streams. Groups that are still busy skip this tick. */
+    SLIST_FOREACH(g, &pool_groups, groups) {
+        g->queued = g->skipped = 0;
+        if (!g->busy)
+            g->ndue = 0;
+    }
+
+    SLIST_FOREACH(mux, mul, muxes) {
+        SLIST_FOREACH(stream, &mux->sl, streams) {
+            if (!stream->due)
+                continue;
+            g = find_group(stream);
+            if (g->busy)
+                g->skipped = 1;
+            else
+                g->due[g->ndue++] = stream;
+        }
+    }
+
+    SLIST_FOREACH(g, &pool_groups, groups) {
+        if (!g->busy && g->ndue) {
+            g->busy = g->queued = 1;
+            pool_busy++;
+            TAILQ_INSERT_TAIL(&pool_jobs, g, jobs);
+        }
+    }
+    pthread_cond_broadcast(&pool_work);
+
+    while (pool_busy)
+        if (pthread_cond_timedwait(&pool_done, &pool_mutex, &ts) == ETIMEDOUT)
+            break;
+
+    /* only measurements of jobs that were queued and finished this tick are
+     * sent */
+    SLIST_FOREACH(g, &pool_groups, groups) {
+        if (g->queued && !g->busy) {
+            if (g->missed)
+                info("%.200s probe finished in time again after %d missed deadline(s)",
+                     type2str(g->type), g->missed);
+            g->missed = 0;
+        } else if (g->queued || g->skipped) {
+            error_selfstat(&self_module[g->type], 1);
+            if (g->missed++ == 0)
+                warning("%.200s probe missed its deadline; omitting its measurements",
+                        type2str(g->type));
+        }
+    }
+
+    SLIST_FOREACH(mux, mul, muxes) {
+        SLIST_FOREACH(stream, &mux->sl, streams) {
+            if (!stream->due)
+                continue;
+            g = find_group(stream);
+            if (!g->queued || g->busy)
+                stream->due = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SYMON_POOL_H
+#define _SYMON_POOL_H
+
+#include "data.h"
+
+/*
+ * A probe group holds all streams that are measured by the same module. The
+ * streams of a group are measured one after the other by a single worker, as
+ * modules keep their state in static variables. Different groups are measured
+ * in parallel.
+ */
+struct probegroup {
+    int type;                   /* first stream type of this module */
+    void (*gets) (void);
+    int (*get) (char *, int, struct stream *);
+    int busy;                   /* group is queued or being measured */
+    int queued;                 /* group was queued this tick */
+    int skipped;                /* due streams skipped; group was busy */
+    int missed;                 /* consecutive deadlines missed */
+    int nstreams;
+    int ndue;
+    struct stream **due;        /* streams to measure in current job */
+    TAILQ_ENTRY(probegroup) jobs;
+    SLIST_ENTRY(probegroup) groups;
+};
+SLIST_HEAD(probegrouplist, probegroup);
+TAILQ_HEAD(probejobs, probegroup);
+
+/* prototypes */
+__BEGIN_DECLS
+void init_pool(struct muxlist *);
+void drain_pool(void);
+int idle_pool(void);
+void run_pool(struct muxlist *, int);
+__END_DECLS
+#endif                          /* _SYMON_POOL_H */
@@ -42,6 +42,9 @@
 
 __BEGIN_DECLS
 int read_host_port(struct muxlist *, struct mux *, struct lex *);
+int read_interval(struct lex *, int *);
+int read_stream_intervals(struct mux *, struct streamlist *, struct lex *);
+int read_wildcard(struct stream *, struct lex *);
 int read_symon_args(struct mux *, struct lex *);
 int read_monitor(struct muxlist *, struct lex *);
 __END_DECLS
@@ -79,7 +82,10 @@ read_host_port(struct muxlist * mul, struct mux * mux, struct lex * l)
     }
 
     bzero(&muxname, sizeof(muxname));
-    snprintf(&muxname[0], sizeof(muxname), "%s %s (%ds)", mux->addr, mux->port, mux->interval);
+    if (mux->interval % 1000)
+        snprintf(&muxname[0], sizeof(muxname), "%s %s (%dms)", mux->addr, mux->port, mux->interval);
+    else
+        snprintf(&muxname[0], sizeof(muxname), "%s %s (%ds)", mux->addr, mux->port, mux->interval / 1000);
     if (rename_mux(mul, mux, muxname) == NULL) {
         warning("%.200s:%d: monitored data for host '%.200s' has already been specified",
                 l->filename, l->cline, muxname);
@@ -88,10 +94,46 @@ read_host_port(struct muxlist * mul, struct mux * mux, struct lex * l)
 
     return 1;
 }
-/* parse "resource version ['(' argument ')']", end condition == '}' */
+/* parse "'second' | number ['seconds' | 'milliseconds']" into ms; a number
+ * without unit is in seconds */
+int
+read_interval(struct lex * l, int *interval)
+{
+    lex_nexttoken(l);
+
+    if (l->op == LXT_SECOND) {
+        *interval = 1000;
+        return 1;
+    }
+
+    if (l->type != LXY_NUMBER) {
+        parse_error(l, "<number>");
+        return 0;
+    }
+
+    *interval = l->value;
+    lex_nexttoken(l);
+    if (l->op == LXT_SECONDS || l->op == LXT_SECOND) {
+        *interval *= 1000;
+    } else if (l->op != LXT_MILLISECONDS) {
+        lex_ungettoken(l);
+        *interval *= 1000;
+    }
+
+    if (*interval < SYMON_MININTERVAL) {
+        warning("%.200s:%d: monitoring interval should be at least %d ms",
+                l->filename, l->cline, SYMON_MININTERVAL);
+        return 0;
+    }
+
+    return 1;
+}
+/* parse "resource version ['(' argument ')'] ['every' time]", end condition
+ * == '}' */
 int
 read_symon_args(struct mux * mux, struct lex * l)
 {
+    struct stream *stream;
     char sn[_POSIX2_LINE_MAX];
     char sa[_POSIX2_LINE_MAX];
     int st;
@@ -113,10 +155,17 @@ read_symon_args(struct mux * mux, struct lex * l)
         case LXT_PF:
         case LXT_PFQ:
         case LXT_PROC:
+        case LXT_PROC1:
         case LXT_SENSOR:
+        case LXT_SMART1:
         case LXT_SMART:
         case LXT_LOAD:
         case LXT_FLUKSO:
+        case LXT_NVME:
+        case LXT_CGROUP:
+        case LXT_PSI:
+        case LXT_CPUS:
+        case LXT_SELF:
             st = token2type(l->op);
             strncpy(&sn[0], l->token, _POSIX2_LINE_MAX);
 
@@ -145,17 +194,75 @@ read_symon_args(struct mux * mux, struct lex * l)
                         l->filename, l->cline, sa);
             }
 
-            if ((add_mux_stream(mux, st, sa)) == NULL) {
-                warning("%.200s:%d: stream %.200s(%.200s) redefined",
-                        l->filename, l->cline, sn, sa);
-                return 0;
+            if (strpbrk(sa, "*?[") == NULL) {
+                if ((stream = add_mux_stream(mux, st, sa)) == NULL) {
+                    warning("%.200s:%d: stream %.200s(%.200s) redefined",
+                            l->filename, l->cline, sn, sa);
+                    return 0;
+                }
+            } else {
+                if (streamfunc[st].list == NULL) {
+                    warning("%.200s:%d: stream %.200s cannot discover '%.200s' on this platform",
+                            l->filename, l->cline, sn, sa);
+                    return 0;
+                }
+
+                if ((stream = add_mux_wildcard(mux, st, sa)) == NULL) {
+                    warning("%.200s:%d: stream %.200s(%.200s) redefined",
+                            l->filename, l->cline, sn, sa);
+                    return 0;
+                }
+
+                if (!read_wildcard(stream, l))
+                    return 0;
+            }
+
+            /* proc streams can report the proportional set size */
+            lex_nexttoken(l);
+            if (l->op == LXT_PSS) {
+                if (st != MT_PROC && st != MT_PROC2) {
+                    warning("%.200s:%d: pss is only valid for proc streams",
+                            l->filename, l->cline);
+                    return 0;
+                }
+                stream->pss = 1;
+            } else {
+                lex_ungettoken(l);
+            }
+
+            /* psi streams can wake symon while a resource is under pressure */
+            lex_nexttoken(l);
+            if (l->op == LXT_TRIGGER) {
+                if (st != MT_PSI) {
+                    warning("%.200s:%d: trigger is only valid for psi streams",
+                            l->filename, l->cline);
+                    return 0;
+                }
+                if (!read_interval(l, &stream->trigger))
+                    return 0;
+                if (stream->trigger >= SYMON_PSIWINDOW) {
+                    warning("%.200s:%d: trigger should be less than the %d ms window",
+                            l->filename, l->cline, SYMON_PSIWINDOW);
+                    return 0;
+                }
+            } else {
+                lex_ungettoken(l);
+            }
+
+            /* parse stream interval; defaults to the mux interval */
+            lex_nexttoken(l);
+            if (l->op == LXT_EVERY) {
+                if (!read_interval(l, &stream->interval))
+                    return 0;
+            } else {
+                lex_ungettoken(l);
             }
 
             break;
         case LXT_COMMA:
             break;
         default:
-            parse_error(l, "{cpu|cpuiow|df|if|if1|io|io1|load|mem|mem1|pf|pfq|mbuf|debug|proc|sensor|smart|load|flukso}");
+            parse_error(l, "{cpu|cpuiow|df|if|if1|io|io1|load|mem|mem1|pf|pfq|mbuf|debug|proc|proc1|sensor|smart|smart1|load|flukso|self|cpus|nvme|cgroup|psi}");
             return 0;
             break;
         }
@@ -164,8 +271,74 @@ read_symon_args(struct mux * mux, struct lex * l)
     return 1;
 }
 
-/* parse "'monitor' '{' resources '}' ['every' time ] 'stream' ['from' host]
- * ['to'] host [port]" */
+/* parse "['exclude' '(' pattern [',' pattern]* ')'] ['limit' number]" */
+int
+read_wildcard(struct stream * stream, struct lex * l)
+{
+    int n;
+
+    stream->limit = SYMON_MAXWILDCARD;
+
+    lex_nexttoken(l);
+    if (l->op == LXT_EXCLUDE) {
+        EXPECT(l, LXT_OPEN)
+
+        n = 0;
+        stream->exclude = xmalloc(sizeof(char *));
+        do {
+            lex_nexttoken(l);
+            if (l->op == LXT_CLOSE) {
+                parse_error(l, "<pattern>");
+                return 0;
+            }
+            stream->exclude = xrealloc(stream->exclude, (n + 2) * sizeof(char *));
+            stream->exclude[n++] = xstrdup(l->token);
+            stream->exclude[n] = NULL;
+
+            lex_nexttoken(l);
+        } while (l->op == LXT_COMMA);
+
+        if (l->op != LXT_CLOSE) {
+            parse_error(l, ")");
+            return 0;
+        }
+
+        lex_nexttoken(l);
+    }
+
+    if (l->op == LXT_LIMIT) {
+        lex_nexttoken(l);
+        if (l->type != LXY_NUMBER || l->value < 1) {
+            parse_error(l, "<number>");
+            return 0;
+        }
+        stream->limit = l->value;
+    } else {
+        lex_ungettoken(l);
+    }
+
+    return 1;
+}
+/* Check that stream intervals are multiples of the monitor interval */
+int
+read_stream_intervals(struct mux * mux, struct streamlist * sl, struct lex * l)
+{
+    struct stream *stream;
+
+    SLIST_FOREACH(stream, sl, streams) {
+        if (stream->interval == 0) {
+            stream->interval = mux->interval;
+        } else if (stream->interval % mux->interval) {
+            warning("%.200s:%d: interval of stream %.200s(%.200s) is not a multiple of the monitor interval",
+                    l->filename, l->cline, type2str(stream->type), stream->arg);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+/* parse "'monitor' '{' resources '}' ['every' time ] ['batch' number]
+ * 'stream' ['from' host] ['to'] host [port]" */
 int
 read_monitor(struct muxlist * mul, struct lex * l)
 {
@@ -179,26 +352,47 @@ read_monitor(struct muxlist * mul, struct lex * l)
 
     lex_nexttoken(l);
 
-    /* parse [every x seconds]? */
+    /* parse [every x (milli)seconds]? */
     if (l->op == LXT_EVERY) {
+        if (!read_interval(l, &mux->interval))
+            return 0;
+
         lex_nexttoken(l);
+    } else
+        mux->interval = SYMON_DEFAULT_INTERVAL;
 
-        if (l->op == LXT_SECOND) {
-            mux->interval = 1;
-        } else if (l->type == LXY_NUMBER) {
-            mux->interval = l->value;
-            lex_nexttoken(l);
-            if (l->op != LXT_SECONDS) {
-                parse_error(l, "seconds");
-            }
-        } else {
-            parse_error(l, "<number> ");
+    /* streams are measured on ticks of the mux */
+    if (!read_stream_intervals(mux, &mux->sl, l) ||
+        !read_stream_intervals(mux, &mux->wl, l))
+        return 0;
+
+    /* parse [batch x]? */
+    if (l->op == LXT_BATCH) {
+        lex_nexttoken(l);
+
+        if (l->type != LXY_NUMBER) {
+            parse_error(l, "<number>");
             return 0;
         }
 
+        if (l->value < 1 || l->value > SYMON_MAXBATCH) {
+            warning("%.200s:%d: batch size should be between 1 and %d",
+                    l->filename, l->cline, SYMON_MAXBATCH);
+            return 0;
+        }
+
+        if (sizeof(struct symonpacketheader) + l->value *
+            (sizeof(struct symonsampleheader) + bytelen_streamlist(&mux->sl)) >
+            SYMON_MAXPACKET) {
+            warning("%.200s:%d: batch of %d samples does not fit in a packet",
+                    l->filename, l->cline, (int) l->value);
+            return 0;
+        }
+
+        mux->batch = l->value;
         lex_nexttoken(l);
     } else
-        mux->interval = SYMON_DEFAULT_INTERVAL;
+        mux->batch = 1;
 
     /* parse [stream [from <host>] to] */
     if (l->op != LXT_STREAM) {
@@ -264,7 +458,7 @@ read_config_file(struct muxlist *muxlist, char *filename)
             return 0;
         }
         if (mux->interval < SYMON_DEFAULT_INTERVAL) {
-            warning("%.200s: monitoring set to every %d s", l->filename, mux->interval);
+            warning("%.200s: monitoring set to every %d ms", l->filename, mux->interval);
         }
     }
 
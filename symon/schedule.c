@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * The scheduler wakes symon at wall clock times chosen by the caller. These are
+ * translated to absolute CLOCK_MONOTONIC deadlines; time spent taking
+ * measurements does not shift the next deadline, so ticks do not drift. A
+ * timerfd is used to wait for a deadline where the platform offers one.
+ *
+ * Probes can also have symon woken between ticks by an fd that signals an
+ * event, e.g. a psi trigger. Such events are remembered until the caller
+ * clears them, so that an event that arrives with a tick is not lost.
+ */
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "conf.h"
+
+#ifdef HAS_TIMERFD
+#include <sys/timerfd.h>
+#endif
+
+#include "error.h"
+#include "schedule.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+__BEGIN_DECLS
+static int sleep_until(u_int64_t);
+__END_DECLS
+
+static int64_t sched_offset;            /* wall clock - monotonic, usec */
+#ifdef HAS_TIMERFD
+static int sched_fd = -1;
+#endif
+static struct pollfd *sched_poll = NULL;  /* the timer, then watched fds */
+static int *sched_watch = NULL;
+static int *sched_woken = NULL;
+static int sched_nwatch = 0;
+
+u_int64_t sched_late = 0;               /* usec that last tick was late */
+u_int32_t sched_missed = 0;             /* measurements skipped since start */
+
+/*
+ * Sleep until a monotonic deadline or a watched fd signals. Returns SCHED_TICK,
+ * SCHED_WAKE or SCHED_INTR when interrupted by a signal.
+ */
+static int
+sleep_until(u_int64_t deadline)
+{
+#ifdef HAS_TIMERFD
+    struct itimerspec its;
+    u_int64_t expirations;
+#else
+    struct timespec ts;
+    u_int64_t mono;
+#endif
+    int timeout, woken;
+    int i;
+
+    for (i = 0; i < sched_nwatch; i++)
+        if (sched_woken[i])
+            return SCHED_WAKE;
+
+#ifdef HAS_TIMERFD
+    bzero(&its, sizeof(its));
+    its.it_value.tv_sec = deadline / 1000000;
+    its.it_value.tv_nsec = (deadline % 1000000) * 1000;
+
+    /* an it_value of zero would disarm the timer */
+    if (deadline == 0)
+        its.it_value.tv_nsec = 1;
+
+    if (timerfd_settime(sched_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1)
+        fatal("timer setup failed: %.200s", strerror(errno));
+
+    if (sched_nwatch == 0) {
+        if (read(sched_fd, &expirations, sizeof(expirations)) == -1) {
+            if (errno == EINTR)
+                return SCHED_INTR;
+            fatal("timer read failed: %.200s", strerror(errno));
+        }
+        return SCHED_TICK;
+    }
+
+    sched_poll[0].fd = sched_fd;
+    timeout = -1;
+#else
+    mono = clock_usec(CLOCK_MONOTONIC);
+
+    if (sched_nwatch == 0) {
+        if (mono < deadline) {
+            ts.tv_sec = (deadline - mono) / 1000000;
+            ts.tv_nsec = ((deadline - mono) % 1000000) * 1000;
+
+            if (nanosleep(&ts, NULL) == -1) {
+                if (errno == EINTR)
+                    return SCHED_INTR;
+                fatal("sleep failed: %.200s", strerror(errno));
+            }
+        }
+        return SCHED_TICK;
+    }
+
+    /* poll has ms resolution; wake up at or just after the deadline */
+    sched_poll[0].fd = -1;
+    timeout = (mono < deadline) ? (deadline - mono + 999) / 1000 : 0;
+#endif
+
+    sched_poll[0].events = POLLIN;
+    if (poll(sched_poll, sched_nwatch + 1, timeout) == -1) {
+        if (errno == EINTR)
+            return SCHED_INTR;
+        fatal("poll failed: %.200s", strerror(errno));
+    }
+
+    woken = 0;
+    for (i = 0; i < sched_nwatch; i++) {
+        if (sched_poll[i + 1].revents == 0)
+            continue;
+
+        sched_woken[i] = 1;
+        woken = 1;
+
+        /* an fd whose object is gone would signal forever */
+        if (sched_poll[i + 1].revents & (POLLERR | POLLHUP | POLLNVAL))
+            sched_poll[i + 1].fd = -1;
+    }
+
+#ifdef HAS_TIMERFD
+    if (sched_poll[0].revents & POLLIN) {
+        if (read(sched_fd, &expirations, sizeof(expirations)) == -1)
+            fatal("timer read failed: %.200s", strerror(errno));
+        return SCHED_TICK;
+    }
+#else
+    if (clock_usec(CLOCK_MONOTONIC) >= deadline)
+        return SCHED_TICK;
+#endif
+
+    return (woken) ? SCHED_WAKE : SCHED_TICK;
+}
+/* Current wall clock time in ms */
+u_int64_t
+wall_msec(void)
+{
+    return clock_usec(CLOCK_REALTIME) / 1000;
+}
+void
+init_schedule(void)
+{
+#ifdef HAS_TIMERFD
+    if (sched_fd == -1 &&
+        (sched_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)) == -1)
+        fatal("timer setup failed: %.200s", strerror(errno));
+#endif
+
+    sched_offset = (int64_t) clock_usec(CLOCK_REALTIME) -
+        (int64_t) clock_usec(CLOCK_MONOTONIC);
+}
+/* Wake up between ticks when fd signals an event */
+void
+watch_schedule(int fd)
+{
+    int i;
+
+    for (i = 0; i < sched_nwatch; i++)
+        if (sched_watch[i] == fd)
+            return;
+
+    sched_poll = xrealloc(sched_poll, (sched_nwatch + 2) * sizeof(struct pollfd));
+    sched_watch = xrealloc(sched_watch, (sched_nwatch + 1) * sizeof(int));
+    sched_woken = xrealloc(sched_woken, (sched_nwatch + 1) * sizeof(int));
+
+    bzero(&sched_poll[sched_nwatch + 1], sizeof(struct pollfd));
+    sched_poll[sched_nwatch + 1].fd = fd;
+    sched_poll[sched_nwatch + 1].events = POLLPRI;
+    sched_watch[sched_nwatch] = fd;
+    sched_woken[sched_nwatch] = 0;
+    sched_nwatch++;
+}
+/* Stop watching all fds */
+void
+unwatch_schedule(void)
+{
+    sched_nwatch = 0;
+}
+/* Return whether fd signalled an event that was not cleared yet */
+int
+woken_schedule(int fd)
+{
+    int i;
+
+    for (i = 0; i < sched_nwatch; i++)
+        if (sched_watch[i] == fd)
+            return sched_woken[i];
+
+    return 0;
+}
+/* Forget the events of all watched fds */
+void
+clear_schedule(void)
+{
+    int i;
+
+    for (i = 0; i < sched_nwatch; i++)
+        sched_woken[i] = 0;
+}
+/*
+ * Wait until wall clock time tick (ms). Returns SCHED_TICK when the tick was
+ * reached, SCHED_WAKE when a watched fd signalled before, SCHED_INTR when a
+ * signal interrupted the wait and SCHED_STEP when the wall clock was stepped
+ * while waiting.
+ */
+int
+wait_schedule(u_int64_t tick)
+{
+    u_int64_t deadline, mono;
+    int64_t offset;
+    int result;
+
+    deadline = (u_int64_t) ((int64_t) tick * 1000 - sched_offset);
+
+    if ((result = sleep_until(deadline)) != SCHED_TICK)
+        return result;
+
+    mono = clock_usec(CLOCK_MONOTONIC);
+    offset = (int64_t) clock_usec(CLOCK_REALTIME) - (int64_t) mono;
+
+    /* the wall clock was stepped, e.g. by ntpd or the administrator */
+    if (offset > sched_offset + SCHED_MAXSTEP ||
+        offset < sched_offset - SCHED_MAXSTEP) {
+        info("system time changed - realigning measurements");
+        sched_offset = offset;
+        return SCHED_STEP;
+    }
+
+    sched_late = (mono > deadline) ? mono - deadline : 0;
+
+    debug("tick %u.%03u: %u us late", (u_int32_t) (tick / 1000),
+          (u_int32_t) (tick % 1000), (u_int32_t) sched_late);
+
+    return SCHED_TICK;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Timing of symon's own work. Probes run on worker threads, so all updates
+ * are serialised by a single mutex; updates are a handful of additions.
+ */
+#include <sys/types.h>
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+#include "conf.h"
+#include "data.h"
+#include "selfstat.h"
+#include "timing.h"
+
+struct selfstat self_module[MT_EOT];
+struct selfstat self_send;
+struct selfstat self_sched;
+
+static pthread_mutex_t self_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+start_selftimer(struct selftimer * t)
+{
+    t->wall = clock_usec(CLOCK_MONOTONIC);
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    t->cpu = clock_usec(CLOCK_THREAD_CPUTIME_ID);
+#else
+    t->cpu = 0;
+#endif
+}
+/* Account the time since start_selftimer to a selfstat */
+void
+stop_selftimer(struct selftimer * t, struct selfstat * s, int bytes, int errors)
+{
+    u_int64_t wall, cpu;
+
+    wall = clock_usec(CLOCK_MONOTONIC) - t->wall;
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    cpu = clock_usec(CLOCK_THREAD_CPUTIME_ID) - t->cpu;
+#else
+    cpu = 0;
+#endif
+
+    add_selfstat(s, wall, cpu, bytes, errors);
+}
+void
+add_selfstat(struct selfstat * s, u_int64_t wall, u_int64_t cpu, int bytes, int errors)
+{
+    int i;
+
+    i = timing_bucket(wall, SELF_BUCKETS);
+
+    pthread_mutex_lock(&self_mutex);
+    s->calls++;
+    s->wall += wall;
+    s->cpu += cpu;
+    if (wall > s->max)
+        s->max = wall;
+    s->bytes += bytes;
+    s->errors += errors;
+    s->hist[i]++;
+    pthread_mutex_unlock(&self_mutex);
+}
+/* Count errors that did not involve a timed call */
+void
+error_selfstat(struct selfstat * s, int errors)
+{
+    pthread_mutex_lock(&self_mutex);
+    s->errors += errors;
+    pthread_mutex_unlock(&self_mutex);
+}
+/* Copy a selfstat for reporting; the maximum starts over */
+void
+read_selfstat(struct selfstat * s, struct selfstat * copy)
+{
+    pthread_mutex_lock(&self_mutex);
+    bcopy(s, copy, sizeof(struct selfstat));
+    s->max = 0;
+    pthread_mutex_unlock(&self_mutex);
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SYMON_SELFSTAT_H
+#define _SYMON_SELFSTAT_H
+
+#include "data.h"
+
+/*
+ * Cost accounting of symon itself. Every call that is timed ends up in one
+ * selfstat; the duration is counted in a histogram with buckets of
+ * <10us, <100us, <1ms, <10ms, <100ms, <1s and >=1s.
+ */
+#define SELF_BUCKETS 7
+
+struct selfstat {
+    u_int64_t calls;
+    u_int64_t wall;             /* usec */
+    u_int64_t cpu;              /* usec */
+    u_int64_t max;              /* usec, longest call since last report */
+    u_int64_t bytes;
+    u_int64_t errors;
+    u_int64_t hist[SELF_BUCKETS];
+};
+
+struct selftimer {
+    u_int64_t wall;
+    u_int64_t cpu;
+};
+
+extern struct selfstat self_module[MT_EOT];     /* probes, by stream type */
+extern struct selfstat self_send;               /* send_packet */
+extern struct selfstat self_sched;              /* tick lateness */
+
+/* prototypes */
+__BEGIN_DECLS
+void start_selftimer(struct selftimer *);
+void stop_selftimer(struct selftimer *, struct selfstat *, int, int);
+void add_selfstat(struct selfstat *, u_int64_t, u_int64_t, int, int);
+void error_selfstat(struct selfstat *, int);
+void read_selfstat(struct selfstat *, struct selfstat *);
+__END_DECLS
+#endif                          /* _SYMON_SELFSTAT_H */
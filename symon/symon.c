@@ -46,56 +46,85 @@
 
 #include "conf.h"
 #include "data.h"
+#include "discover.h"
 #include "error.h"
 #include "net.h"
+#include "pool.h"
 #include "readconf.h"
+#include "schedule.h"
+#include "selfstat.h"
 #include "symon.h"
 #include "symonnet.h"
+#include "sysroot.h"
+#include "wheel.h"
 #include "xmalloc.h"
 
 __BEGIN_DECLS
-void alarmhandler(int);
 void exithandler(int);
 void huphandler(int);
 void init_streams(struct muxlist *mul);
+void init_timers(struct muxlist *mul);
+void run_timers(void);
+void watch_streams(struct muxlist *mul);
+void send_streams(struct muxlist *mul, u_int64_t t);
 void drop_privileges(int unsecure);
 __END_DECLS
 
 int flag_unsecure = 0;
 int flag_hup = 0;
 int flag_testconf = 0;
-int symon_interval = 0;
+int symon_interval = 0;                 /* ms; resolution of the timer wheel */
+int symon_generation = 0;               /* configurations initialised so far */
 
-/* program wide time_t indicating start of measurement time */
-time_t now;
+/* program wide start of measurement time, in ms since the epoch; always an
+ * interval boundary */
+u_int64_t now;
+
+/* streams are scheduled on a timer wheel that counts in symon_intervals */
+struct wheel wheel;
+struct timer *timers = NULL;
 
 /* map stream types to inits and getters */
+#ifdef HAS_DISCOVERY
+#define DISCOVER(f)     f
+#else
+#define DISCOVER(f)     NULL
+#endif
+
 struct funcmap streamfunc[] = {
-    {MT_IO1, 0, NULL, init_io, gets_io, get_io},
-    {MT_CPU, 0, NULL, init_cpu, gets_cpu, get_cpu},
-    {MT_MEM1, 0, NULL, init_mem, gets_mem, get_mem},
-    {MT_IF1, 0, NULL, init_if, gets_if, get_if},
-    {MT_PF, 0, privinit_pf, init_pf, gets_pf, get_pf},
-    {MT_DEBUG, 0, NULL, init_debug, NULL, get_debug},
-    {MT_PROC, 0, privinit_proc, init_proc, gets_proc, get_proc},
-    {MT_MBUF, 0, NULL, init_mbuf, NULL, get_mbuf},
-    {MT_SENSOR, 0, privinit_sensor, init_sensor, NULL, get_sensor},
-    {MT_IO2, 0, NULL, init_io, gets_io, get_io},
-    {MT_PFQ, 0, privinit_pfq, init_pfq, gets_pfq, get_pfq},
-    {MT_DF, 0, NULL, init_df, gets_df, get_df},
-    {MT_MEM2, 0, NULL, init_mem, gets_mem, get_mem},
-    {MT_IF2, 0, NULL, init_if, gets_if, get_if},
-    {MT_CPUIOW, 0, NULL, init_cpuiow, gets_cpuiow, get_cpuiow},
-    {MT_SMART, 0, NULL, init_smart, gets_smart, get_smart},
-    {MT_LOAD, 0, NULL, init_load, gets_load, get_load},
-    {MT_FLUKSO, 0, NULL, init_flukso, gets_flukso, get_flukso},
-    {MT_EOT, 0, NULL, NULL, NULL, NULL}
+    {MT_IO1, 0, NULL, init_io, gets_io, get_io, DISCOVER(list_io)},
+    {MT_CPU, 0, NULL, init_cpu, gets_cpu, get_cpu, NULL},
+    {MT_MEM1, 0, NULL, init_mem, gets_mem, get_mem, NULL},
+    {MT_IF1, 0, NULL, init_if, gets_if, get_if, DISCOVER(list_if)},
+    {MT_PF, 0, privinit_pf, init_pf, gets_pf, get_pf, NULL},
+    {MT_DEBUG, 0, NULL, init_debug, NULL, get_debug, NULL},
+    {MT_PROC, 0, privinit_proc, init_proc, gets_proc, get_proc, NULL},
+    {MT_MBUF, 0, NULL, init_mbuf, NULL, get_mbuf, NULL},
+    {MT_SENSOR, 0, privinit_sensor, init_sensor, NULL, get_sensor, DISCOVER(list_sensor)},
+    {MT_IO2, 0, NULL, init_io, gets_io, get_io, DISCOVER(list_io)},
+    {MT_PFQ, 0, privinit_pfq, init_pfq, gets_pfq, get_pfq, NULL},
+    {MT_DF, 0, NULL, init_df, gets_df, get_df, DISCOVER(list_df)},
+    {MT_MEM2, 0, NULL, init_mem, gets_mem, get_mem, NULL},
+    {MT_IF2, 0, NULL, init_if, gets_if, get_if, DISCOVER(list_if)},
+    {MT_CPUIOW, 0, NULL, init_cpuiow, gets_cpuiow, get_cpuiow, NULL},
+    {MT_SMART, 0, NULL, init_smart, gets_smart, get_smart, NULL},
+    {MT_LOAD, 0, NULL, init_load, gets_load, get_load, NULL},
+    {MT_FLUKSO, 0, NULL, init_flukso, gets_flukso, get_flukso, NULL},
+    {MT_TEST, 0, NULL, NULL, NULL, NULL, NULL},
+    {MT_SELF, 0, NULL, init_self, NULL, get_self, NULL},
+    {MT_CPUS, 0, NULL, init_cpus, gets_cpus, get_cpus, NULL},
+    {MT_SMART2, 0, NULL, init_smart, gets_smart, get_smart, NULL},
+    {MT_NVME, 0, NULL, init_nvme, gets_nvme, get_nvme, DISCOVER(list_nvme)},
+    {MT_PROC2, 0, privinit_proc, init_proc, gets_proc, get_proc, NULL},
+    {MT_CGROUP, 0, privinit_cgroup, init_cgroup, gets_cgroup, get_cgroup, DISCOVER(list_cgroup)},
+    {MT_PSI, 0, privinit_psi, init_psi, gets_psi, get_psi, DISCOVER(list_psi)},
+    {MT_EOT, 0, NULL, NULL, NULL, NULL, NULL}
 };
 
 void
 init_streams(struct muxlist *mul)
 {
-    struct itimerval alarminterval;
+    struct selftimer timer;
     struct stream *stream;
     struct mux *mux;
 
@@ -104,30 +133,176 @@ init_streams(struct muxlist *mul)
     if ((mul == NULL) || ((mux = SLIST_FIRST(mul)) == NULL))
         fatal("empty mux list");
 
+    symon_generation++;
+
     symon_interval = mux->interval;
 
     SLIST_FOREACH(mux, mul, muxes) {
-        /* determine gcd of alarm times */
+        /* determine gcd of measurement intervals */
         symon_interval = gcd(symon_interval, mux->interval);
 
         /* init network */
-        init_symon_packet(mux);
         connect2mux(mux);
 
         /* init modules */
         SLIST_FOREACH(stream, &mux->sl, streams) {
+            start_selftimer(&timer);
             (streamfunc[stream->type].init) (stream);
+            stop_selftimer(&timer, &self_module[stream->type], 0, 0);
         }
+
+        /* vector streams know their size once initialised */
+        init_symon_packet(mux);
     }
 
-    /* setup alarm */
-    timerclear(&alarminterval.it_interval);
-    timerclear(&alarminterval.it_value);
-    alarminterval.it_interval.tv_sec =
-        alarminterval.it_value.tv_sec = symon_interval;
+    /* expand wildcard streams */
+    init_discovery(mul);
+    discover_streams();
+
+    /* setup probe workers and ticks */
+    init_pool(mul);
+    init_schedule();
+    init_timers(mul);
+    watch_streams(mul);
+}
+/* Schedule all streams at their next interval boundary */
+void
+init_timers(struct muxlist *mul)
+{
+    struct stream *stream;
+    struct mux *mux;
+    u_int64_t unit;
+    int interval;
+    int i;
+
+    if (timers != NULL)
+        xfree(timers);
+
+    i = 0;
+    SLIST_FOREACH(mux, mul, muxes)
+        SLIST_FOREACH(stream, &mux->sl, streams)
+            i++;
 
-    if (setitimer(ITIMER_REAL, &alarminterval, NULL) != 0) {
-        fatal("alarm setup failed: %.200s", strerror(errno));
+    timers = xmalloc(i * sizeof(struct timer));
+
+    unit = wall_msec() / symon_interval;
+    init_wheel(&wheel, unit + 1);
+
+    i = 0;
+    SLIST_FOREACH(mux, mul, muxes) {
+        SLIST_FOREACH(stream, &mux->sl, streams) {
+            interval = stream->interval / symon_interval;
+            stream->due = 0;
+            timers[i].arg = stream;
+            timers[i].due = ((unit / interval) + 1) * interval;
+            add_timer(&wheel, &timers[i]);
+            i++;
+        }
+    }
+}
+/* Let the scheduler wake symon for streams that are measured between ticks */
+void
+watch_streams(struct muxlist *mul)
+{
+    struct stream *stream;
+    struct mux *mux;
+
+    unwatch_schedule();
+
+    SLIST_FOREACH(mux, mul, muxes)
+        SLIST_FOREACH(stream, &mux->sl, streams)
+            if (stream->wakefd != -1)
+                watch_schedule(stream->wakefd);
+}
+/* Send the measurements of the due streams, taken at t (ms) */
+void
+send_streams(struct muxlist *mul, u_int64_t t)
+{
+    struct stream *stream;
+    struct mux *mux;
+    int due;
+
+    /* packets only carry the streams that are due */
+    SLIST_FOREACH(mux, mul, muxes) {
+        due = 0;
+        SLIST_FOREACH(stream, &mux->sl, streams)
+            due |= stream->due;
+
+        if (!due)
+            continue;
+
+        /* a batch that has no room for another full sample is sent early */
+        if (mux->samples > 0 &&
+            mux->packet.size - mux->packet.offset <
+            sizeof(struct symonsampleheader) + bytelen_streamlist(&mux->sl)) {
+            finish_packet(mux);
+
+            send_packet(mux);
+            mux->samples = 0;
+        }
+
+        if (mux->samples == 0)
+            prepare_packet(mux, t);
+
+        prepare_sample(mux, t);
+
+        SLIST_FOREACH(stream, &mux->sl, streams) {
+            if (stream->due) {
+                stream_in_packet(stream, mux);
+                stream->due = 0;
+            }
+        }
+
+        finish_sample(mux);
+
+        /* batching muxes only send every mux->batch samples */
+        if (++mux->samples >= mux->batch) {
+            finish_packet(mux);
+
+            send_packet(mux);
+            mux->samples = 0;
+        }
+    }
+}
+/* Mark the streams that are due at now and schedule their next measurement */
+void
+run_timers(void)
+{
+    struct timerlist expired;
+    struct stream *stream;
+    struct timer *t;
+    u_int64_t current;
+    u_int32_t missed;
+    int interval;
+
+    SLIST_INIT(&expired);
+    run_wheel(&wheel, now / symon_interval, &expired);
+
+    /* measurements that should have been taken while this tick was running
+     * late are skipped */
+    current = (now + (sched_late / 1000)) / symon_interval;
+    missed = 0;
+
+    while ((t = SLIST_FIRST(&expired)) != NULL) {
+        SLIST_REMOVE_HEAD(&expired, timers);
+        stream = (struct stream *) t->arg;
+        stream->due = 1;
+
+        interval = stream->interval / symon_interval;
+        t->due += interval;
+        if (t->due <= current) {
+            missed += (current - t->due) / interval + 1;
+            t->due = ((current / interval) + 1) * interval;
+        }
+        add_timer(&wheel, t);
+    }
+
+    add_selfstat(&self_sched, sched_late, 0, 0, missed);
+
+    if (missed) {
+        warning("measurements running %u ms late - skipping %u measurement(s)",
+                (u_int32_t) (sched_late / 1000), missed);
+        sched_missed += missed;
     }
 }
 void
@@ -166,12 +341,6 @@ drop_privileges(int unsecure)
             fatal("can't set effective user id: %.200s", strerror(errno));
     }
 }
-/* alarmhandler that gets called every symon_interval */
-void
-alarmhandler(int s)
-{
-    /* EMPTY */
-}
 void
 exithandler(int s)
 {
@@ -199,11 +368,14 @@ int
 main(int argc, char *argv[])
 {
     struct muxlist mul, newmul;
+    struct selftimer timer;
     struct stream *stream;
     struct mux *mux;
-    time_t last_update;
     FILE *pidfile;
+    u_int64_t next, t;
     char *cfgpath;
+    int deadline;
+    int result;
     int ch;
     int i;
 
@@ -216,7 +388,7 @@ main(int argc, char *argv[])
 
     cfgpath = SYMON_CONFIG_FILE;
 
-    while ((ch = getopt(argc, argv, "df:tuv")) != -1) {
+    while ((ch = getopt(argc, argv, "df:R:tuv")) != -1) {
         switch (ch) {
         case 'd':
             flag_debug = 1;
@@ -226,6 +398,10 @@ main(int argc, char *argv[])
             cfgpath = xstrdup(optarg);
             break;
 
+        case 'R':
+            set_sysroot(optarg);
+            break;
+
         case 't':
             flag_testconf = 1;
             break;
@@ -238,7 +414,7 @@ main(int argc, char *argv[])
             info("symon version %s", SYMON_VERSION);
 	    /* FALLTHROUGH */
         default:
-            info("usage: %s [-d] [-t] [-u] [-v] [-f cfgfile]", __progname);
+            info("usage: %s [-d] [-t] [-u] [-v] [-f cfgfile] [-R root]", __progname);
             exit(EX_USAGE);
         }
     }
@@ -255,12 +431,19 @@ main(int argc, char *argv[])
         SLIST_FOREACH(stream, &mux->sl, streams) {
             streamfunc[stream->type].used = 1;
         }
+        SLIST_FOREACH(stream, &mux->wl, streams) {
+            streamfunc[stream->type].used = 1;
+        }
     }
 
     /* open resources that might not be available after privilege drop */
-    for (i = 0; i < MT_EOT; i++)
-        if (streamfunc[i].used && (streamfunc[i].privinit != NULL))
+    for (i = 0; i < MT_EOT; i++) {
+        if (streamfunc[i].used && (streamfunc[i].privinit != NULL)) {
+            start_selftimer(&timer);
             (streamfunc[i].privinit) ();
+            stop_selftimer(&timer, &self_module[i], 0, 0);
+        }
+    }
 
     if ((pidfile = fopen(SYMON_PID_FILE, "w")) == NULL)
         warning("could not open \"%.200s\", %.200s", SYMON_PID_FILE,
@@ -289,7 +472,6 @@ main(int argc, char *argv[])
         info("program id=%d", (u_int) getpid());
 
     /* setup signal handlers */
-    signal(SIGALRM, alarmhandler);
     signal(SIGHUP, huphandler);
     signal(SIGINT, exithandler);
     signal(SIGQUIT, exithandler);
@@ -300,10 +482,16 @@ main(int argc, char *argv[])
 
     init_streams(&mul);
 
-    last_update = time(NULL);
     for (;;) {                  /* FOREVER */
-        sleep(symon_interval * 2);      /* alarm will interrupt sleep */
-        now = time(NULL);
+        /* probes may take at most half a tick */
+        deadline = (symon_interval / 2 < SYMON_DEADLINE) ?
+            symon_interval / 2 : SYMON_DEADLINE;
+
+        if (!next_timer(&wheel, &next))
+            fatal("internal error: no streams scheduled");
+
+        now = next * symon_interval;
+        result = wait_schedule(now);
 
         if (flag_hup == 1) {
             flag_hup = 0;
@@ -315,6 +503,7 @@ main(int argc, char *argv[])
                     info("new configuration contains errors; keeping old configuration");
                     free_muxlist(&newmul);
                 } else {
+                    drain_pool();
                     free_muxlist(&mul);
                     mul = newmul;
                     info("read configuration file '%.200s' successfully", cfgpath);
@@ -325,49 +514,37 @@ main(int argc, char *argv[])
             } else {
                 info("configuration unreachable because of privsep; keeping old configuration");
             }
-        } else {
-            /* check timing to catch ntp drifts */
-            if (now < last_update ||
-                now > last_update + symon_interval + symon_interval) {
-                info("last update seems long ago - assuming system time change");
-                last_update = now;
-            } else if (now < last_update + symon_interval) {
-                debug("did not sleep %d seconds - skipping a measurement", symon_interval);
-                continue;
-            }
-            last_update = now;
-
-            /* populate for modules that get all their measurements in one
-             * go. we bunch up calls together to ensure that the measurements
-             * happen "at the same time" */
-            for (i = 0; i < MT_EOT; i++)
-                streamfunc[i].used = 0;
-            SLIST_FOREACH(mux, &mul, muxes) {
-                mux->last += symon_interval;
-                if (mux->last >= mux->interval) {
-                    SLIST_FOREACH(stream, &mux->sl, streams) {
-                        if (streamfunc[stream->type].used == 0) {
-                            streamfunc[stream->type].used = 1;
-                            if (streamfunc[stream->type].gets != NULL)
-                                (streamfunc[stream->type].gets)();
-                        }
-                    }
-                }
-            }
-
-            SLIST_FOREACH(mux, &mul, muxes) {
-                if (mux->last >= mux->interval) {
-                    mux->last = 0;
-                    prepare_packet(mux, now);
-
-                    SLIST_FOREACH(stream, &mux->sl, streams)
-                        stream_in_packet(stream, mux);
-
-                    finish_packet(mux);
-
-                    send_packet(mux);
-                }
+        } else if (result == SCHED_STEP) {
+            init_timers(&mul);
+        } else if (result == SCHED_TICK) {
+            run_timers();
+
+            /* measure all due streams in parallel; streams whose probes do
+             * not finish before the deadline are no longer due */
+            run_pool(&mul, deadline);
+            send_streams(&mul, now);
+
+            /* objects of wildcard streams come and go */
+            if (discover_streams()) {
+                init_pool(&mul);
+                init_timers(&mul);
+                watch_streams(&mul);
             }
+        } else if (result == SCHED_WAKE) {
+            /* a stream whose trigger fired is measured right away, in a
+             * sample of its own. Its timestamp must not be that of a tick. */
+            t = wall_msec();
+            if ((t % symon_interval) == 0)
+                t++;
+
+            SLIST_FOREACH(mux, &mul, muxes)
+                SLIST_FOREACH(stream, &mux->sl, streams)
+                    if (stream->wakefd != -1 && woken_schedule(stream->wakefd))
+                        stream->due = 1;
+            clear_schedule();
+
+            run_pool(&mul, deadline);
+            send_streams(&mul, t);
         }
     }
 
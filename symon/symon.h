@@ -35,7 +35,10 @@
 #include "data.h"
 
 #define SYMON_PID_FILE "/var/run/symon.pid"
-#define SYMON_DEFAULT_INTERVAL 5        /* measurement interval */
+#define SYMON_DEFAULT_INTERVAL 5000     /* measurement interval (ms) */
+#define SYMON_MININTERVAL 10            /* shortest measurement interval (ms) */
+#define SYMON_WORKERS 4                 /* probe worker threads */
+#define SYMON_DEADLINE 1000             /* longest time probes may take (ms) */
 
 /* funcmap holds functions to be called for the individual monitors:
  *
@@ -44,6 +47,8 @@
  * - gets     = called every monitor interval, can be used by modules that get
  *              all their measurements in one go.
  * - get      = obtain measurement
+ * - list     = call back with the name of every object the module measures,
+ *              used to expand wildcard streams
  */
 struct funcmap {
     int type;
@@ -52,11 +57,13 @@ struct funcmap {
     void (*init) (struct stream *);
     void (*gets) (void);
     int (*get) (char *, int, struct stream *);
+    void (*list) (void (*) (char *, void *), void *);
 };
 extern struct funcmap streamfunc[];
 
 extern int symon_interval;
-extern time_t now;
+extern int symon_generation;
+extern u_int64_t now;
 
 /* prototypes */
 __BEGIN_DECLS
@@ -79,11 +86,13 @@ extern int get_mem(char *, int, struct stream *);
 extern void init_if(struct stream *);
 extern void gets_if(void);
 extern int get_if(char *, int, struct stream *);
+extern void list_if(void (*) (char *, void *), void *);
 
 /* sm_io.c */
 extern void init_io(struct stream *);
 extern void gets_io(void);
 extern int get_io(char *, int, struct stream *);
+extern void list_io(void (*) (char *, void *), void *);
 
 /* sm_pf.c */
 extern void privinit_pf(void);
@@ -115,11 +124,13 @@ extern int get_proc(char *, int, struct stream *);
 extern void privinit_sensor(void);
 extern void init_sensor(struct stream *);
 extern int get_sensor(char *, int, struct stream *);
+extern void list_sensor(void (*) (char *, void *), void *);
 
 /* sm_df.c */
 extern void init_df(struct stream *);
 extern void gets_df(void);
 extern int get_df(char *, int, struct stream *);
+extern void list_df(void (*) (char *, void *), void *);
 
 /* sm_smart.c */
 extern void init_smart(struct stream *);
@@ -136,6 +147,35 @@ void init_flukso(struct stream *);
 void gets_flukso(void);
 int get_flukso(char *, int, struct stream *);
 
+/* sm_self.c */
+extern void init_self(struct stream *);
+extern int get_self(char *, int, struct stream *);
+
+/* sm_cpus.c */
+extern void init_cpus(struct stream *);
+extern void gets_cpus(void);
+extern int get_cpus(char *, int, struct stream *);
+
+/* sm_nvme.c */
+extern void init_nvme(struct stream *);
+extern void gets_nvme(void);
+extern int get_nvme(char *, int, struct stream *);
+extern void list_nvme(void (*) (char *, void *), void *);
+
+/* sm_cgroup.c */
+extern void privinit_cgroup(void);
+extern void init_cgroup(struct stream *);
+extern void gets_cgroup(void);
+extern int get_cgroup(char *, int, struct stream *);
+extern void list_cgroup(void (*) (char *, void *), void *);
+
+/* sm_psi.c */
+extern void privinit_psi(void);
+extern void init_psi(struct stream *);
+extern void gets_psi(void);
+extern int get_psi(char *, int, struct stream *);
+extern void list_psi(void (*) (char *, void *), void *);
+
 __END_DECLS
 
 #endif                          /* _SYMON_SYMON_H */
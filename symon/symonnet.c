@@ -41,6 +41,7 @@
 #include "error.h"
 #include "data.h"
 #include "symon.h"
+#include "selfstat.h"
 #include "net.h"
 
 /* Fill a mux structure with inet details */
@@ -70,12 +71,18 @@ connect2mux(struct mux * mux)
 void
 send_packet(struct mux * mux)
 {
+    struct selftimer timer;
+    int error = 0;
+
+    start_selftimer(&timer);
     if (sendto(mux->symuxsocket, mux->packet.data,
                mux->packet.offset, 0, (struct sockaddr *) & mux->sockaddr,
                SS_LEN(&mux->sockaddr))
         != mux->packet.offset) {
         mux->senderr++;
+        error = 1;
     }
+    stop_selftimer(&timer, &self_send, error ? 0 : mux->packet.offset, error);
 
     if (mux->senderr >= SYMON_WARN_SENDERR) {
         warning("%d updates to mux(%.200s) lost due to send errors",
@@ -85,26 +92,70 @@ send_packet(struct mux * mux)
 }
 /* Prepare a packet for data */
 void
-prepare_packet(struct mux * mux, time_t t)
+prepare_packet(struct mux * mux, u_int64_t t)
 {
     bzero(mux->packet.data, mux->packet.size);
-    mux->packet.header.symon_version = SYMON_PACKET_VER;
-    mux->packet.header.timestamp = t;
+
+    /* only batching and sub-second muxes, and samples taken between ticks,
+     * need the version 3 format with its ms timestamps; older symuxes can
+     * continue to receive data from other symons */
+    if (mux->batch > 1 || (mux->interval % 1000) != 0 || (t % 1000) != 0) {
+        mux->packet.header.symon_version = SYMON_PACKET_VER3;
+        mux->packet.header.timestamp = t;
+    } else {
+        mux->packet.header.symon_version = SYMON_PACKET_VER2;
+        mux->packet.header.timestamp = t / 1000;
+    }
 
     /* symonpacketheader is always first stream */
     mux->packet.offset =
         setheader(mux->packet.data,
                   &mux->packet.header);
 }
-/* Put a stream into the packet for a mux */
+/* Start a new sample in the packet of a mux */
 void
-stream_in_packet(struct stream * stream, struct mux * mux)
+prepare_sample(struct mux * mux, u_int64_t t)
 {
+    struct symonsampleheader sh;
+
+    if (mux->packet.header.symon_version < SYMON_PACKET_VER3)
+        return;
+
+    sh.offset = t - mux->packet.header.timestamp;
+    sh.length = 0;
+
+    mux->packet.sample = mux->packet.offset;
     mux->packet.offset +=
-        (streamfunc[stream->type].get)      /* call getter of stream */
-        (mux->packet.data + mux->packet.offset,    /* packet buffer */
-         mux->packet.size - mux->packet.offset,    /* maxlen */
-         stream);
+        setsampleheader(mux->packet.data + mux->packet.offset, &sh);
+}
+/* Close the current sample; set its length */
+void
+finish_sample(struct mux * mux)
+{
+    struct symonsampleheader sh;
+
+    if (mux->packet.header.symon_version < SYMON_PACKET_VER3)
+        return;
+
+    getsampleheader(mux->packet.data + mux->packet.sample, &sh);
+    sh.length = mux->packet.offset - mux->packet.sample;
+    setsampleheader(mux->packet.data + mux->packet.sample, &sh);
+}
+/* Put the measurement of a stream into the packet for a mux */
+void
+stream_in_packet(struct stream * stream, struct mux * mux)
+{
+    if (stream->plen <= 0)
+        return;
+
+    if ((u_int32_t) stream->plen > (mux->packet.size - mux->packet.offset)) {
+        warning("%s:%d: no room in packet for %.200s(%.200s)",
+                __FILE__, __LINE__, type2str(stream->type), stream->arg);
+        return;
+    }
+
+    bcopy(stream->pbuf, mux->packet.data + mux->packet.offset, stream->plen);
+    mux->packet.offset += stream->plen;
 }
 /* Ready a packet for transmission, set length and crc */
 void
@@ -37,7 +37,9 @@
 __BEGIN_DECLS
 void connect2mux(struct mux *);
 void send_packet(struct mux *);
-void prepare_packet(struct mux *, time_t t);
+void prepare_packet(struct mux *, u_int64_t t);
+void prepare_sample(struct mux *, u_int64_t t);
+void finish_sample(struct mux *);
 void stream_in_packet(struct stream *, struct mux *);
 void finish_packet(struct mux *);
 __END_DECLS
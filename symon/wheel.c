@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Timer wheel that decides which streams are due. Adding a timer and running
+ * a unit are O(1); runs skip over stretches of time that have no timers.
+ */
+#include <sys/types.h>
+#include <sys/queue.h>
+
+#include <string.h>
+
+#include "conf.h"
+#include "wheel.h"
+
+__BEGIN_DECLS
+static void cascade(struct wheel *, int);
+__END_DECLS
+
+/* Move the timers of the current slot of a level to lower levels */
+static void
+cascade(struct wheel * w, int level)
+{
+    struct timerlist *slot;
+    struct timer *t;
+
+    slot = &w->slot[level][(w->now >> (level * WHEEL_BITS)) & WHEEL_MASK];
+
+    while ((t = SLIST_FIRST(slot)) != NULL) {
+        SLIST_REMOVE_HEAD(slot, timers);
+        w->count[level]--;
+        add_timer(w, t);
+    }
+}
+void
+init_wheel(struct wheel * w, u_int64_t now)
+{
+    int i, j;
+
+    bzero(w, sizeof(struct wheel));
+    w->now = now;
+
+    for (i = 0; i < WHEEL_LEVELS; i++)
+        for (j = 0; j < WHEEL_SIZE; j++)
+            SLIST_INIT(&w->slot[i][j]);
+}
+/* Schedule a timer; timers that are due in the past expire in the next run */
+void
+add_timer(struct wheel * w, struct timer * t)
+{
+    u_int64_t at, delta;
+    int level;
+
+    at = (t->due < w->now) ? w->now : t->due;
+    delta = at - w->now;
+
+    for (level = 0; level < (WHEEL_LEVELS - 1); level++)
+        if (delta < ((u_int64_t) 1 << ((level + 1) * WHEEL_BITS)))
+            break;
+
+    t->level = level;
+    w->count[level]++;
+    SLIST_INSERT_HEAD(&w->slot[level][(at >> (level * WHEEL_BITS)) & WHEEL_MASK],
+                      t, timers);
+}
+/* Find the unit that the first timer expires in; returns 0 if there is none */
+int
+next_timer(struct wheel * w, u_int64_t * due)
+{
+    struct timerlist *slot;
+    struct timer *t;
+    int found;
+    int level;
+    int i;
+
+    found = 0;
+
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        if (w->count[level] == 0)
+            continue;
+
+        /* slots of higher levels hold a range of units; the first slot with
+         * timers holds the earliest of that level. The current slot of a
+         * higher level can hold timers that are yet to be cascaded as well as
+         * timers that are a full turn away. */
+        for (i = 0; i < WHEEL_SIZE; i++) {
+            slot = &w->slot[level][((w->now >> (level * WHEEL_BITS)) + i) & WHEEL_MASK];
+
+            if (SLIST_EMPTY(slot))
+                continue;
+
+            SLIST_FOREACH(t, slot, timers) {
+                if (!found || t->due < *due) {
+                    *due = t->due;
+                    found = 1;
+                }
+            }
+
+            if (level == 0 || i > 0)
+                break;
+        }
+    }
+
+    return found;
+}
+/* Run the wheel up to and including unit now; expired timers are moved to the
+ * expired list */
+void
+run_wheel(struct wheel * w, u_int64_t now, struct timerlist * expired)
+{
+    struct timerlist *slot;
+    struct timer *t;
+    u_int64_t step;
+    int level;
+
+    while (w->now <= now) {
+        /* pull down timers of higher levels that are now within reach */
+        for (level = 1; level < WHEEL_LEVELS; level++) {
+            if ((w->now & (((u_int64_t) 1 << (level * WHEEL_BITS)) - 1)) != 0)
+                break;
+            cascade(w, level);
+        }
+
+        slot = &w->slot[0][w->now & WHEEL_MASK];
+        while ((t = SLIST_FIRST(slot)) != NULL) {
+            SLIST_REMOVE_HEAD(slot, timers);
+            w->count[0]--;
+            SLIST_INSERT_HEAD(expired, t, timers);
+        }
+
+        /* skip ahead to the next boundary of the lowest level with timers */
+        step = 1;
+        for (level = 0; level < (WHEEL_LEVELS - 1) && w->count[level] == 0; level++)
+            step <<= WHEEL_BITS;
+
+        w->now = (w->now & ~(step - 1)) + step;
+        if (w->now > now + 1)
+            w->now = now + 1;
+    }
+}
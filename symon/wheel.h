@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SYMON_WHEEL_H
+#define _SYMON_WHEEL_H
+
+#include <sys/queue.h>
+
+#include "data.h"
+
+/*
+ * Hierarchical timer wheel. Time is counted in units; level 0 holds timers
+ * that expire within WHEEL_SIZE units, every next level covers WHEEL_SIZE
+ * times the span of the previous one. Timers cascade down a level when their
+ * slot comes within reach. With 5 levels of 64 slots the wheel spans 2^30
+ * units.
+ */
+#define WHEEL_BITS   6
+#define WHEEL_SIZE   (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 5
+
+struct timer {
+    u_int64_t due;              /* unit the timer expires in */
+    int level;
+    void *arg;
+    SLIST_ENTRY(timer) timers;
+};
+SLIST_HEAD(timerlist, timer);
+
+struct wheel {
+    u_int64_t now;              /* first unit that has not been run */
+    int count[WHEEL_LEVELS];
+    struct timerlist slot[WHEEL_LEVELS][WHEEL_SIZE];
+};
+
+/* prototypes */
+__BEGIN_DECLS
+void init_wheel(struct wheel *, u_int64_t);
+void add_timer(struct wheel *, struct timer *);
+int next_timer(struct wheel *, u_int64_t *);
+void run_wheel(struct wheel *, u_int64_t, struct timerlist *);
+__END_DECLS
+#endif                          /* _SYMON_WHEEL_H */
@@ -312,6 +312,72 @@ smart_*.rrd)
         DS:freefall:GAUGE:$INTERVAL:U:U
     ;;
 
+smart2_*.rrd)
+    # Build smart files with data age
+    create_rrd $i \
+        DS:read_error_rate:GAUGE:$INTERVAL:U:U \
+        DS:realloc_sectors:GAUGE:$INTERVAL:U:U \
+        DS:spin_retries:GAUGE:$INTERVAL:U:U \
+        DS:air_flow_temp:GAUGE:$INTERVAL:U:U \
+        DS:temperature:GAUGE:$INTERVAL:U:U \
+        DS:realloc:GAUGE:$INTERVAL:U:U \
+        DS:cur_pending:GAUGE:$INTERVAL:U:U \
+        DS:uncorr:GAUGE:$INTERVAL:U:U \
+        DS:sread_error_rate:GAUGE:$INTERVAL:U:U \
+        DS:gsense_error_rate:GAUGE:$INTERVAL:U:U \
+        DS:temperature2:GAUGE:$INTERVAL:U:U \
+        DS:freefall:GAUGE:$INTERVAL:U:U \
+        DS:age:GAUGE:$INTERVAL:0:U
+    ;;
+
+nvme_*.rrd)
+    # Build nvme health files
+    create_rrd $i \
+        DS:critical_warning:GAUGE:$INTERVAL:0:255 \
+        DS:temperature:GAUGE:$INTERVAL:U:U \
+        DS:avail_spare:GAUGE:$INTERVAL:0:100 \
+        DS:pct_used:GAUGE:$INTERVAL:0:255 \
+        DS:rbytes:COUNTER:$INTERVAL:U:U \
+        DS:wbytes:COUNTER:$INTERVAL:U:U \
+        DS:power_cycles:GAUGE:$INTERVAL:0:U \
+        DS:power_on_hours:GAUGE:$INTERVAL:0:U \
+        DS:unsafe_shutdowns:GAUGE:$INTERVAL:0:U \
+        DS:media_errors:GAUGE:$INTERVAL:0:U \
+        DS:error_log_entries:GAUGE:$INTERVAL:0:U
+    ;;
+
+cgroup.rrd|cgroup_*.rrd)
+    # Build cgroup files
+    create_rrd $i \
+        DS:cpu_usage:COUNTER:$INTERVAL:U:U \
+        DS:cpu_user:COUNTER:$INTERVAL:U:U \
+        DS:cpu_system:COUNTER:$INTERVAL:U:U \
+        DS:nr_throttled:COUNTER:$INTERVAL:U:U \
+        DS:throttled:COUNTER:$INTERVAL:U:U \
+        DS:mem_current:GAUGE:$INTERVAL:0:U \
+        DS:mem_anon:GAUGE:$INTERVAL:0:U \
+        DS:mem_file:GAUGE:$INTERVAL:0:U \
+        DS:pgmajfault:COUNTER:$INTERVAL:U:U \
+        DS:rbytes:COUNTER:$INTERVAL:U:U \
+        DS:wbytes:COUNTER:$INTERVAL:U:U \
+        DS:rios:COUNTER:$INTERVAL:U:U \
+        DS:wios:COUNTER:$INTERVAL:U:U \
+        DS:pids:GAUGE:$INTERVAL:0:U
+    ;;
+
+psi_*.rrd)
+    # Build pressure stall files
+    create_rrd $i \
+        DS:some10:GAUGE:$INTERVAL:0:100 \
+        DS:some60:GAUGE:$INTERVAL:0:100 \
+        DS:some300:GAUGE:$INTERVAL:0:100 \
+        DS:some:COUNTER:$INTERVAL:U:U \
+        DS:full10:GAUGE:$INTERVAL:0:100 \
+        DS:full60:GAUGE:$INTERVAL:0:100 \
+        DS:full300:GAUGE:$INTERVAL:0:100 \
+        DS:full:COUNTER:$INTERVAL:U:U
+    ;;
+
 load.rrd)
     # Build load file
     create_rrd $i \
@@ -326,6 +392,24 @@ flukso_*.rrd)
         DS:watts:GAUGE:$INTERVAL:0:U
     ;;
 
+self.rrd|self_*.rrd)
+    # Build the self file
+    create_rrd $i \
+        DS:calls:COUNTER:$INTERVAL:U:U \
+        DS:wall:COUNTER:$INTERVAL:U:U \
+        DS:cpu:COUNTER:$INTERVAL:U:U \
+        DS:max:GAUGE:$INTERVAL:0:U \
+        DS:bytes:COUNTER:$INTERVAL:U:U \
+        DS:errors:COUNTER:$INTERVAL:U:U \
+        DS:h10us:COUNTER:$INTERVAL:U:U \
+        DS:h100us:COUNTER:$INTERVAL:U:U \
+        DS:h1ms:COUNTER:$INTERVAL:U:U \
+        DS:h10ms:COUNTER:$INTERVAL:U:U \
+        DS:h100ms:COUNTER:$INTERVAL:U:U \
+        DS:h1s:COUNTER:$INTERVAL:U:U \
+        DS:hslow:COUNTER:$INTERVAL:U:U
+    ;;
+
 "done")
     # ignore
     ;;
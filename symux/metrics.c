@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Metrics of symux itself: ingest rate, dropped packets, decode and rrd
+ * update latency and client fan-out. symux receives, stores and distributes
+ * on a single thread and clients are separate processes that only read the
+ * shared region, so the counters are owned by the master and need no locks.
+ *
+ * Every 'metrics every' seconds the metrics are offered to clients as a line
+ * of the synthetic source 'symux' and written to self_<name>.rrd files in
+ * the metrics datadir, if these exist.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "conf.h"
+#include "data.h"
+#include "error.h"
+#include "metrics.h"
+#include "readconf.h"
+#include "share.h"
+#include "symux.h"
+#include "timing.h"
+#include "xmalloc.h"
+
+/* A metrics report under construction in the shared region */
+struct metricreport {
+    char *buf;
+    long maxlen;
+    long used;
+    int slot;
+};
+
+__BEGIN_DECLS
+static void set_metric_file(struct metric *, char *, int);
+static int metric2strn(struct metric *, time_t, char *, int);
+static struct metric *find_metric(char *);
+static void report_metric(struct metric *, time_t, struct metricreport *);
+__END_DECLS
+
+#define METRICS_SOURCE "symux"
+
+struct metric metric_packet;
+struct metric metric_unknown;
+struct metric metric_crc;
+struct metric metric_reject;
+struct metric metric_rrd;
+struct metric metric_client;
+
+static struct metriclist sourcemetrics = SLIST_HEAD_INITIALIZER(sourcemetrics);
+static time_t metrics_next;
+
+/* Determine the rrd of a metric in dir; only existing files are written */
+static void
+set_metric_file(struct metric * m, char *dir, int filecheck)
+{
+    char path[_POSIX2_LINE_MAX];
+    int pc;
+    int fd;
+
+    if (m->file != NULL) {
+        xfree(m->file);
+        m->file = NULL;
+    }
+
+    if (dir == NULL)
+        return;
+
+    strncpy(&path[0], dir, _POSIX2_LINE_MAX);
+    path[_POSIX2_LINE_MAX - 1] = '\0';
+    pc = strlen(path);
+
+    if (!insert_filename(&path[pc], _POSIX2_LINE_MAX - pc, MT_SELF, m->name)) {
+        warning("failed to construct metrics filename for self(%.200s)", m->name);
+        return;
+    }
+
+    if (filecheck) {
+        if ((fd = open(path, O_RDWR | O_NONBLOCK, 0)) == -1) {
+            /* warn, but allow */
+            warning("metrics file '%.200s' cannot be opened", path);
+            return;
+        }
+        close(fd);
+    }
+
+    m->file = xstrdup(path);
+}
+static struct metric *
+find_metric(char *name)
+{
+    struct metric *m;
+
+    SLIST_FOREACH(m, &sourcemetrics, metrics)
+        if (strcmp(m->name, name) == 0)
+            return m;
+
+    return NULL;
+}
+/* Attach metrics to the sources of a new configuration; sources that remain
+ * keep their counters */
+void
+init_metrics(struct mux * mux, int filecheck)
+{
+    char name[SYMON_PS_ARGLENV2];
+    struct metric *m, *nm;
+    struct source *source;
+    size_t i;
+
+    metric_packet.name = "packet";
+    metric_unknown.name = "unknown";
+    metric_crc.name = "crc";
+    metric_reject.name = "reject";
+    metric_rrd.name = "rrd";
+    metric_client.name = "client";
+
+    SLIST_FOREACH(m, &sourcemetrics, metrics)
+        m->used = 0;
+
+    SLIST_FOREACH(source, &mux->sol, sources) {
+        /* a ':' would split the client line */
+        strncpy(&name[0], source->addr, sizeof(name));
+        name[sizeof(name) - 1] = '\0';
+        for (i = 0; i < strlen(name); i++)
+            if (name[i] == ':')
+                name[i] = '_';
+
+        if ((m = find_metric(name)) == NULL) {
+            m = (struct metric *) xmalloc(sizeof(struct metric));
+            bzero(m, sizeof(struct metric));
+            m->name = xstrdup(name);
+            SLIST_INSERT_HEAD(&sourcemetrics, m, metrics);
+        }
+        m->used = 1;
+        source->metric = m;
+    }
+
+    /* forget sources that are no longer configured */
+    m = SLIST_FIRST(&sourcemetrics);
+    while (m) {
+        nm = SLIST_NEXT(m, metrics);
+        if (!m->used) {
+            SLIST_REMOVE(&sourcemetrics, m, metric, metrics);
+            if (m->file != NULL)
+                xfree(m->file);
+            xfree(m->name);
+            xfree(m);
+        }
+        m = nm;
+    }
+
+    set_metric_file(&metric_packet, mux->metricsdir, filecheck);
+    set_metric_file(&metric_unknown, mux->metricsdir, filecheck);
+    set_metric_file(&metric_crc, mux->metricsdir, filecheck);
+    set_metric_file(&metric_reject, mux->metricsdir, filecheck);
+    set_metric_file(&metric_rrd, mux->metricsdir, filecheck);
+    set_metric_file(&metric_client, mux->metricsdir, filecheck);
+    SLIST_FOREACH(m, &sourcemetrics, metrics)
+        set_metric_file(m, mux->metricsdir, filecheck);
+
+    if (mux->metrics) {
+        metrics_next = ((time(NULL) / mux->metrics) + 1) * mux->metrics;
+        info("reporting metrics every %d seconds", mux->metrics);
+    }
+}
+void
+start_metric(struct metrictimer * t)
+{
+    t->wall = clock_usec(CLOCK_MONOTONIC);
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+    t->cpu = clock_usec(CLOCK_PROCESS_CPUTIME_ID);
+#else
+    t->cpu = 0;
+#endif
+}
+/* Account the time since start_metric as a call of metric m */
+void
+stop_metric(struct metrictimer * t, struct metric * m, int bytes, int errors)
+{
+    u_int64_t wall, cpu;
+    int i;
+
+    if (m == NULL)
+        return;
+
+    wall = clock_usec(CLOCK_MONOTONIC) - t->wall;
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+    cpu = clock_usec(CLOCK_PROCESS_CPUTIME_ID) - t->cpu;
+#else
+    cpu = 0;
+#endif
+
+    i = timing_bucket(wall, METRIC_BUCKETS);
+
+    m->calls++;
+    m->wall += wall;
+    m->cpu += cpu;
+    if (wall > m->max)
+        m->max = wall;
+    m->bytes += bytes;
+    m->errors += errors;
+    m->hist[i]++;
+}
+/* Count untimed events */
+void
+count_metric(struct metric * m, int calls, int bytes, int errors)
+{
+    if (m == NULL)
+        return;
+
+    m->calls += calls;
+    m->bytes += bytes;
+    m->errors += errors;
+}
+/* Seconds until the next metrics report, -1 if metrics are not reported */
+int
+metrics_wait(struct mux * mux)
+{
+    time_t now;
+
+    if (mux->metrics == 0)
+        return -1;
+
+    now = time(NULL);
+
+    return (metrics_next > now) ? (metrics_next - now) : 0;
+}
+/* Render a metric as 'self:<name>:<timestamp>:<values>;' and write its rrd */
+static int
+metric2strn(struct metric * m, time_t t, char *buf, int maxlen)
+{
+    struct packedstream ps;
+    int start;
+    int len;
+    int i;
+
+    bzero(&ps, sizeof(struct packedstream));
+    ps.type = MT_SELF;
+    ps.data.ps_self.calls = m->calls;
+    ps.data.ps_self.wall = m->wall;
+    ps.data.ps_self.cpu = m->cpu;
+    ps.data.ps_self.max = m->max;
+    ps.data.ps_self.bytes = m->bytes;
+    ps.data.ps_self.errors = m->errors;
+    for (i = 0; i < METRIC_BUCKETS; i++)
+        ps.data.ps_self.hist[i] = m->hist[i];
+    m->max = 0;
+
+    start = snprintf(buf, maxlen, "%s:%s:", type2str(MT_SELF), m->name);
+    if (start < 0 || start >= maxlen)
+        return 0;
+
+    len = start + snprintf(buf + start, maxlen - start, "%u", (unsigned int) t);
+    if (len >= maxlen)
+        return 0;
+
+    if (ps2strn(&ps, buf + len, maxlen - len, PS2STR_RRD) == 0)
+        return 0;
+    len += strlen(buf + len);
+
+    if (m->file != NULL)
+        update_rrd(m->file, buf + start);
+
+    if (len + 1 >= maxlen)
+        return 0;
+    buf[len++] = ';';
+    buf[len] = '\0';
+
+    return len;
+}
+/* Append a metric to the report in the shared region; a report that does not
+ * fit a single slot continues on a new line in the next slot */
+static void
+report_metric(struct metric * m, time_t t, struct metricreport * r)
+{
+    char entry[_POSIX2_LINE_MAX];
+    int len;
+
+    if ((len = metric2strn(m, t, entry, sizeof(entry))) == 0)
+        return;
+
+    if (r->used + len + 1 >= r->maxlen) {
+        r->used += snprintf(r->buf + r->used, r->maxlen - r->used, "\n");
+        shared_setlen(r->slot, r->used);
+        master_permitread();
+
+        r->slot = master_forbidread();
+        r->buf = shared_getmem(r->slot);
+        r->used = snprintf(r->buf, r->maxlen, "%s;", METRICS_SOURCE);
+    }
+
+    if (r->used + len + 1 < r->maxlen) {
+        bcopy(entry, r->buf + r->used, len + 1);
+        r->used += len;
+    }
+}
+/* Offer the metrics to clients and write them to their rrds, when due */
+void
+report_metrics(struct mux * mux)
+{
+    struct metricreport r;
+    struct metric *m;
+    time_t now;
+
+    if (mux->metrics == 0 || (now = time(NULL)) < metrics_next)
+        return;
+
+    metrics_next = ((now / mux->metrics) + 1) * mux->metrics;
+
+    r.maxlen = shared_getmaxlen();
+    r.slot = master_forbidread();
+    r.buf = shared_getmem(r.slot);
+    r.used = snprintf(r.buf, r.maxlen, "%s;", METRICS_SOURCE);
+
+    report_metric(&metric_packet, now, &r);
+    report_metric(&metric_unknown, now, &r);
+    report_metric(&metric_crc, now, &r);
+    report_metric(&metric_reject, now, &r);
+    report_metric(&metric_rrd, now, &r);
+    report_metric(&metric_client, now, &r);
+    SLIST_FOREACH(m, &sourcemetrics, metrics)
+        report_metric(m, now, &r);
+
+    r.used += snprintf(r.buf + r.used, r.maxlen - r.used, "\n");
+    shared_setlen(r.slot, r.used);
+    master_permitread();
+}
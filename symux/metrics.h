@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _SYMUX_METRICS_H
+#define _SYMUX_METRICS_H
+
+#include "data.h"
+
+/*
+ * Metrics of symux itself. Each metric is reported as a self stream of the
+ * synthetic source 'symux'; durations are counted in a histogram with buckets
+ * of <10us, <100us, <1ms, <10ms, <100ms, <1s and >=1s.
+ */
+#define METRIC_BUCKETS 7
+
+struct metric {
+    char *name;                 /* argument of the self stream */
+    char *file;                 /* rrd, NULL if not written */
+    int used;                   /* refers to a configured source */
+    u_int64_t calls;
+    u_int64_t wall;             /* usec */
+    u_int64_t cpu;              /* usec */
+    u_int64_t max;              /* usec, longest call since last report */
+    u_int64_t bytes;
+    u_int64_t errors;
+    u_int64_t hist[METRIC_BUCKETS];
+    SLIST_ENTRY(metric) metrics;
+};
+SLIST_HEAD(metriclist, metric);
+
+struct metrictimer {
+    u_int64_t wall;
+    u_int64_t cpu;
+};
+
+extern struct metric metric_packet;     /* accepted packets */
+extern struct metric metric_unknown;    /* packets from unknown sources */
+extern struct metric metric_crc;        /* packets with a bad crc */
+extern struct metric metric_reject;     /* packets of unsupported versions */
+extern struct metric metric_rrd;        /* rrd updates */
+extern struct metric metric_client;     /* client fan-out */
+
+/* prototypes */
+__BEGIN_DECLS
+void init_metrics(struct mux *, int);
+void start_metric(struct metrictimer *);
+void stop_metric(struct metrictimer *, struct metric *, int, int);
+void count_metric(struct metric *, int, int, int);
+int metrics_wait(struct mux *);
+void report_metrics(struct mux *);
+__END_DECLS
+#endif                          /* _SYMUX_METRICS_H */
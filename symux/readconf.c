@@ -40,12 +40,14 @@
 #include "lex.h"
 #include "net.h"
 #include "readconf.h"
+#include "rrdcreate.h"
+#include "symux.h"
 #include "xmalloc.h"
 
 __BEGIN_DECLS
 int read_mux(struct muxlist * mul, struct lex *);
 int read_source(struct sourcelist * sol, struct lex *, int);
-int insert_filename(char *, int, int, char *);
+int read_metrics(struct lex *, int *, char **, int);
 __END_DECLS
 
 const char *default_symux_port = SYMUX_PORT;
@@ -108,7 +110,8 @@ insert_filename(char *path, int maxlen, int type, char *args)
         ts = "debug";
         ta = "";
         break;
-    case MT_PROC:
+    case MT_PROC: /* rrd stores 64bits, proc and proc2 are equivalent */
+    case MT_PROC2:
         ts = "proc_";
         ta = args;
         break;
@@ -120,6 +123,22 @@ insert_filename(char *path, int maxlen, int type, char *args)
         ts = "smart_";
         ta = args;
         break;
+    case MT_SMART2:
+        ts = "smart2_";
+        ta = args;
+        break;
+    case MT_NVME:
+        ts = "nvme_";
+        ta = args;
+        break;
+    case MT_CGROUP:
+        ts = (args[0] == '\0') ? "cgroup" : "cgroup_";
+        ta = args;
+        break;
+    case MT_PSI:
+        ts = "psi_";
+        ta = args;
+        break;
     case MT_LOAD:
         ts = "load";
         ta = "";
@@ -128,6 +147,14 @@ insert_filename(char *path, int maxlen, int type, char *args)
         ts = "flukso_";
         ta = args;
         break;
+    case MT_SELF:
+        ts = (args[0] == '\0') ? "self" : "self_";
+        ta = args;
+        break;
+    case MT_TEST:
+        ts = "test_";
+        ta = args;
+        break;
 
     default:
         warning("%.200s:%d: internal error: type (%d) unknown",
@@ -195,7 +222,8 @@ read_mux(struct muxlist * mul, struct lex * l)
 
     return 1;
 }
-/* parse "'source' host '{' accept-stmst [write-stmts] [datadir-stmts] '}'" */
+/* parse "'source' host '{' accept-stmst [write-stmts] [datadir-stmts] '}'"
+ * where datadir-stmt is "'datadir' path ['create' ['every' number]]" */
 int
 read_source(struct sourcelist * sol, struct lex * l, int filecheck)
 {
@@ -208,6 +236,7 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
     int st;
     int pc;
     int fd;
+    int i, n;
 
     /* get hostname */
     lex_nexttoken(l);
@@ -241,10 +270,17 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
                 case LXT_PF:
                 case LXT_PFQ:
                 case LXT_PROC:
+                case LXT_PROC1:
                 case LXT_SENSOR:
+                case LXT_SMART1:
                 case LXT_SMART:
                 case LXT_LOAD:
                 case LXT_FLUKSO:
+                case LXT_NVME:
+                case LXT_CGROUP:
+                case LXT_PSI:
+                case LXT_SELF:
+                case LXT_TEST:
                     st = token2type(l->op);
                     strncpy(&sn[0], l->token, _POSIX2_LINE_MAX);
 
@@ -276,17 +312,61 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
                         sa[SYMON_PS_ARGLENV2 - 1] = '\0';
                     }
 
-                    if ((stream = add_source_stream(source, st, sa)) == NULL) {
+                    if (strpbrk(sa, "*?[") == NULL) {
+                        if ((stream = add_source_stream(source, st, sa)) == NULL) {
+                            warning("%.200s:%d: stream %.200s(%.200s) redefined",
+                                    l->filename, l->cline, sn, sa);
+                            return 0;
+                        }
+                        break;
+                    }
+
+                    /* wildcard; streams are accepted when first seen */
+                    if ((stream = add_source_wildcard(source, st, sa)) == NULL) {
                         warning("%.200s:%d: stream %.200s(%.200s) redefined",
                                 l->filename, l->cline, sn, sa);
                         return 0;
                     }
 
+                    stream->limit = SYMON_MAXWILDCARD;
+                    lex_nexttoken(l);
+                    if (l->op == LXT_LIMIT) {
+                        lex_nexttoken(l);
+                        if (l->type != LXY_NUMBER || l->value < 1) {
+                            parse_error(l, "<number>");
+                            return 0;
+                        }
+                        stream->limit = l->value;
+                    } else {
+                        lex_ungettoken(l);
+                    }
+
                     break;      /* LXT_resource */
+                case LXT_CPUS:
+                    /* cpus(n) arrives as cpu(0) .. cpu(n-1) */
+                    EXPECT(l, LXT_OPEN);
+                    lex_nexttoken(l);
+                    if (l->type != LXY_NUMBER || l->value < 1 || l->value > SYMON_MAXCPUID) {
+                        parse_error(l, "<number of cpus>");
+                        return 0;
+                    }
+                    n = l->value;
+                    EXPECT(l, LXT_CLOSE);
+
+                    for (i = 0; i < n; i++) {
+                        snprintf(&sa[0], _POSIX2_LINE_MAX, "%d", i);
+                        if (add_source_stream(source, MT_CPU, sa) == NULL) {
+                            warning("%.200s:%d: stream cpu(%.200s) redefined",
+                                    l->filename, l->cline, sa);
+                            return 0;
+                        }
+                    }
+
+                    break;      /* LXT_CPUS */
                 case LXT_COMMA:
                     break;
                 default:
-                    parse_error(l, "{cpu|cpuiow|df|if|if1|io|io1|mem|mem1|pf|pfq|mbuf|debug|proc|sensor|smart|load|flukso}");
+                    parse_error(l, "{cpu|cpuiow|df|if|if1|io|io1|mem|mem1|pf|pfq|mbuf|debug|proc|proc1|sensor|smart|smart1|load|flukso|self|test|cpus|nvme|cgroup|psi}");
                     return 0;
 
                     break;
@@ -330,6 +410,35 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
                 pc--;
             }
 
+            /* wildcard streams get their files in the last datadir */
+            if (source->datadir != NULL)
+                xfree(source->datadir);
+            source->datadir = xstrdup(path);
+
+            /* parse [create [every x [second|seconds]]] */
+            lex_nexttoken(l);
+            if (l->op == LXT_CREATE) {
+                source->rrdstep = SYMUX_RRDSTEP;
+
+                lex_nexttoken(l);
+                if (l->op == LXT_EVERY) {
+                    lex_nexttoken(l);
+                    if (l->type != LXY_NUMBER || l->value <= 0) {
+                        parse_error(l, "<number>");
+                        return 0;
+                    }
+                    source->rrdstep = l->value;
+
+                    lex_nexttoken(l);
+                    if (l->op != LXT_SECOND && l->op != LXT_SECONDS)
+                        lex_ungettoken(l);
+                } else {
+                    lex_ungettoken(l);
+                }
+            } else {
+                lex_ungettoken(l);
+            }
+
             /* add path to empty streams */
             SLIST_FOREACH(stream, &source->sl, streams) {
                 if (stream->file == NULL) {
@@ -356,9 +465,15 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
                     if (filecheck) {
                         /* try filename */
                         if ((fd = open(path, O_RDWR | O_NONBLOCK, 0)) == -1) {
-                            /* warn, but allow */
-                            warning("%.200s:%d: file '%.200s', guessed by datadir,  cannot be opened",
-                                    l->filename, l->cline, path);
+                            if (source->rrdstep && has_rrd_template(stream->type)) {
+                                /* created when the stream is first seen */
+                                stream->file = xstrdup(path);
+                                stream->pending = 1;
+                            } else {
+                                /* warn, but allow */
+                                warning("%.200s:%d: file '%.200s', guessed by datadir,  cannot be opened",
+                                        l->filename, l->cline, path);
+                            }
                         } else {
                             close(fd);
                             stream->file = xstrdup(path);
@@ -387,10 +502,17 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
             case LXT_PF:
             case LXT_PFQ:
             case LXT_PROC:
+            case LXT_PROC1:
             case LXT_SENSOR:
+            case LXT_SMART1:
             case LXT_SMART:
             case LXT_LOAD:
             case LXT_FLUKSO:
+            case LXT_NVME:
+            case LXT_CGROUP:
+            case LXT_PSI:
+            case LXT_SELF:
+            case LXT_TEST:
                 st = token2type(l->op);
                 strncpy(&sn[0], l->token, _POSIX2_LINE_MAX);
 
@@ -452,7 +574,7 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
                 }
                 break;          /* LXT_resource */
             default:
-                parse_error(l, "{cpu|cpuiow|df|if|if1|io|io1|mem|mem1|pf|pfq|mbuf|debug|proc|sensor|smart|load|flukso}");
+                parse_error(l, "{cpu|cpuiow|df|if|if1|io|io1|mem|mem1|pf|pfq|mbuf|debug|proc|proc1|sensor|smart|smart1|load|flukso|self|test|nvme|cgroup|psi}");
                 return 0;
                 break;
             }
@@ -470,6 +592,68 @@ read_source(struct sourcelist * sol, struct lex * l, int filecheck)
 
     return 0;
 }
+/* parse "'metrics' ['every' number ['second'|'seconds']] ['datadir' path]" */
+int
+read_metrics(struct lex * l, int *interval, char **dir, int filecheck)
+{
+    struct stat sb;
+    int pc;
+
+    if (*interval) {
+        warning("%.200s:%d: only one metrics statement allowed",
+                l->filename, l->cline);
+        return 0;
+    }
+
+    *interval = SYMUX_METRICS_INTERVAL;
+
+    lex_nexttoken(l);
+    if (l->op == LXT_EVERY) {
+        lex_nexttoken(l);
+        if (l->type != LXY_NUMBER || l->value <= 0) {
+            parse_error(l, "<number>");
+            return 0;
+        }
+        *interval = l->value;
+
+        lex_nexttoken(l);
+        if (l->op != LXT_SECOND && l->op != LXT_SECONDS)
+            lex_ungettoken(l);
+
+        lex_nexttoken(l);
+    }
+
+    if (l->op != LXT_DATADIR) {
+        lex_ungettoken(l);
+        return 1;
+    }
+
+    lex_nexttoken(l);
+    /* is path absolute */
+    if (l->token && l->token[0] != '/') {
+        warning("%.200s:%d: datadir path '%.200s' is not absolute",
+                l->filename, l->cline, l->token);
+        return 0;
+    }
+
+    if (filecheck) {
+        /* make sure that directory exists */
+        bzero(&sb, sizeof(struct stat));
+
+        if (stat(l->token, &sb) != 0 || !(sb.st_mode & S_IFDIR)) {
+            warning("%.200s:%d: datadir path '%.200s' is not a directory",
+                    l->filename, l->cline, l->token);
+            return 0;
+        }
+    }
+
+    *dir = xstrdup(l->token);
+    pc = strlen(*dir);
+    if (pc > 1 && (*dir)[pc - 1] == '/')
+        (*dir)[pc - 1] = '\0';
+
+    return 1;
+}
 /* Read symux.conf */
 int
 read_config_file(struct muxlist * mul, const char *filename, int filechecks)
@@ -479,6 +663,8 @@ read_config_file(struct muxlist * mul, const char *filename, int filechecks)
     struct stream *stream;
     struct mux *mux;
     struct sourcelist sol;
+    char *metricsdir = NULL;
+    int metrics = 0;
     SLIST_INIT(mul);
     SLIST_INIT(&sol);
 
@@ -500,8 +686,16 @@ read_config_file(struct muxlist * mul, const char *filename, int filechecks)
                 return 0;
             }
             break;
+        case LXT_METRICS:
+            if (!read_metrics(l, &metrics, &metricsdir, filechecks)) {
+                if (metricsdir != NULL)
+                    xfree(metricsdir);
+                free_sourcelist(&sol);
+                return 0;
+            }
+            break;
         default:
-            parse_error(l, "mux|source");
+            parse_error(l, "mux|source|metrics");
             free_sourcelist(&sol);
             return 0;
             break;
@@ -517,6 +711,8 @@ read_config_file(struct muxlist * mul, const char *filename, int filechecks)
     } else {
         mux = SLIST_FIRST(mul);
         mux->sol = sol;
+        mux->metrics = metrics;
+        mux->metricsdir = metricsdir;
         if (strncmp(SYMON_UNKMUX, mux->name, sizeof(SYMON_UNKMUX)) == 0) {
             /* mux was not initialised for some reason */
             return 0;
@@ -529,7 +725,7 @@ read_config_file(struct muxlist * mul, const char *filename, int filechecks)
         return 0;
     } else {
         SLIST_FOREACH(source, &sol, sources) {
-            if (SLIST_EMPTY(&source->sl)) {
+            if (SLIST_EMPTY(&source->sl) && SLIST_EMPTY(&source->wl)) {
                 warning("%.200s: no streams accepted for source '%.200s'",
                         l->filename, source->addr);
                 return 0;
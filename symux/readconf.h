@@ -35,6 +35,7 @@
 #include "data.h"
 
 __BEGIN_DECLS
+int insert_filename(char *, int, int, char *);
 int read_config_file(struct muxlist *, const char *, int);
 __END_DECLS
 
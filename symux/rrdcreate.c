@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *    - Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *    - Redistributions in binary form must reproduce the above
+ *      copyright notice, this list of conditions and the following
+ *      disclaimer in the documentation and/or other materials provided
+ *      with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/*
+ * Create missing rrd files in the background.
+ *
+ * Files are created from the same data source templates as c_smrrds.sh, by a
+ * single thread that creates at most SYMUX_MAXCREATES files per second. Files
+ * are written under a temporary name and renamed into place when complete;
+ * symux starts writing a stream once its file exists. Files that could not be
+ * created are not retried until the configuration is reread.
+ *
+ * Plain librrd keeps its error state in a global, so every call into librrd,
+ * from this thread or from update_rrd, holds librrd_mutex.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <rrd.h>
+
+#include "conf.h"
+#include "data.h"
+#include "error.h"
+#include "rrdcreate.h"
+#include "symux.h"
+#include "xmalloc.h"
+
+struct rrdtemplate {
+    int type;
+    char *ds;                   /* name:kind:min:max ... */
+};
+
+/* see c_smrrds.sh */
+static struct rrdtemplate rrdtemplate[] = {
+    {MT_CPU, "user:GAUGE:0:100 nice:GAUGE:0:100 system:GAUGE:0:100 "
+     "interrupt:GAUGE:0:100 idle:GAUGE:0:100"},
+    {MT_CPUIOW, "user:GAUGE:0:100 nice:GAUGE:0:100 system:GAUGE:0:100 "
+     "interrupt:GAUGE:0:100 idle:GAUGE:0:100 iowait:GAUGE:0:100"},
+    {MT_DF, "blocks:GAUGE:0:U bfree:GAUGE:0:U bavail:GAUGE:0:U files:GAUGE:0:U "
+     "ffree:GAUGE:0:U syncwrites:COUNTER:U:U asyncwrites:COUNTER:U:U"},
+    {MT_SENSOR, "value:GAUGE:U:U"},
+    {MT_MEM1, "real_active:GAUGE:0:U real_total:GAUGE:0:U free:GAUGE:0:U "
+     "swap_used:GAUGE:0:U swap_total:GAUGE:0:U"},
+    {MT_MEM2, "real_active:GAUGE:0:U real_total:GAUGE:0:U free:GAUGE:0:U "
+     "swap_used:GAUGE:0:U swap_total:GAUGE:0:U"},
+    {MT_IF1, "ipackets:COUNTER:U:U opackets:COUNTER:U:U ibytes:COUNTER:U:U "
+     "obytes:COUNTER:U:U imcasts:COUNTER:U:U omcasts:COUNTER:U:U "
+     "ierrors:COUNTER:U:U oerrors:COUNTER:U:U collisions:COUNTER:U:U "
+     "drops:COUNTER:U:U"},
+    {MT_IF2, "ipackets:COUNTER:U:U opackets:COUNTER:U:U ibytes:COUNTER:U:U "
+     "obytes:COUNTER:U:U imcasts:COUNTER:U:U omcasts:COUNTER:U:U "
+     "ierrors:COUNTER:U:U oerrors:COUNTER:U:U collisions:COUNTER:U:U "
+     "drops:COUNTER:U:U"},
+    {MT_DEBUG, "debug0:GAUGE:U:U debug1:GAUGE:U:U debug2:GAUGE:U:U "
+     "debug3:GAUGE:U:U debug4:GAUGE:U:U debug5:GAUGE:U:U debug6:GAUGE:U:U "
+     "debug7:GAUGE:U:U debug8:GAUGE:U:U debug9:GAUGE:U:U debug10:GAUGE:U:U "
+     "debug11:GAUGE:U:U debug12:GAUGE:U:U debug13:GAUGE:U:U "
+     "debug14:GAUGE:U:U debug15:GAUGE:U:U debug16:GAUGE:U:U "
+     "debug17:GAUGE:U:U debug18:GAUGE:U:U debug19:GAUGE:U:U"},
+    {MT_PROC, "number:GAUGE:0:U uticks:COUNTER:0:U sticks:COUNTER:0:U "
+     "iticks:COUNTER:0:U cpusec:GAUGE:0:U cpupct:GAUGE:0:100 "
+     "procsz:GAUGE:0:U rsssz:GAUGE:0:U"},
+    {MT_PROC2, "number:GAUGE:0:U uticks:COUNTER:0:U sticks:COUNTER:0:U "
+     "iticks:COUNTER:0:U cpusec:GAUGE:0:U cpupct:GAUGE:0:100 "
+     "procsz:GAUGE:0:U rsssz:GAUGE:0:U"},
+    {MT_PF, "bytes_v4_in:DERIVE:0:U bytes_v4_out:DERIVE:0:U "
+     "bytes_v6_in:DERIVE:0:U bytes_v6_out:DERIVE:0:U "
+     "packets_v4_in_pass:DERIVE:0:U packets_v4_in_drop:DERIVE:0:U "
+     "packets_v4_out_pass:DERIVE:0:U packets_v4_out_drop:DERIVE:0:U "
+     "packets_v6_in_pass:DERIVE:0:U packets_v6_in_drop:DERIVE:0:U "
+     "packets_v6_out_pass:DERIVE:0:U packets_v6_out_drop:DERIVE:0:U "
+     "states_entries:GAUGE:0:U states_searches:DERIVE:0:U "
+     "states_inserts:DERIVE:0:U states_removals:DERIVE:0:U "
+     "counters_match:DERIVE:0:U counters_badoffset:DERIVE:0:U "
+     "counters_fragment:DERIVE:0:U counters_short:DERIVE:0:U "
+     "counters_normalize:DERIVE:0:U counters_memory:DERIVE:0:U"},
+    {MT_PFQ, "sent_bytes:COUNTER:0:U sent_packets:COUNTER:0:U "
+     "drop_bytes:COUNTER:0:U drop_packets:COUNTER:0:U"},
+    {MT_MBUF, "totmbufs:GAUGE:0:U mt_data:GAUGE:0:U mt_oobdata:GAUGE:0:U "
+     "mt_control:GAUGE:0:U mt_header:GAUGE:0:U mt_ftable:GAUGE:0:U "
+     "mt_soname:GAUGE:0:U mt_soopts:GAUGE:0:U pgused:GAUGE:0:U "
+     "pgtotal:GAUGE:0:U totmem:GAUGE:0:U totpct:GAUGE:0:100 "
+     "m_drops:COUNTER:0:U m_wait:COUNTER:0:U m_drain:COUNTER:0:U"},
+    {MT_IO2, "rxfer:COUNTER:U:U wxfer:COUNTER:U:U seeks:COUNTER:U:U "
+     "rbytes:COUNTER:U:U wbytes:COUNTER:U:U"},
+    {MT_IO1, "transfers:COUNTER:U:U seeks:COUNTER:U:U bytes:COUNTER:U:U"},
+    {MT_SMART, "read_error_rate:GAUGE:U:U realloc_sectors:GAUGE:U:U "
+     "spin_retries:GAUGE:U:U air_flow_temp:GAUGE:U:U temperature:GAUGE:U:U "
+     "realloc:GAUGE:U:U cur_pending:GAUGE:U:U uncorr:GAUGE:U:U "
+     "sread_error_rate:GAUGE:U:U gsense_error_rate:GAUGE:U:U "
+     "temperature2:GAUGE:U:U freefall:GAUGE:U:U"},
+    {MT_SMART2, "read_error_rate:GAUGE:U:U realloc_sectors:GAUGE:U:U "
+     "spin_retries:GAUGE:U:U air_flow_temp:GAUGE:U:U temperature:GAUGE:U:U "
+     "realloc:GAUGE:U:U cur_pending:GAUGE:U:U uncorr:GAUGE:U:U "
+     "sread_error_rate:GAUGE:U:U gsense_error_rate:GAUGE:U:U "
+     "temperature2:GAUGE:U:U freefall:GAUGE:U:U age:GAUGE:0:U"},
+    {MT_NVME, "critical_warning:GAUGE:0:255 temperature:GAUGE:U:U "
+     "avail_spare:GAUGE:0:100 pct_used:GAUGE:0:255 rbytes:COUNTER:U:U "
+     "wbytes:COUNTER:U:U power_cycles:GAUGE:0:U power_on_hours:GAUGE:0:U "
+     "unsafe_shutdowns:GAUGE:0:U media_errors:GAUGE:0:U "
+     "error_log_entries:GAUGE:0:U"},
+    {MT_CGROUP, "cpu_usage:COUNTER:U:U cpu_user:COUNTER:U:U "
+     "cpu_system:COUNTER:U:U nr_throttled:COUNTER:U:U throttled:COUNTER:U:U "
+     "mem_current:GAUGE:0:U mem_anon:GAUGE:0:U mem_file:GAUGE:0:U "
+     "pgmajfault:COUNTER:U:U rbytes:COUNTER:U:U wbytes:COUNTER:U:U "
+     "rios:COUNTER:U:U wios:COUNTER:U:U pids:GAUGE:0:U"},
+    {MT_PSI, "some10:GAUGE:0:100 some60:GAUGE:0:100 some300:GAUGE:0:100 "
+     "some:COUNTER:U:U full10:GAUGE:0:100 full60:GAUGE:0:100 "
+     "full300:GAUGE:0:100 full:COUNTER:U:U"},
+    {MT_LOAD, "load1:GAUGE:0:U load5:GAUGE:0:U load15:GAUGE:0:U"},
+    {MT_FLUKSO, "watts:GAUGE:0:U"},
+    {MT_SELF, "calls:COUNTER:U:U wall:COUNTER:U:U cpu:COUNTER:U:U "
+     "max:GAUGE:0:U bytes:COUNTER:U:U errors:COUNTER:U:U h10us:COUNTER:U:U "
+     "h100us:COUNTER:U:U h1ms:COUNTER:U:U h10ms:COUNTER:U:U "
+     "h100ms:COUNTER:U:U h1s:COUNTER:U:U hslow:COUNTER:U:U"},
+    {MT_EOT, NULL}
+};
+
+/* default RRA setup of c_smrrds.sh */
+static char *rrdarchives[] = {
+    "RRA:AVERAGE:0.5:1:34560",
+    "RRA:AVERAGE:0.5:360:672",
+    "RRA:AVERAGE:0.5:1440:600",
+    "RRA:AVERAGE:0.5:17280:600",
+    "RRA:MAX:0.5:1:34560",
+    "RRA:MAX:0.5:360:672",
+    "RRA:MAX:0.5:1440:600",
+    "RRA:MAX:0.5:17280:600",
+    "RRA:MIN:0.5:1:34560",
+    "RRA:MIN:0.5:360:672",
+    "RRA:MIN:0.5:1440:600",
+    "RRA:MIN:0.5:17280:600",
+    NULL
+};
+
+struct rrdrequest {
+    char *file;
+    int type;
+    int step;
+    TAILQ_ENTRY(rrdrequest) requests;
+};
+TAILQ_HEAD(rrdrequests, rrdrequest);
+
+__BEGIN_DECLS
+static char *find_rrd_template(int);
+static int find_request(struct rrdrequests *, char *);
+static int build_rrd(struct rrdrequest *);
+static void *creator(void *);
+__END_DECLS
+
+pthread_mutex_t librrd_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t create_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t create_cond = PTHREAD_COND_INITIALIZER;
+static struct rrdrequests create_queue = TAILQ_HEAD_INITIALIZER(create_queue);
+static struct rrdrequests create_failed = TAILQ_HEAD_INITIALIZER(create_failed);
+static int create_queued = 0;
+static int create_started = 0;
+
+static char *
+find_rrd_template(int type)
+{
+    int i;
+
+    for (i = 0; rrdtemplate[i].type != MT_EOT; i++)
+        if (rrdtemplate[i].type == type)
+            return rrdtemplate[i].ds;
+
+    return NULL;
+}
+/* Check whether rrd files of stream type can be created */
+int
+has_rrd_template(int type)
+{
+    return (find_rrd_template(type) != NULL);
+}
+static int
+find_request(struct rrdrequests * list, char *file)
+{
+    struct rrdrequest *r;
+
+    TAILQ_FOREACH(r, list, requests)
+        if (strcmp(r->file, file) == 0)
+            return 1;
+
+    return 0;
+}
+/* Create the rrd file of a request from its template */
+static int
+build_rrd(struct rrdrequest * r)
+{
+    char tmp[_POSIX2_LINE_MAX];
+    const char **argv;
+    char *ds, *name, *next, *kind, *range;
+    int result, created;
+    int argc;
+    int n;
+    int i;
+
+    ds = xstrdup(find_rrd_template(r->type));
+
+    n = 1;
+    for (i = 0; ds[i] != '\0'; i++)
+        if (ds[i] == ' ')
+            n++;
+    for (i = 0; rrdarchives[i] != NULL; i++)
+        n++;
+
+    argv = xmalloc(n * sizeof(char *));
+    argc = 0;
+
+    /* name:kind:min:max becomes DS:name:kind:heartbeat:min:max */
+    for (name = ds; name != NULL; name = next) {
+        if ((next = strchr(name, ' ')) != NULL)
+            *next++ = '\0';
+
+        kind = strchr(name, ':');
+        *kind++ = '\0';
+        range = strchr(kind, ':');
+        *range++ = '\0';
+
+        snprintf(tmp, sizeof(tmp), "DS:%s:%s:%d:%s", name, kind, r->step, range);
+        argv[argc++] = xstrdup(tmp);
+    }
+    for (i = 0; rrdarchives[i] != NULL; i++)
+        argv[argc++] = xstrdup(rrdarchives[i]);
+
+    /* files are created under a temporary name, as symux writes to any
+     * file that exists */
+    snprintf(tmp, sizeof(tmp), "%s.new", r->file);
+    unlink(tmp);
+
+    result = 0;
+    pthread_mutex_lock(&librrd_mutex);
+    rrd_clear_error();
+    created = (rrd_create_r(tmp, r->step, time(NULL) - 10, argc, argv) == 0 &&
+               !rrd_test_error());
+    if (!created) {
+        warning("could not create '%.200s': %.200s", r->file, rrd_get_error());
+        rrd_clear_error();
+    }
+    pthread_mutex_unlock(&librrd_mutex);
+
+    if (!created) {
+        unlink(tmp);
+    } else if (rename(tmp, r->file) != 0) {
+        warning("could not create '%.200s': %.200s", r->file, strerror(errno));
+        unlink(tmp);
+    } else {
+        info("created '%.200s'", r->file);
+        result = 1;
+    }
+
+    for (i = 0; i < argc; i++)
+        xfree((char *) argv[i]);
+    xfree(argv);
+    xfree(ds);
+
+    return result;
+}
+/* Create requested files, at most SYMUX_MAXCREATES per second */
+static void *
+creator(void *arg)
+{
+    struct rrdrequest *r;
+    struct timeval tv;
+    time_t second;
+    int created;
+    int failed;
+
+    second = 0;
+    created = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&create_mutex);
+        while (TAILQ_EMPTY(&create_queue))
+            pthread_cond_wait(&create_cond, &create_mutex);
+        r = TAILQ_FIRST(&create_queue);
+        pthread_mutex_unlock(&create_mutex);
+
+        gettimeofday(&tv, NULL);
+        if (tv.tv_sec != second) {
+            second = tv.tv_sec;
+            created = 0;
+        }
+
+        if (created >= SYMUX_MAXCREATES) {
+            usleep(1000000 - tv.tv_usec);
+            continue;
+        }
+
+        /* the request stays queued while it is built to keep out doubles */
+        failed = 0;
+        if (access(r->file, F_OK) != 0) {
+            failed = !build_rrd(r);
+            created++;
+        }
+
+        pthread_mutex_lock(&create_mutex);
+        TAILQ_REMOVE(&create_queue, r, requests);
+        create_queued--;
+        if (failed) {
+            TAILQ_INSERT_TAIL(&create_failed, r, requests);
+            r = NULL;
+        }
+        pthread_mutex_unlock(&create_mutex);
+
+        if (r != NULL) {
+            xfree(r->file);
+            xfree(r);
+        }
+    }
+
+    return NULL;
+}
+/*
+ * Queue the creation of an rrd file for a stream type, with samples every
+ * step seconds. Returns 0 if the file will not be created.
+ */
+int
+create_rrd(char *file, int type, int step)
+{
+    struct rrdrequest *r;
+    sigset_t all, old;
+    pthread_t thread;
+    int result;
+
+    if (!has_rrd_template(type))
+        return 0;
+
+    pthread_mutex_lock(&create_mutex);
+    if (find_request(&create_failed, file)) {
+        result = 0;
+    } else if (find_request(&create_queue, file)) {
+        result = 1;
+    } else if (create_queued >= SYMUX_MAXCREATEQUEUE) {
+        /* retried when the stream is seen again */
+        result = 0;
+    } else {
+        r = xmalloc(sizeof(struct rrdrequest));
+        r->file = xstrdup(file);
+        r->type = type;
+        r->step = step;
+        TAILQ_INSERT_TAIL(&create_queue, r, requests);
+        create_queued++;
+        pthread_cond_signal(&create_cond);
+        result = 1;
+    }
+    pthread_mutex_unlock(&create_mutex);
+
+    if (result && !create_started) {
+        /* signals are handled by the main thread */
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        if ((errno = pthread_create(&thread, NULL, creator, NULL)) != 0)
+            fatal("could not start rrd creator: %.200s", strerror(errno));
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        create_started = 1;
+    }
+
+    return result;
+}
+/* Allow files that could not be created to be tried again */
+void
+reset_rrd_failures(void)
+{
+    struct rrdrequest *r;
+
+    pthread_mutex_lock(&create_mutex);
+    while ((r = TAILQ_FIRST(&create_failed)) != NULL) {
+        TAILQ_REMOVE(&create_failed, r, requests);
+        xfree(r->file);
+        xfree(r);
+    }
+    pthread_mutex_unlock(&create_mutex);
+}
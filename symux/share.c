@@ -50,6 +50,7 @@
 #include "symux.h"
 #include "symuxnet.h"
 #include "share.h"
+#include "metrics.h"
 #include "net.h"
 
 /* Shared operation:
@@ -186,6 +187,8 @@ master_forbidread(void)
     } else {
         reap_clients();
         debug("realclients = %d; stalledclients = %d", realclients, stalledclients);
+        /* clients still busy with this slot are lagging */
+        count_metric(&metric_client, 0, 0, stalledclients);
     }
 
     /* add new clients */
@@ -203,6 +206,7 @@ master_permitread(void)
     union semun semarg;
 
     semarg.val = realclients;
+    count_metric(&metric_client, 1, shm->ctlen[slot] * realclients, 0);
 
     if (semctl(semid, slot, SETVAL, semarg) != 0)
         fatal("%s:%d: internal error: cannot set semaphore %d",
@@ -34,6 +34,7 @@
 #include <netinet/in.h>
 #include <netdb.h>
 
+#include <fnmatch.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,10 +48,12 @@
 #include "data.h"
 #include "error.h"
 #include "limits.h"
+#include "metrics.h"
 #include "symux.h"
 #include "symuxnet.h"
 #include "net.h"
 #include "readconf.h"
+#include "rrdcreate.h"
 #include "share.h"
 #include "xmalloc.h"
 
@@ -60,12 +63,16 @@ __BEGIN_DECLS
 void exithandler(int);
 void huphandler(int);
 void signalhandler(int);
+struct stream *accept_stream(struct source *, struct packedstream *);
+int rrd_ready(struct source *, struct stream *);
+int store_stream(struct source *, struct packedstream *, u_int64_t, char *, int);
 __END_DECLS
 
 int flag_hup = 0;
 int flag_testconf = 0;
 fd_set fdset;
 int maxfd;
+unsigned int rrderrors = 0;
 
 void
 exithandler(int s)
@@ -79,6 +86,159 @@ huphandler(int s)
     info("hup received");
     flag_hup = 1;
 }
+/* Write "timestamp:value:..." to an rrd file */
+void
+update_rrd(char *file, char *values)
+{
+    struct metrictimer timer;
+    char *arg_ra[4];
+
+    start_metric(&timer);
+
+    /* clear optind for getopt call by rrdupdate */
+    optind = 0;
+    arg_ra[0] = "rrdupdate";
+    arg_ra[1] = "--";
+    arg_ra[2] = file;
+    arg_ra[3] = values;
+
+    /*
+     * This call will cost a lot (symux will become unresponsive and eat up
+     * massive amounts of cpu) if the rrdfile is out of sync.
+     */
+    pthread_mutex_lock(&librrd_mutex);
+    rrd_update(4, arg_ra);
+
+    if (rrd_test_error()) {
+        if (rrderrors < SYMUX_MAXRRDERRORS) {
+            rrderrors++;
+            warning("rrd_update:%.200s", rrd_get_error());
+            warning("%.200s %.200s %.200s %.200s", arg_ra[0], arg_ra[1],
+                    arg_ra[2], arg_ra[3]);
+            if (rrderrors == SYMUX_MAXRRDERRORS) {
+                warning("maximum rrd errors reached - will stop reporting them");
+            }
+        }
+        rrd_clear_error();
+        pthread_mutex_unlock(&librrd_mutex);
+        stop_metric(&timer, &metric_rrd, strlen(values), 1);
+    } else {
+        pthread_mutex_unlock(&librrd_mutex);
+        if (flag_debug == 1)
+            debug("%.200s %.200s %.200s %.200s", arg_ra[0], arg_ra[1],
+                  arg_ra[2], arg_ra[3]);
+        stop_metric(&timer, &metric_rrd, strlen(values), 0);
+    }
+}
+/* Accept a stream that matches a wildcard of the source */
+struct stream *
+accept_stream(struct source * source, struct packedstream * ps)
+{
+    struct stream *stream, *wildcard;
+    char path[_POSIX2_LINE_MAX];
+    int pc;
+
+    SLIST_FOREACH(wildcard, &source->wl, streams)
+        if (wildcard->type == ps->type && fnmatch(wildcard->arg, ps->arg, 0) == 0)
+            break;
+
+    if (wildcard == NULL || wildcard->discovered >= wildcard->limit)
+        return NULL;
+
+    stream = add_source_stream(source, ps->type, ps->arg);
+    wildcard->discovered++;
+
+    info("accepted %.200s(%.200s) from %.200s", type2str(ps->type), ps->arg, source->addr);
+
+    if (source->datadir == NULL)
+        return stream;
+
+    snprintf(path, sizeof(path), "%s", source->datadir);
+    pc = strlen(path);
+    if (!insert_filename(&path[pc], sizeof(path) - pc, ps->type, ps->arg))
+        return stream;
+
+    stream->file = xstrdup(path);
+    if (access(path, F_OK) != 0) {
+        if (source->rrdstep && has_rrd_template(stream->type)) {
+            stream->pending = 1;
+        } else {
+            warning("file '%.200s' for %.200s(%.200s) does not exist", path,
+                    type2str(ps->type), ps->arg);
+            xfree(stream->file);
+            stream->file = NULL;
+        }
+    }
+
+    return stream;
+}
+/* Check whether the rrd file of a stream exists; request it otherwise */
+int
+rrd_ready(struct source * source, struct stream * stream)
+{
+    if (access(stream->file, F_OK) == 0) {
+        stream->pending = 0;
+        return 1;
+    }
+
+    /* requests for files that are queued already are ignored */
+    create_rrd(stream->file, stream->type, source->rrdstep);
+
+    return 0;
+}
+/*
+ * Write a stream to its rrd file and append "type:arg:timestamp:values;" for
+ * the clients to buf. Returns the number of characters appended.
+ */
+int
+store_stream(struct source * source, struct packedstream * ps, u_int64_t timestamp,
+             char *buf, int maxlen)
+{
+    struct stream *stream;
+    char *rrdvalues;
+    char *p;
+
+    /* find stream in source */
+    if ((stream = find_source_stream(source, ps->type, ps->arg)) == NULL &&
+        (stream = accept_stream(source, ps)) == NULL) {
+        count_metric(source->metric, 0, 0, 1);
+        debug("ignored unaccepted stream %.16s(%.16s) from %.20s", type2str(ps->type),
+              ((strlen(ps->arg) == 0) ? "0" : ps->arg), source->addr);
+        return 0;
+    }
+
+    p = buf;
+
+    /* put type and arg in and hide from rrd */
+    snprintf(p, maxlen, "%s:%s:", type2str(ps->type), ps->arg);
+    maxlen -= strlen(p);
+    p += strlen(p);
+    /* put timestamp in and show to rrd; sub-second samples get a fractional
+     * timestamp */
+    if (timestamp % 1000)
+        snprintf(p, maxlen, "%u.%03u",
+                 (unsigned int) (timestamp / 1000),
+                 (unsigned int) (timestamp % 1000));
+    else
+        snprintf(p, maxlen, "%u",
+                 (unsigned int) (timestamp / 1000));
+    rrdvalues = p;
+    maxlen -= strlen(p);
+    p += strlen(p);
+
+    /* put measurements in */
+    ps2strn(ps, p, maxlen, PS2STR_RRD);
+
+    /* save if file specified */
+    if (stream->file != NULL && (!stream->pending || rrd_ready(source, stream)))
+        update_rrd(stream->file, rrdvalues);
+    maxlen -= strlen(p);
+    p += strlen(p);
+    snprintf(p, maxlen, ";");
+    p += strlen(p);
+
+    return (p - buf);
+}
 /*
  * symux is the receiver of symon performance measurements.
  *
@@ -99,13 +259,15 @@ int
 main(int argc, char *argv[])
 {
     struct packedstream ps;
+    struct symonsampleheader sample;
+    struct metrictimer timer;
     char *cfgfile;
     char *cfgpath = NULL;
     char *stringbuf;
     char *stringptr;
     int maxstringlen;
     struct muxlist mul, newmul;
-    char *arg_ra[4];
+    struct packedstream eps;
     struct stream *stream;
     struct source *source;
     struct sourcelist *sol;
@@ -114,11 +276,13 @@ main(int argc, char *argv[])
     int ch;
     int churnbuflen;
     int flag_list;
+    int i;
     int offset;
+    int packeterrors;
     int result;
-    unsigned int rrderrors;
+    int sampleend;
     int slot;
-    time_t timestamp;
+    u_int64_t timestamp;        /* ms */
 
     SLIST_INIT(&mul);
 
@@ -238,10 +402,12 @@ main(int argc, char *argv[])
 
     mux = SLIST_FIRST(&mul);
 
-    churnbuflen = strlen_sourcelist(&mux->sol);
+    /* each sample of a batched packet is offered as a separate line */
+    churnbuflen = strlen_sourcelist(&mux->sol) * SYMON_MAXBATCH;
     debug("size of churnbuffer = %d", churnbuflen);
     initshare(churnbuflen);
     init_symux_packet(mux);
+    init_metrics(mux, 1);
 
     /* catch signals */
     signal(SIGHUP, huphandler);
@@ -259,7 +425,6 @@ main(int argc, char *argv[])
     if (get_client_socket(mux) == 0)
         fatal("socket for client connections could not be opened");
 
-    rrderrors = 0;
     /* main loop */
     for (;;) {                  /* FOREVER */
         wait_for_traffic(mux, &source);
@@ -274,14 +439,16 @@ main(int argc, char *argv[])
                 free_muxlist(&newmul);
             } else {
                 info("read configuration file '%.100s' successfully", cfgfile);
+                reset_rrd_failures();
                 free_muxlist(&mul);
                 mul = newmul;
                 mux = SLIST_FIRST(&mul);
                 get_symon_sockets(mux);
                 get_client_socket(mux);
                 init_symux_packet(mux);
+                init_metrics(mux, 1);
             }
-        } else {
+        } else if (source != NULL) {
 
             /*
              * Put information from packet into stringbuf (shared region).
@@ -291,99 +458,98 @@ main(int argc, char *argv[])
              * the hasseling with stringptr.
              */
 
+            start_metric(&timer);
+            packeterrors = 0;
             offset = mux->packet.offset;
             maxstringlen = shared_getmaxlen();
-            /* put time:ip: into shared region */
             slot = master_forbidread();
-            timestamp = (time_t) mux->packet.header.timestamp;
             stringbuf = shared_getmem(slot);
+            stringptr = stringbuf;
             debug("stringbuf = 0x%08x", stringbuf);
-            snprintf(stringbuf, maxstringlen, "%s;", source->addr);
-
-            /* hide this string region from rrd update */
-            maxstringlen -= strlen(stringbuf);
-            stringptr = stringbuf + strlen(stringbuf);
 
+            /*
+             * Version 3 packets contain multiple samples, each with their own
+             * timestamp. Every sample is written to the rrd files and offered
+             * to the clients as a separate line.
+             */
             while (offset < mux->packet.header.length) {
-                bzero(&ps, sizeof(struct packedstream));
-                if (mux->packet.header.symon_version == 1) {
-                    offset += sunpack1(mux->packet.data + offset, &ps);
-                } else if (mux->packet.header.symon_version == 2) {
-                    offset += sunpack2(mux->packet.data + offset, &ps);
+                if (mux->packet.header.symon_version == 3) {
+                    sampleend = offset;
+                    offset += getsampleheader(mux->packet.data + offset, &sample);
+                    sampleend += sample.length;
+                    timestamp = mux->packet.header.timestamp + sample.offset;
                 } else {
-                    debug("unsupported packet version - ignoring data");
-                    ps.type = MT_EOT;
+                    sampleend = mux->packet.header.length;
+                    timestamp = mux->packet.header.timestamp * 1000;
                 }
 
-                /* find stream in source */
-                stream = find_source_stream(source, ps.type, ps.arg);
+                if (sampleend > mux->packet.header.length || sampleend < offset) {
+                    warning("ignored malformed sample from %.200s", source->addr);
+                    packeterrors++;
+                    break;
+                }
 
-                if (stream != NULL) {
-                    /* put type and arg in and hide from rrd */
-                    snprintf(stringptr, maxstringlen, "%s:%s:", type2str(ps.type), ps.arg);
-                    maxstringlen -= strlen(stringptr);
-                    stringptr += strlen(stringptr);
-                    /* put timestamp in and show to rrd */
-                    snprintf(stringptr, maxstringlen, "%u", (unsigned int)timestamp);
-                    arg_ra[3] = stringptr;
-                    maxstringlen -= strlen(stringptr);
-                    stringptr += strlen(stringptr);
+                /* put ip; into shared region */
+                snprintf(stringptr, maxstringlen, "%s;", source->addr);
 
-                    /* put measurements in */
-                    ps2strn(&ps, stringptr, maxstringlen, PS2STR_RRD);
+                /* hide this string region from rrd update */
+                maxstringlen -= strlen(stringptr);
+                stringptr += strlen(stringptr);
 
-                    if (stream->file != NULL) {
-                        /* clear optind for getopt call by rrdupdate */
-                        optind = 0;
-                        /* save if file specified */
-                        arg_ra[0] = "rrdupdate";
-                        arg_ra[1] = "--";
-                        arg_ra[2] = stream->file;
-
-                        /*
-                         * This call will cost a lot (symux will become
-                         * unresponsive and eat up massive amounts of cpu) if
-                         * the rrdfile is out of sync.
-                         */
-                        rrd_update(4, arg_ra);
-
-                        if (rrd_test_error()) {
-                            if (rrderrors < SYMUX_MAXRRDERRORS) {
-                                rrderrors++;
-                                warning("rrd_update:%.200s", rrd_get_error());
-                                warning("%.200s %.200s %.200s %.200s", arg_ra[0], arg_ra[1],
-                                        arg_ra[2], arg_ra[3]);
-                                if (rrderrors == SYMUX_MAXRRDERRORS) {
-                                    warning("maximum rrd errors reached - will stop reporting them");
-                                }
-                            }
-                            rrd_clear_error();
-                        } else {
-                            if (flag_debug == 1)
-                                debug("%.200s %.200s %.200s %.200s", arg_ra[0], arg_ra[1],
-                                      arg_ra[2], arg_ra[3]);
+                while (offset < sampleend) {
+                    bzero(&ps, sizeof(struct packedstream));
+                    if (mux->packet.header.symon_version == 1) {
+                        result = sunpack1(mux->packet.data + offset, &ps);
+                    } else {
+                        result = sunpack2(mux->packet.data + offset, &ps);
+                    }
+
+                    if (result <= 0) {
+                        debug("unpack failure - ignoring rest of packet");
+                        packeterrors++;
+                        offset = mux->packet.header.length;
+                        break;
+                    }
+                    offset += result;
+
+                    if (offset > sampleend) {
+                        warning("ignored malformed sample from %.200s", source->addr);
+                        packeterrors++;
+                        offset = mux->packet.header.length;
+                        break;
+                    }
+
+                    /* vector streams are offered as streams of their elements */
+                    if (type2elem(ps.type) == -1) {
+                        result = store_stream(source, &ps, timestamp, stringptr, maxstringlen);
+                        maxstringlen -= result;
+                        stringptr += result;
+                    } else {
+                        for (i = 0; sunpackelem(&ps, i, &eps); i++) {
+                            result = store_stream(source, &eps, timestamp, stringptr, maxstringlen);
+                            maxstringlen -= result;
+                            stringptr += result;
                         }
                     }
-                    maxstringlen -= strlen(stringptr);
-                    stringptr += strlen(stringptr);
-                    snprintf(stringptr, maxstringlen, ";");
-                    maxstringlen -= strlen(stringptr);
-                    stringptr += strlen(stringptr);
-                } else {
-                    debug("ignored unaccepted stream %.16s(%.16s) from %.20s", type2str(ps.type),
-                          ((strlen(ps.arg) == 0) ? "0" : ps.arg), source->addr);
                 }
+                /* sample = parsed and in ascii in shared region */
+                snprintf(stringptr, maxstringlen, "\n");
+                maxstringlen -= strlen(stringptr);
+                stringptr += strlen(stringptr);
             }
             /*
              * packet = parsed and in ascii in shared region -> copy to
              * clients
              */
-            snprintf(stringptr, maxstringlen, "\n");
-            stringptr += strlen(stringptr);
             shared_setlen(slot, (stringptr - stringbuf));
             debug("churnbuffer used: %d", (stringptr - stringbuf));
             master_permitread();
+
+            stop_metric(&timer, source->metric, mux->packet.header.length, packeterrors);
+            stop_metric(&timer, &metric_packet, mux->packet.header.length, packeterrors);
         }                       /* flag_hup == 0 */
+
+        report_metrics(mux);
     }                           /* forever */
 
     /* NOT REACHED */
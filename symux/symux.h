@@ -49,4 +49,19 @@
 /* Number of rrd errors logged before smothering sets in */
 #define SYMUX_MAXRRDERRORS 5
 
+/* Default seconds between reports of symux's own metrics */
+#define SYMUX_METRICS_INTERVAL 60
+
+/* Default seconds between samples in created rrd files */
+#define SYMUX_RRDSTEP 5
+
+/* Number of rrd files created per second, and waiting to be created */
+#define SYMUX_MAXCREATES 10
+#define SYMUX_MAXCREATEQUEUE 1024
+
+/* prototypes */
+__BEGIN_DECLS
+void update_rrd(char *, char *);
+__END_DECLS
+
 #endif                          /* _SYMUX_SYMUX_H */
@@ -42,6 +42,7 @@
 #include "error.h"
 #include "symux.h"
 #include "symuxnet.h"
+#include "metrics.h"
 #include "net.h"
 #include "xmalloc.h"
 #include "share.h"
@@ -172,10 +173,14 @@ get_client_socket(struct mux * mux)
 void
 wait_for_traffic(struct mux * mux, struct source ** source)
 {
+    struct timeval tv;
     fd_set readset;
     int i;
     int socksactive;
     int maxsock;
+    int wait;
+
+    *source = NULL;
 
     for (;;) {                  /* FOREVER - until a valid symon packet is
                                  * received */
@@ -193,9 +198,20 @@ wait_for_traffic(struct mux * mux, struct source ** source)
         }
 
         maxsock++;
-        socksactive = select(maxsock, &readset, NULL, NULL, NULL);
 
-        if (socksactive != -1) {
+        /* wake up for metrics reports */
+        if ((wait = metrics_wait(mux)) >= 0) {
+            tv.tv_sec = wait;
+            tv.tv_usec = 0;
+            socksactive = select(maxsock, &readset, NULL, NULL, &tv);
+        } else {
+            socksactive = select(maxsock, &readset, NULL, NULL, NULL);
+        }
+
+        if (socksactive == 0) {
+            *source = NULL;
+            return;             /* metrics due */
+        } else if (socksactive != -1) {
             if (FD_ISSET(mux->clientsocket, &readset)) {
                 spawn_client(mux->clientsocket);
             }
@@ -206,8 +222,10 @@ wait_for_traffic(struct mux * mux, struct source ** source)
                         return;
                 }
         } else {
-            if (errno == EINTR)
+            if (errno == EINTR) {
+                *source = NULL;
                 return;         /* signal received while waiting, bail out */
+            }
         }
     }
 }
@@ -251,6 +269,7 @@ recv_symon_packet(struct mux * mux, int socknr, struct source ** source)
     get_numeric_name(&sind);
 
     if (*source == NULL) {
+        count_metric(&metric_unknown, 1, received, 1);
         debug("ignored data from %.200s:%.200s", res_host, res_service);
         return 0;
     } else {
@@ -268,12 +287,16 @@ recv_symon_packet(struct mux * mux, int socknr, struct source ** source)
             else
                 warning("ignored packet with bad crc from %.200s:%.200s",
                         res_host, res_service);
+            count_metric(&metric_crc, 1, received, 1);
+            count_metric((*source)->metric, 0, 0, 1);
             return 0;
         }
         /* check packet version */
         if (mux->packet.header.symon_version > SYMON_PACKET_VER) {
             warning("ignored packet with unsupported version %d from %.200s:%.200s",
                     mux->packet.header.symon_version, res_host, res_service);
+            count_metric(&metric_reject, 1, received, 1);
+            count_metric((*source)->metric, 0, 0, 1);
             return 0;
         } else {
             if (flag_debug) {